@@ -0,0 +1,290 @@
+#! /usr/bin/env python3
+
+# Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+import argparse
+import inspect
+import json
+import os
+import re
+import subprocess
+import sys
+
+import yaml
+
+this_file_path = os.path.abspath(inspect.getfile(inspect.currentframe()))
+root_dir = os.path.join(os.path.dirname(this_file_path), '..')
+
+# Output file names.
+out_prefix = "timeloop-mapper."
+stats_file_name = out_prefix + "stats.txt"
+results_file_name = "bench-mapper.json"
+
+# The GEMM shape of problem-shapes/gemm.cfg, inline so that the benchmark
+# does not depend on libconfig.
+gemm_shape = {
+    'name': 'gemm',
+    'dimensions': ['M', 'N', 'K'],
+    'data-spaces': [
+        {'name': 'A', 'projection': [[['M']], [['K']]]},
+        {'name': 'B', 'projection': [[['N']], [['K']]]},
+        {'name': 'C', 'projection': [[['M']], [['N']]]},
+        {'name': 'D', 'projection': [[['M']], [['N']]], 'read-write': True},
+    ],
+}
+
+# The curated benchmark set: name -> (config, problem override, default
+# budget). The GEMM point reuses the sample architecture with the gemm
+# problem shape; its mapspace constraints name CNN data spaces, so they are
+# dropped. Budgets are sized for a few seconds per run on one thread
+# (simba-chip evaluates about 100x slower than the others).
+benchmarks = {
+    'eyeriss-256': ('configs/mapper/eyeriss-256.yaml', None, 20000),
+    'simba-chip':  ('configs/mapper/simba-chip.yaml', None, 2000),
+    'sample':      ('configs/mapper/sample.yaml', None, 50000),
+    'gemm':        ('configs/mapper/sample.yaml', {'shape': gemm_shape, 'M': 256, 'N': 256, 'K': 256}, 50000),
+}
+
+search_line = re.compile(r'^Search: (\d+) mappings evaluated \((\d+) valid\) on (\d+) threads in ([0-9.]+) s')
+
+def load_config(path):
+    with open(path, 'r') as f:
+        if path.endswith('.cfg'):
+            import libconf
+            return plain(libconf.load(f))
+        else:
+            return yaml.load(f, Loader = yaml.SafeLoader)
+
+def plain(node):
+    """Converts libconf's AttrDicts and tuples into plain YAML-dumpable types."""
+    if isinstance(node, dict):
+        return {key: plain(value) for key, value in node.items()}
+    elif isinstance(node, (list, tuple)):
+        return [plain(value) for value in node]
+    return node
+
+def write_config(name, threads, options, dirname):
+    """Writes a copy of a benchmark config with a fixed, deterministic search.
+
+    The search algorithms draw from default-seeded generators and threads do
+    not exchange incumbents (sync-interval 0), so for a given thread count
+    every run visits the same mappings. max-evaluations fixes the number of
+    mappings evaluated across all threads, valid or not, so every thread
+    count does the same amount of work; search-size and victory-condition
+    are disabled so the budget is always spent, and timeout (off by
+    default) can stop threads whose share of the mapspace keeps yielding
+    invalid mappings. A search that exhausts its share of a small mapspace
+    evaluates fewer mappings, which compare() flags."""
+    config_file, problem, budget = benchmarks[name]
+    config = load_config(os.path.join(root_dir, config_file))
+    if problem:
+        config['problem'] = problem
+        config.pop('mapspace', None)
+        config.pop('mapspace_constraints', None)
+        config.pop('arch_constraints', None)
+        config.pop('architecture_constraints', None)
+        config.get('arch', {}).pop('constraints', None)
+
+    mapper = config.setdefault('mapper', {})
+    for key in ['search_size', 'search-size', 'heartbeat', 'log-all', 'live-status', 'log-stats',
+                'log-suboptimal', 'diagnostics', 'trace', 'sync-interval']:
+        mapper.pop(key, None)
+    if options.algorithm:
+        mapper['algorithm'] = options.algorithm
+    mapper['num-threads'] = threads
+    mapper['max-evaluations'] = options.budget or budget
+    mapper['victory-condition'] = 0
+    mapper['timeout'] = options.timeout
+
+    path = os.path.join(dirname, name + '.yaml')
+    with open(path, 'w') as f:
+        f.write(yaml.safe_dump(config))
+    return path
+
+def parse_stats(path):
+    """Returns the cost of the best mapping from a stats.txt file."""
+    best = {}
+    with open(path, 'r') as f:
+        text = f.read()
+    summary = text[text.rfind('Summary Stats'):]
+    for key, pattern in [('cycles', r'^Cycles: (\d+)'),
+                         ('energy_uJ', r'^Energy: ([0-9.]+) uJ'),
+                         ('pJ_per_macc', r'^\s+Total\s+= ([0-9.]+)')]:
+        match = re.search(pattern, summary, re.MULTILINE)
+        if match:
+            best[key] = float(match.group(1))
+    if 'cycles' in best and 'energy_uJ' in best:
+        best['edp'] = best['cycles'] * best['energy_uJ']
+    return best
+
+def run_point(mapper, name, threads, options, dirname):
+    """Runs the mapper once per repetition and returns the median run."""
+    rundir = os.path.join(dirname, name, 't%d' % threads)
+    os.makedirs(rundir, exist_ok = True)
+    try:
+        config_path = write_config(name, threads, options, rundir)
+    except ImportError as e:
+        print('ERROR: cannot read the %s config: %s' % (name, e))
+        return None
+
+    runs = []
+    for rep in range(options.repetitions):
+        logfile_path = os.path.join(rundir, 'log.txt')
+        with open(logfile_path, 'w') as outfile:
+            status = subprocess.call([mapper, os.path.abspath(config_path)], cwd = rundir,
+                                     stdout = outfile, stderr = outfile)
+        with open(logfile_path, 'r') as f:
+            matches = [search_line.match(line) for line in f]
+        matches = [m for m in matches if m]
+        if status != 0 or not matches:
+            print('ERROR: %s on %d threads failed, see %s' % (name, threads, logfile_path))
+            return None
+        mappings, valid, _, seconds = matches[-1].groups()
+        runs.append({'mappings': int(mappings), 'valid': int(valid), 'seconds': float(seconds),
+                     'evals_per_s': int(mappings) / max(float(seconds), 1e-9)})
+
+    run = sorted(runs, key = lambda r: r['evals_per_s'])[len(runs) // 2]
+    run['threads'] = threads
+    run['evals_per_s_spread'] = [min(r['evals_per_s'] for r in runs), max(r['evals_per_s'] for r in runs)]
+    run['best'] = parse_stats(os.path.join(rundir, stats_file_name))
+    return run
+
+def thread_counts(max_threads):
+    counts = []
+    t = 1
+    while t < max_threads:
+        counts.append(t)
+        t *= 2
+    counts.append(max_threads)
+    return counts
+
+def compare(results, baseline, threshold):
+    """Prints each point against the baseline; returns the number of regressions."""
+    regressions = 0
+    print()
+    for key in ['budget', 'timeout', 'algorithm', 'cpus']:
+        if results.get(key) != baseline.get(key):
+            print('WARNING: the baseline was run with %s %s, this run with %s.' % (key, baseline.get(key), results.get(key)))
+    print('Comparison with baseline:')
+    print('%-14s %7s %14s %14s %9s  %s' % ('config', 'threads', 'base evals/s', 'evals/s', 'change', 'best cost'))
+    for name, runs in results['benchmarks'].items():
+        base_runs = {run['threads']: run for run in baseline.get('benchmarks', {}).get(name, [])}
+        for run in runs:
+            base = base_runs.get(run['threads'])
+            if not base:
+                continue
+            change = run['evals_per_s'] / base['evals_per_s'] - 1
+            slower = change < -threshold
+            # The search is deterministic for a thread count, so a different
+            # best mapping means the model or the search changed.
+            metric = cost_metric(run['best'], base['best'])
+            cost = ''
+            if metric:
+                if run['best'][metric] > base['best'][metric] * (1 + 1e-9):
+                    cost = 'WORSE (%s %g -> %g)' % (metric, base['best'][metric], run['best'][metric])
+                elif run['best'][metric] < base['best'][metric] * (1 - 1e-9):
+                    cost = 'better (%s %g -> %g)' % (metric, base['best'][metric], run['best'][metric])
+                else:
+                    cost = 'same'
+            if run['mappings'] != base['mappings']:
+                cost += ', searched %d mappings instead of %d' % (run['mappings'], base['mappings'])
+            regressed = slower or cost.startswith('WORSE')
+            regressions += regressed
+            print('%-14s %7d %14.1f %14.1f %+8.1f%%  %s%s' % (name, run['threads'], base['evals_per_s'],
+                  run['evals_per_s'], 100 * change, cost, '  SLOWER' if slower else ''))
+    return regressions
+
+def cost_metric(best, base_best):
+    for metric in ['edp', 'energy_uJ', 'cycles']:
+        if metric in best and metric in base_best:
+            return metric
+    return None
+
+def main():
+    parser = argparse.ArgumentParser(
+            description='Measure timeloop-mapper search throughput and thread scaling on a fixed set of configs.')
+    parser.add_argument('--mapper', default = os.path.join(root_dir, 'build', 'timeloop-mapper'),
+            help = 'timeloop-mapper binary (default: build/timeloop-mapper)')
+    parser.add_argument('--configs', nargs = '+', default = list(benchmarks.keys()), choices = list(benchmarks.keys()),
+            help = 'benchmark configs to run (default: all)')
+    parser.add_argument('--max-threads', type = int, default = os.cpu_count(),
+            help = 'run at 1, 2, 4, ... up to this many threads (default: all cores)')
+    parser.add_argument('--budget', type = int, default = None,
+            help = 'mappings evaluated per run, valid or not, across all threads (default: per config)')
+    parser.add_argument('--timeout', type = int, default = 0,
+            help = 'consecutive invalid mappings after which a thread gives up (default: 0, never)')
+    parser.add_argument('--algorithm', default = None,
+            help = 'override the search algorithm of every config')
+    parser.add_argument('--repetitions', type = int, default = 3,
+            help = 'runs per point; the median throughput is reported (default: 3)')
+    parser.add_argument('--outdir', default = 'bench-mapper',
+            help = 'directory for configs, logs and %s (default: bench-mapper)' % results_file_name)
+    parser.add_argument('--compare', default = None,
+            help = 'baseline results to compare against; exits with status 2 on regressions')
+    parser.add_argument('--threshold', type = float, default = 0.1,
+            help = 'relative throughput drop that counts as a regression (default: 0.1)')
+    options = parser.parse_args()
+
+    # Throughput and scaling depend on the host; cpus records how many
+    # cores the thread counts were run on (more threads than cores only
+    # measure the overhead of oversubscription).
+    results = {'version': 2, 'budget': options.budget, 'timeout': options.timeout,
+               'algorithm': options.algorithm, 'repetitions': options.repetitions,
+               'cpus': os.cpu_count(), 'benchmarks': {}}
+
+    print('%-14s %7s %10s %8s %9s %12s %8s %10s  %s' % ('config', 'threads', 'mappings', 'valid', 'time (s)',
+          'evals/s', 'speedup', 'efficiency', 'best (energy uJ, cycles)'))
+    for name in options.configs:
+        runs = []
+        for threads in thread_counts(options.max_threads):
+            run = run_point(options.mapper, name, threads, options, options.outdir)
+            if not run:
+                break
+            run['speedup'] = run['evals_per_s'] / runs[0]['evals_per_s'] if runs else 1.0
+            run['efficiency'] = run['speedup'] / threads
+            runs.append(run)
+            best = run['best']
+            print('%-14s %7d %10d %8d %9.3f %12.1f %8.2f %10.2f  %g, %g' % (name, threads, run['mappings'], run['valid'],
+                  run['seconds'], run['evals_per_s'], run['speedup'], run['efficiency'],
+                  best.get('energy_uJ', float('nan')), best.get('cycles', float('nan'))))
+        results['benchmarks'][name] = runs
+
+    results_path = os.path.join(options.outdir, results_file_name)
+    with open(results_path, 'w') as f:
+        json.dump(results, f, indent = 2)
+    print('Results written to %s' % results_path)
+
+    if options.compare:
+        with open(options.compare, 'r') as f:
+            baseline = json.load(f)
+        regressions = compare(results, baseline, options.threshold)
+        if regressions:
+            print('%d regression(s).' % regressions)
+            sys.exit(2)
+
+if __name__ == '__main__':
+    main()
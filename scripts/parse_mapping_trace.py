@@ -0,0 +1,109 @@
+#! /usr/bin/env python3
+
+# Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+# 
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+# 
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+import argparse
+import array
+import pickle
+import struct
+import zlib
+
+# Output file name (see src/applications/mapper/mapping-trace.hpp).
+out_prefix = "timeloop-mapper."
+trace_file_name = out_prefix + "trace.bin"
+
+status_names = ['success', 'construction-failure', 'pre-eval-failure', 'eval-failure', 'bound-pruned']
+
+# array typecodes for each (type, size) pair of the column schema.
+typecodes = {('u', 1): 'B', ('i', 1): 'b', ('u', 4): 'I', ('u', 8): 'Q', ('f', 8): 'd'}
+
+def parse_mapping_trace(filename):
+    """Returns a dict of column name -> list, plus a 'thread_id' column."""
+    with open(filename, 'rb') as f:
+        data = f.read()
+
+    if data[:8] != b'TLTRACE\0':
+        raise ValueError('%s is not a mapping trace' % filename)
+    version, num_columns = struct.unpack_from('=II', data, 8)
+    if version != 1:
+        raise ValueError('unsupported mapping trace version %d' % version)
+
+    pos = 16
+    schema = []
+    for i in range(num_columns):
+        end = data.index(b'\0', pos)
+        name = data[pos:end].decode()
+        kind = chr(data[end + 1])
+        size = data[end + 2]
+        schema.append((name, typecodes[(kind, size)]))
+        pos = end + 3
+
+    columns = {name: array.array(code) for name, code in schema}
+    columns['thread_id'] = array.array('I')
+
+    while pos < len(data):
+        thread_id, rows, raw_bytes, compressed_bytes = struct.unpack_from('=IIQQ', data, pos)
+        pos += 24
+        raw = zlib.decompress(data[pos:pos + compressed_bytes])
+        pos += compressed_bytes
+        assert len(raw) == raw_bytes
+
+        offset = 0
+        for name, code in schema:
+            column = array.array(code)
+            column.frombytes(raw[offset:offset + rows * column.itemsize])
+            offset += rows * column.itemsize
+            columns[name].extend(column)
+        columns['thread_id'].extend([thread_id] * rows)
+
+    return {name: column.tolist() for name, column in columns.items()}
+
+def main():
+    parser = argparse.ArgumentParser(
+            description='Summarize a mapper trace, or convert it to a pickle file.')
+    parser.add_argument('infile', nargs='?', default=trace_file_name, type=str,
+            help='mapping trace written with mapper.trace = True')
+    parser.add_argument('outfile', nargs='?', default=None, type=argparse.FileType('wb'),
+            help='write the parsed columns to outfile (pickle)')
+    options = parser.parse_args()
+
+    trace = parse_mapping_trace(options.infile)
+
+    rows = len(trace['status'])
+    print('%d mappings traced.' % rows)
+    for code, name in enumerate(status_names):
+        print('  %-22s %d' % (name, trace['status'].count(code)))
+    if rows > 0:
+        print('  mean eval time %.1f us' % (sum(trace['eval_ns']) / rows / 1000))
+
+    if options.outfile:
+        with options.outfile:
+            pickle.dump(trace, options.outfile, pickle.HIGHEST_PROTOCOL)
+        print('Wrote output to %s.' % (options.outfile.name))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,559 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include <yaml-cpp/yaml.h>
+
+#include "model/engine.hpp"
+#include "model/network-factory.hpp"
+#include "mapspaces/mapspace-factory.hpp"
+#include "compound-config/compound-config.hpp"
+#include "util/alloc-tracker.hpp"
+
+//--------------------------------------------//
+//              Benchmark Runner              //
+//--------------------------------------------//
+
+// Keeps the compiler from discarding a value computed by a benchmark body.
+template <class T>
+inline void DoNotOptimize(const T& value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchResult
+{
+  std::string name;
+  std::uint64_t iterations;
+  double ns_per_op;
+  double allocs_per_op;
+  double bytes_per_op;
+};
+
+class BenchRunner
+{
+ private:
+  double min_time_;
+  unsigned repetitions_;
+  std::string filter_;
+  std::vector<BenchResult> results_;
+
+  struct Sample
+  {
+    double seconds;
+    std::uint64_t allocations;
+    std::uint64_t bytes;
+  };
+
+  Sample Time(const std::function<void(std::uint64_t)>& body, std::uint64_t iterations)
+  {
+    auto start_counts = alloc::ThreadCounts();
+    auto start = std::chrono::steady_clock::now();
+    for (std::uint64_t i = 0; i < iterations; i++)
+      body(i);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    auto counts = alloc::ThreadCounts() - start_counts;
+    return { elapsed.count(), counts.allocations, counts.bytes };
+  }
+
+ public:
+  BenchRunner(double min_time, unsigned repetitions, std::string filter) :
+      min_time_(min_time),
+      repetitions_(std::max(repetitions, 1U)),
+      filter_(filter)
+  {
+  }
+
+  // Times body(i) for i = 0, 1, ...: the iteration count is grown until a
+  // run takes min_time, and the reported ns/op is the median of the
+  // repetitions at that count. Allocation counts come from the same runs.
+  void Run(const std::string& name, const std::function<void(std::uint64_t)>& body)
+  {
+    if (!filter_.empty() && name.find(filter_) == std::string::npos)
+      return;
+
+    std::uint64_t iterations = 1;
+    auto sample = Time(body, iterations);
+    while (sample.seconds < min_time_ && iterations < (1ULL << 40))
+    {
+      double scale = sample.seconds > 0 ? 1.2 * min_time_ / sample.seconds : 100;
+      iterations = std::max(iterations + 1, std::uint64_t(iterations * std::min(scale, 100.0)));
+      sample = Time(body, iterations);
+    }
+
+    std::vector<Sample> samples = { sample };
+    while (samples.size() < repetitions_)
+      samples.push_back(Time(body, iterations));
+    std::sort(samples.begin(), samples.end(),
+              [](const Sample& a, const Sample& b) { return a.seconds < b.seconds; });
+    auto& median = samples.at(samples.size() / 2);
+
+    results_.push_back({ name, iterations, 1e9 * median.seconds / iterations,
+                         double(median.allocations) / iterations, double(median.bytes) / iterations });
+
+    auto& result = results_.back();
+    std::cout << std::left << std::setw(64) << name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(14) << result.ns_per_op
+              << std::setprecision(2) << std::setw(12) << result.allocs_per_op
+              << std::setprecision(0) << std::setw(12) << result.bytes_per_op << std::endl;
+  }
+
+  const std::vector<BenchResult>& Results() const { return results_; }
+
+  static void PrintHeader()
+  {
+    std::cout << std::left << std::setw(64) << "benchmark" << std::right << std::setw(14) << "ns/op"
+              << std::setw(12) << "allocs/op" << std::setw(12) << "bytes/op" << std::endl;
+  }
+
+  void WriteJSON(const std::string& file_name) const
+  {
+    std::ofstream out(file_name);
+    out << std::setprecision(6);
+    out << "{" << std::endl
+        << "  \"version\": 1," << std::endl
+        << "  \"min_time_s\": " << min_time_ << "," << std::endl
+        << "  \"repetitions\": " << repetitions_ << "," << std::endl
+        << "  \"benchmarks\": [" << std::endl;
+    for (unsigned i = 0; i < results_.size(); i++)
+    {
+      auto& result = results_.at(i);
+      out << "    {\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+          << ", \"ns_per_op\": " << result.ns_per_op << ", \"allocs_per_op\": " << result.allocs_per_op
+          << ", \"bytes_per_op\": " << result.bytes_per_op << "}"
+          << (i + 1 < results_.size() ? "," : "") << std::endl;
+    }
+    out << "  ]" << std::endl << "}" << std::endl;
+  }
+
+  // Compare against a JSON file written by an earlier run. Returns the
+  // number of benchmarks that got slower than the threshold.
+  unsigned Compare(const std::string& file_name, double threshold) const
+  {
+    YAML::Node baseline;
+    try
+    {
+      baseline = YAML::LoadFile(file_name);
+    }
+    catch (const YAML::Exception& e)
+    {
+      std::cerr << "ERROR: cannot read benchmark baseline " << file_name << ": " << e.what() << std::endl;
+      exit(1);
+    }
+
+    std::map<std::string, YAML::Node> baseline_results;
+    auto benchmarks = baseline["benchmarks"];
+    for (std::size_t i = 0; i < benchmarks.size(); i++)
+      baseline_results[benchmarks[i]["name"].as<std::string>()] = benchmarks[i];
+
+    std::cout << std::endl << "Comparison with " << file_name << ":" << std::endl;
+    std::cout << std::left << std::setw(64) << "benchmark" << std::right << std::setw(14) << "base ns/op"
+              << std::setw(14) << "ns/op" << std::setw(10) << "change" << std::setw(14) << "allocs/op"
+              << std::endl;
+
+    unsigned regressions = 0;
+    for (auto& result : results_)
+    {
+      auto it = baseline_results.find(result.name);
+      if (it == baseline_results.end())
+        continue;
+
+      double base_ns = it->second["ns_per_op"].as<double>();
+      double base_allocs = it->second["allocs_per_op"].as<double>();
+      double change = base_ns > 0 ? result.ns_per_op / base_ns - 1 : 0;
+      bool regressed = change > threshold;
+      regressions += regressed;
+
+      std::ostringstream allocs;
+      allocs << std::fixed << std::setprecision(2) << base_allocs << "->" << result.allocs_per_op;
+      std::cout << std::left << std::setw(64) << result.name << std::right << std::fixed
+                << std::setprecision(1) << std::setw(14) << base_ns << std::setw(14) << result.ns_per_op
+                << std::setw(9) << std::showpos << 100 * change << std::noshowpos << "%"
+                << std::setw(14) << allocs.str() << (regressed ? "  SLOWER" : "") << std::endl;
+    }
+
+    return regressions;
+  }
+};
+
+//--------------------------------------------//
+//                Application                 //
+//--------------------------------------------//
+
+// Microbenchmarks for the hot paths of the analysis and the model, on fixed
+// inputs: the workload, architecture and mapspace of each config, and a
+// deterministic set of mappings drawn from that mapspace. Uniformly drawn
+// mappings rarely fit the buffers, so the set is topped up with mappings that
+// fail capacity checks; all evaluations run with break_on_failure off, so
+// those do the same work as valid ones.
+
+class Application
+{
+ public:
+  // Number of distinct mappings the per-mapping benchmarks rotate through,
+  // and the number of mapping IDs drawn to find them.
+  static const unsigned kNumMappings = 32;
+  static const unsigned kNumAttempts = 2000;
+
+ private:
+  config::CompoundConfig* config_;
+  std::string name_;
+  problem::Workload workload_;
+  model::Engine::Specs arch_specs_;
+  mapspace::MapSpace* mapspace_ = nullptr;
+
+  std::vector<mapspace::ID> mapping_ids_;
+  std::vector<Mapping> mappings_;
+  unsigned num_valid_mappings_ = 0;
+
+  static std::string NetworkClass(std::shared_ptr<model::Network> network)
+  {
+    if (std::dynamic_pointer_cast<model::LegacyNetwork>(network))
+      return "Legacy";
+    else if (std::dynamic_pointer_cast<model::ReductionTreeNetwork>(network))
+      return "ReductionTree";
+    else
+      return "SimpleMulticast";
+  }
+
+ public:
+  Application(config::CompoundConfig* config, std::string name) :
+      config_(config),
+      name_(name)
+  {
+    auto rootNode = config->getRoot();
+
+    auto problem = rootNode.lookup("problem");
+    problem::ParseWorkload(problem, workload_);
+
+    config::CompoundConfigNode arch;
+    if (rootNode.exists("arch"))
+      arch = rootNode.lookup("arch");
+    else if (rootNode.exists("architecture"))
+      arch = rootNode.lookup("architecture");
+    arch_specs_ = model::Engine::ParseSpecs(arch);
+
+    if (rootNode.exists("ERT"))
+      arch_specs_.topology.ParseAccelergyERT(rootNode.lookup("ERT"));
+
+    config::CompoundConfigNode arch_constraints;
+    config::CompoundConfigNode mapspace;
+    if (arch.exists("constraints"))
+      arch_constraints = arch.lookup("constraints");
+    else if (rootNode.exists("arch_constraints"))
+      arch_constraints = rootNode.lookup("arch_constraints");
+    else if (rootNode.exists("architecture_constraints"))
+      arch_constraints = rootNode.lookup("architecture_constraints");
+    if (rootNode.exists("mapspace"))
+      mapspace = rootNode.lookup("mapspace");
+    else if (rootNode.exists("mapspace_constraints"))
+      mapspace = rootNode.lookup("mapspace_constraints");
+
+    mapspace_ = mapspace::ParseAndConstruct(mapspace, arch_constraints, arch_specs_, workload_);
+
+    // Draw mapping IDs with a fixed-seed generator and keep the ones that
+    // construct, valid ones first.
+    model::Engine engine;
+    engine.Spec(arch_specs_);
+    std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+    auto next = [&state]()
+    {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      return state;
+    };
+    std::vector<mapspace::ID> invalid_ids;
+    std::vector<Mapping> invalid_mappings;
+    for (unsigned attempt = 0; attempt < kNumAttempts && mappings_.size() < kNumMappings; attempt++)
+    {
+      mapspace::ID id(mapspace_->AllSizes());
+      for (int dim = 0; dim < int(mapspace::Dimension::Num); dim++)
+      {
+        uint128_t value = (uint128_t(next()) << 64) | next();
+        id.Set(dim, value % mapspace_->Size(mapspace::Dimension(dim)));
+      }
+
+      Mapping mapping;
+      if (!mapspace_->ConstructMapping(id, &mapping))
+        continue;
+
+      auto status = engine.Evaluate(mapping, workload_);
+      if (std::all_of(status.begin(), status.end(), [](const model::EvalStatus& s) { return s.success; }))
+      {
+        mapping_ids_.push_back(id);
+        mappings_.push_back(mapping);
+      }
+      else if (invalid_mappings.size() < kNumMappings)
+      {
+        invalid_ids.push_back(id);
+        invalid_mappings.push_back(mapping);
+      }
+    }
+    num_valid_mappings_ = mappings_.size();
+    for (unsigned i = 0; i < invalid_mappings.size() && mappings_.size() < kNumMappings; i++)
+    {
+      mapping_ids_.push_back(invalid_ids.at(i));
+      mappings_.push_back(invalid_mappings.at(i));
+    }
+
+    if (mappings_.empty())
+    {
+      std::cerr << "ERROR: " << name_ << ": could not construct any mappings for benchmarking." << std::endl;
+      exit(1);
+    }
+    std::cout << name_ << ": " << mappings_.size() << " mappings (" << num_valid_mappings_
+              << " valid)" << std::endl;
+  }
+
+  // This class does not support being copied
+  Application(const Application&) = delete;
+  Application& operator=(const Application&) = delete;
+
+  ~Application()
+  {
+    if (mapspace_)
+      delete mapspace_;
+  }
+
+  void Run(BenchRunner& runner)
+  {
+    auto num_mappings = mappings_.size();
+    auto& shape = *problem::GetShape();
+
+    //
+    // Point sets and operation spaces: a tile spanning half of every
+    // dimension and its neighbor along the largest dimension, i.e., the
+    // sliding window that delta computations see.
+    //
+    unsigned slide_dim = 0;
+    for (unsigned dim = 0; dim < shape.NumDimensions; dim++)
+      if (workload_.GetBound(dim) > workload_.GetBound(slide_dim))
+        slide_dim = dim;
+
+    problem::OperationPoint low, high;
+    for (unsigned dim = 0; dim < shape.NumDimensions; dim++)
+      high[dim] = std::max(workload_.GetBound(dim) / 2 - 1, 0);
+    problem::OperationPoint next_low = low, next_high = high;
+    next_low[slide_dim] += workload_.GetBound(slide_dim) / 2;
+    next_high[slide_dim] += workload_.GetBound(slide_dim) / 2;
+
+    problem::OperationSpace tile(&workload_, low, high);
+    problem::OperationSpace next_tile(&workload_, next_low, next_high);
+
+    std::vector<problem::DataSpace> tiles, next_tiles;
+    for (unsigned pv = 0; pv < shape.NumDataSpaces; pv++)
+    {
+      tiles.push_back(tile.GetDataSpace(pv));
+      next_tiles.push_back(next_tile.GetDataSpace(pv));
+    }
+    auto num_data_spaces = tiles.size();
+
+    runner.Run(name_ + "/aahr/copy", [&](std::uint64_t i)
+               {
+                 problem::DataSpace copy(tiles[i % num_data_spaces]);
+                 DoNotOptimize(copy);
+               });
+    runner.Run(name_ + "/aahr/add", [&](std::uint64_t i)
+               {
+                 problem::DataSpace sum(tiles[i % num_data_spaces]);
+                 sum += next_tiles[i % num_data_spaces];
+                 DoNotOptimize(sum);
+               });
+    runner.Run(name_ + "/aahr/difference", [&](std::uint64_t i)
+               {
+                 auto delta = next_tiles[i % num_data_spaces] - tiles[i % num_data_spaces];
+                 DoNotOptimize(delta);
+               });
+    runner.Run(name_ + "/aahr/size", [&](std::uint64_t i)
+               {
+                 DoNotOptimize(tiles[i % num_data_spaces].size());
+               });
+
+    runner.Run(name_ + "/operation-space/construct", [&](std::uint64_t)
+               {
+                 problem::OperationSpace space(&workload_, low, high);
+                 DoNotOptimize(space);
+               });
+    runner.Run(name_ + "/operation-space/project-point", [&](std::uint64_t i)
+               {
+                 problem::OperationPoint point = low;
+                 point[slide_dim] = i % (high[slide_dim] + 1);
+                 problem::OperationSpace space(&workload_);
+                 space += point;
+                 DoNotOptimize(space);
+               });
+
+    //
+    // Nest analysis, tiling and per-level evaluation of the fixed mappings.
+    //
+    model::Engine engine;
+    engine.Spec(arch_specs_);
+    auto& topology = engine.GetTopology();
+    unsigned num_storage_levels = arch_specs_.topology.NumStorageLevels();
+    auto storage_level_names = arch_specs_.topology.StorageLevelNames();
+
+    analysis::NestAnalysis analysis;
+    runner.Run(name_ + "/nest-analysis/working-sets", [&](std::uint64_t i)
+               {
+                 analysis.Init(&workload_, &mappings_[i % num_mappings].loop_nest);
+                 DoNotOptimize(analysis.GetWorkingSets());
+               });
+
+    std::vector<problem::PerDataSpace<std::vector<tiling::TileInfo>>> working_sets;
+    std::vector<model::Topology::TiledMapping> tiled_mappings;
+    for (auto& mapping : mappings_)
+    {
+      analysis.Init(&workload_, &mapping.loop_nest);
+      working_sets.push_back(analysis.GetWorkingSets());
+      tiled_mappings.push_back(topology.TileMapping(mapping, &analysis));
+    }
+    tiling::CompoundMaskNest distribution_supported(tiled_mappings.front().distribution_supported);
+
+    runner.Run(name_ + "/tiling/collapse-tiles", [&](std::uint64_t i)
+               {
+                 auto collapsed = tiling::CollapseTiles(working_sets[i % num_mappings], num_storage_levels,
+                                                        mappings_[i % num_mappings].datatype_bypass_nest,
+                                                        distribution_supported);
+                 DoNotOptimize(collapsed);
+               });
+
+    // Networks to benchmark: class, label, network and the level whose tiles
+    // it is fed.
+    std::vector<std::tuple<std::string, std::string, std::shared_ptr<model::Network>, unsigned>> networks;
+    std::set<std::string> network_classes;
+    for (unsigned level = 0; level < num_storage_levels; level++)
+    {
+      auto buffer = std::static_pointer_cast<model::BufferLevel>(topology.GetStorageLevelModule(level).Clone());
+      runner.Run(name_ + "/buffer/" + storage_level_names.at(level) + "/evaluate", [&](std::uint64_t i)
+                 {
+                   auto& tiled = tiled_mappings[i % num_mappings];
+                   auto status = buffer->Evaluate(tiled.tiles[level], tiled.keep_masks[level],
+                                                  tiled.compute_cycles, false);
+                   DoNotOptimize(status);
+                 });
+
+      if (auto network = buffer->GetReadNetwork())
+      {
+        std::string network_class = NetworkClass(network);
+        networks.emplace_back(network_class, storage_level_names.at(level), network->Clone(), level);
+        network_classes.insert(network_class);
+      }
+    }
+
+    // Networks of the classes the configs do not instantiate are built with
+    // default specs and fed the tiles of the level with the largest fanout.
+    unsigned fanout_level = 0;
+    std::uint64_t max_fanout = 0;
+    for (unsigned level = 0; level < num_storage_levels; level++)
+      for (auto& data_space_tile : tiled_mappings.front().tiles[level])
+        if (data_space_tile.fanout > max_fanout)
+        {
+          max_fanout = data_space_tile.fanout;
+          fanout_level = level;
+        }
+
+    for (std::string network_class : { "Legacy", "ReductionTree", "SimpleMulticast" })
+    {
+      if (network_classes.count(network_class))
+        continue;
+      YAML::Node network_yaml;
+      network_yaml["class"] = network_class;
+      network_yaml["name"] = "bench-" + network_class;
+      if (network_class == "SimpleMulticast")
+        network_yaml["action_name"] = "transfer";
+      auto specs = model::NetworkFactory::ParseSpecs(config::CompoundConfigNode(nullptr, network_yaml, config_), 1);
+      if (network_class == "SimpleMulticast")
+      {
+        YAML::Node ert;
+        ert["transfer"]["energy"] = 1.0;
+        std::static_pointer_cast<model::SimpleMulticastNetwork::Specs>(specs)->accelergyERT =
+          config::CompoundConfigNode(nullptr, ert, config_);
+      }
+      auto network = model::NetworkFactory::Construct(specs);
+      network->AddConnectionType(network_class == "ReductionTree" ? model::UpdateDrain
+                                                                  : model::ReadFill);
+      // Standalone networks are not floorplanned; any tile width will do.
+      network->SetTileWidth(1.0);
+      networks.emplace_back(network_class, "default", network, fanout_level);
+    }
+
+    for (auto& entry : networks)
+    {
+      auto network = std::get<2>(entry);
+      auto level = std::get<3>(entry);
+
+      // Networks that are not reset between evaluations bypass the
+      // evaluation memo (SimpleMulticast only) and always run the full model.
+      runner.Run(name_ + "/network/" + std::get<0>(entry) + "/" + std::get<1>(entry) + "/evaluate",
+                 [&](std::uint64_t i)
+                 {
+                   auto status = network->Evaluate(tiled_mappings[i % num_mappings].tiles[level], false);
+                   DoNotOptimize(status);
+                 });
+
+      if (std::get<0>(entry) != "SimpleMulticast")
+        continue;
+
+      // Reset first, as Topology::Evaluate() does, so that after a first pass
+      // over the mappings evaluations are served by the memo.
+      auto memoized = network->Clone();
+      runner.Run(name_ + "/network/" + std::get<0>(entry) + "/" + std::get<1>(entry) + "/memoized",
+                 [&](std::uint64_t i)
+                 {
+                   memoized->Reset();
+                   auto status = memoized->Evaluate(tiled_mappings[i % num_mappings].tiles[level], false);
+                   DoNotOptimize(status);
+                 });
+    }
+
+    //
+    // Mapspace and end-to-end evaluation.
+    //
+    runner.Run(name_ + "/uber/construct-mapping", [&](std::uint64_t i)
+               {
+                 Mapping mapping;
+                 DoNotOptimize(mapspace_->ConstructMapping(mapping_ids_[i % num_mappings], &mapping));
+               });
+    runner.Run(name_ + "/engine/evaluate", [&](std::uint64_t i)
+               {
+                 DoNotOptimize(engine.Evaluate(mappings_[i % num_mappings], workload_, false));
+               });
+  }
+};
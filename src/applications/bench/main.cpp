@@ -0,0 +1,123 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <iostream>
+
+#include "bench.hpp"
+#include "compound-config/compound-config.hpp"
+#include "util/args.hpp"
+
+bool gTerminateEval = false;
+
+//--------------------------------------------//
+//                    MAIN                    //
+//--------------------------------------------//
+
+// Usage: timeloop-bench [-o <odir>] [--filter <substring>] [--min-time <seconds>]
+//                       [--repetitions <n>] [--compare <baseline.json>]
+//                       [--threshold <fraction>] [<config>...]
+//
+// Runs the microbenchmarks on each config (by default, the sample and
+// chen-asplos2014 mapper configs) and writes the results to
+// <odir>/timeloop-bench.json. With --compare, also prints the change against
+// a previous run's JSON and exits with status 2 if any benchmark got slower
+// by more than the threshold (default 0.1).
+int main(int argc, char* argv[])
+{
+  std::vector<std::string> args;
+  std::string output_dir = ".";
+  bool success = ParseArgs(argc, argv, args, output_dir);
+  if (!success)
+  {
+    std::cerr << "ERROR: error parsing command line." << std::endl;
+    exit(1);
+  }
+
+  std::string filter;
+  std::string baseline_file;
+  double min_time = 0.2;
+  double threshold = 0.1;
+  unsigned repetitions = 3;
+  std::vector<std::string> input_files;
+  for (auto arg = args.begin(); arg != args.end(); arg++)
+  {
+    bool has_value = (arg + 1 != args.end());
+    if (*arg == "--filter" && has_value)
+      filter = *++arg;
+    else if (*arg == "--min-time" && has_value)
+      min_time = std::stod(*++arg);
+    else if (*arg == "--repetitions" && has_value)
+      repetitions = std::stoul(*++arg);
+    else if (*arg == "--compare" && has_value)
+      baseline_file = *++arg;
+    else if (*arg == "--threshold" && has_value)
+      threshold = std::stod(*++arg);
+    else if (arg->compare(0, 2, "--") == 0)
+    {
+      std::cerr << "ERROR: unrecognized or incomplete option: " << *arg << std::endl;
+      exit(1);
+    }
+    else
+      input_files.push_back(*arg);
+  }
+
+  if (input_files.empty())
+  {
+    const char* timeloopdir = std::getenv("TIMELOOP_DIR");
+    if (!timeloopdir)
+    {
+      timeloopdir = BUILD_BASE_DIR;
+    }
+    input_files = { std::string(timeloopdir) + "/configs/mapper/sample.yaml",
+                    std::string(timeloopdir) + "/configs/mapper/chen-asplos2014.yaml" };
+  }
+
+  BenchRunner runner(min_time, repetitions, filter);
+  BenchRunner::PrintHeader();
+
+  for (auto& input_file : input_files)
+  {
+    // Benchmarks are named after their config file.
+    std::string name = input_file.substr(input_file.find_last_of('/') + 1);
+    name = name.substr(0, name.find_last_of('.'));
+
+    auto config = new config::CompoundConfig(input_file.c_str());
+    Application application(config, name);
+    application.Run(runner);
+    delete config;
+  }
+
+  std::string json_file_name = output_dir + "/timeloop-bench.json";
+  runner.WriteJSON(json_file_name);
+  std::cout << "Results written to " << json_file_name << std::endl;
+
+  if (!baseline_file.empty() && runner.Compare(baseline_file, threshold) > 0)
+    return 2;
+
+  return 0;
+}
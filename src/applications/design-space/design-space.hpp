@@ -30,6 +30,10 @@
 #include <fstream>
 #include <iomanip>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <sys/stat.h>
 
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/array.hpp>
@@ -37,39 +41,18 @@
 #include <boost/serialization/bitset.hpp>
 
 #include "compound-config/compound-config.hpp"
+#include "util/arch-space.hpp"
 
 #include "problem.hpp"
-#include "arch.hpp"
+#include "scheduler.hpp"
+#include "store.hpp"
+#include "pruning.hpp"
 //#include "simple-mapper.hpp"
 #include "../mapper/mapper.hpp"
 #include <vector>
 
 using namespace config;
 
-struct PointResult
-{
-  std::string config_name_;
-  //Mapping best_mapping_; can't be used due to bug
-  EvaluationResult result_;
-  
-  PointResult(std::string name, EvaluationResult result) : config_name_(name), result_(result) {}
-  
-  void PrintEvaluationResultsHeader(std::ostream& out)
-  {
-      out << "Summary stats for best mapping found by mapper:" << std::endl; 
-      out << "config_name, MACCs, utilization, pj/MACC" << std::endl;
-  }
-
-  void PrintEvaluationResult(std::ostream& out)
-  {
-      out << config_name_ ; 
-      out << ", " << result_.stats.maccs;
-      out << ", " << std::setw(4) << std::fixed << std::setprecision(2) << result_.stats.utilization;
-      out << ", " << std::setw(8) << std::fixed << std::setprecision(3) << result_.stats.energy / result_.stats.maccs << std::endl;
-  }
-
-};
-
 //--------------------------------------------//
 //                Application                 //
 //--------------------------------------------//
@@ -83,10 +66,53 @@ class DesignSpaceExplorer
   std::string archspec_filename_;
 
   std::vector<PointResult> designs_;
-  std::vector<Application*> mappers_;
 
  public:
 
+  // Problems with equal keys share a problem shape.
+  static std::string ShapeKey(ProblemSpaceNode& problem)
+  {
+    YAML::Node shape = problem.yaml_["problem"] ? problem.yaml_["problem"]["shape"] : problem.yaml_["shape"];
+    return shape ? YAML::Dump(shape) : std::string();
+  }
+
+  // Thread count fixed by the point's own mapper config, 0 if unset.
+  static unsigned PinnedThreads(config::CompoundConfig& config)
+  {
+    unsigned threads = 0;
+    auto root = config.getRoot();
+    if (root.exists("mapper"))
+      root.lookup("mapper").lookupValue("num-threads", threads);
+    return threads;
+  }
+
+  // The (at most) max_neighbors points before point i in sweep order that
+  // are nearest to it in the arch sweep and share its problem, closest
+  // first. Only the sweep decides them, never which points have finished,
+  // so warm starts do not depend on scheduling.
+  static std::vector<std::size_t> Neighbors(ArchSpace& aspec_space,
+                                            const std::vector<std::pair<int, int>>& points,
+                                            std::size_t i, unsigned max_neighbors)
+  {
+    auto& arch = aspec_space.GetNode(points[i].first);
+
+    std::vector<std::pair<double, std::size_t>> neighbors;
+    for (std::size_t j = 0; j < i; j++)
+    {
+      if (points[j].second != points[i].second)
+        continue;
+      double distance = arch.Distance(aspec_space.GetNode(points[j].first));
+      if (distance != std::numeric_limits<double>::infinity())
+        neighbors.push_back({ distance, j });
+    }
+    std::sort(neighbors.begin(), neighbors.end());
+
+    std::vector<std::size_t> nearest;
+    for (std::size_t n = 0; n < neighbors.size() && n < max_neighbors; n++)
+      nearest.push_back(neighbors[n].second);
+    return nearest;
+  }
+
   DesignSpaceExplorer(std::string problemfile, std::string archfile)
   {
     problemspec_filename_ = problemfile;
@@ -141,56 +167,298 @@ class DesignSpaceExplorer
     
     std::cout << "*** total arch: " << aspec_space.GetSize() << "   total prob: " << pspec_space.GetSize() << std::endl;        
 
+    // Optional scheduler settings, read from the arch space file.
+    unsigned thread_budget = std::thread::hardware_concurrency();
+    std::uint64_t mappings_per_thread = 1 << 16;
+    if (auto sched = aspec_yaml["scheduler"])
+    {
+      if (sched["threads"])
+        thread_budget = sched["threads"].as<unsigned>();
+      if (sched["mappings-per-thread"])
+        mappings_per_thread = sched["mappings-per-thread"].as<std::uint64_t>();
+    }
+    DSEScheduler scheduler(thread_budget, mappings_per_thread);
+    std::cout << "*** thread budget: " << scheduler.Budget() << std::endl;
+
+    mkdir("results", 0755);
+    std::string result_filename =  "overview_" + archspec_filename_ + problemspec_filename_ + ".txt";
+    replace(result_filename.begin(),result_filename.end(),'/', '.'); 
+
+    // Finished points are persisted to the result store as they complete;
+    // points already in the store (from an earlier, possibly interrupted
+    // run) are not re-run.
+    std::string store_filename = "results/dse-store.csv";
+    if (aspec_yaml["result-store"])
+      store_filename = aspec_yaml["result-store"].as<std::string>();
+    ResultStore store(store_filename);
+    std::cout << "*** result store: " << store_filename << " (" << store.Size() << " points)" << std::endl;
+
+    // Warm start: seed each point's search with the best mappings of up to
+    // this many nearest sweep neighbors (same problem) that come before it
+    // in sweep order. A point waits for those neighbors to finish, which
+    // keeps results independent of scheduling but limits how many points of
+    // a problem run at once.
+    unsigned warm_start_neighbors = 0;
+    if (aspec_yaml["warm-start"])
+      warm_start_neighbors = aspec_yaml["warm-start"].as<unsigned>();
+    std::cout << "*** warm-start neighbors: " << warm_start_neighbors << std::endl;
+
+    // Dominance pruning: skip points whose cheap bounds show they cannot
+    // fit the budgets or beat an already-finished point (see pruning.hpp).
+    DominancePruner pruner(aspec_yaml["pruning"]);
+    std::cout << "*** dominance pruning: " << (pruner.Enabled() ? "on" : "off") << std::endl;
+
+    // Sweep-level settings that change what a point's search finds are part
+    // of the store key, next to the point's own arch+problem config (which
+    // carries its mapper settings). The thread budget is the resolved one,
+    // since its default depends on the host. Pruning settings are left out:
+    // they decide whether a point runs, not what it finds, and pruned points
+    // are never stored.
+    YAML::Node search_settings;
+    search_settings["threads"] = scheduler.Budget();
+    search_settings["mappings-per-thread"] = mappings_per_thread;
+    search_settings["warm-start"] = warm_start_neighbors;
+
+    // Completed points are also streamed to the overview file (and stdout) as
+    // they finish; the file is rewritten in point order once everything is done.
+    std::mutex stream_mutex;
+    std::ofstream stream_file("results/" + result_filename);
+    PointResult::PrintEvaluationResultsHeader(stream_file);
+    stream_file.flush();
+
     std::cout << "****** SOLVING ******" << std::endl;        
     //main loop, do the full product of problems x arches
+    std::vector<std::pair<int, int>> points;
     for (int arch_id = 0; arch_id < aspec_space.GetSize(); arch_id ++)
+      for (int problem_id = 0; problem_id < pspec_space.GetSize(); problem_id ++)
+        points.push_back({ arch_id, problem_id });
+
+    // The problem shape is process-global state (see workload.hpp). Building
+    // a mapper for a problem of the current shape leaves it untouched, so
+    // points are constructed just before they launch while earlier points
+    // run; a shape change waits for every running point to finish first.
+    designs_.assign(points.size(), PointResult());
+    // Points whose result is final (finished, pruned or from the store);
+    // warm-started points wait on this for their neighbors.
+    std::vector<bool> point_done(points.size(), false);
+    std::condition_variable point_done_cv;
+    double total_startup_ms = 0;
+    double total_search_ms = 0;
+    double total_time_to_best_ms = 0;
+    std::uint64_t total_bound_pruned = 0;
+    std::size_t num_seeded = 0;
+    std::size_t num_started = 0;
+    std::map<unsigned, std::size_t> num_started_by_threads;
+    std::size_t num_skipped = 0;
+    std::size_t num_pruned = 0;
+    std::string running_shape;
+
+    auto record_pruned = [&](std::size_t i, const std::string& config_name,
+                             const PointBounds& bounds, const std::string& reason)
+    {
+      PointResult result;
+      result.config_name_ = config_name;
+      result.maccs_ = bounds.maccs;
+      result.area_ = bounds.area;
+      result.pruned_ = reason;
+
+      // Pruned points are not persisted: whether a point is pruned depends on
+      // the pruning settings and on which points have finished, neither of
+      // which is part of the store key. A resumed sweep re-checks them.
+      std::lock_guard<std::mutex> lock(stream_mutex);
+      designs_.at(i) = result;
+      point_done.at(i) = true;
+      point_done_cv.notify_all();
+      num_pruned++;
+      std::cout << "*** pruned config : ";
+      result.PrintEvaluationResult(std::cout);
+      result.PrintEvaluationResult(stream_file);
+      stream_file.flush();
+    };
+
+    for (std::size_t i = 0; i < points.size(); i++)
     {
       //retrieved via reference
-      ArchSpaceNode curr_arch = aspec_space.GetNode(arch_id);
+      ArchSpaceNode curr_arch = aspec_space.GetNode(points[i].first);
+      ProblemSpaceNode curr_problem = pspec_space.GetNode(points[i].second);
 
-      std::cout << "*** working on arch : " << curr_arch.name_ << "  " << arch_id << std::endl;        
+      // use problem and arch to run a mapper
+      std::string config_name = curr_arch.name_ + "--" + curr_problem.name_;
+      replace(config_name.begin(),config_name.end(),'/', '.'); 
 
-      for (int problem_id = 0; problem_id < pspec_space.GetSize(); problem_id ++)
+      std::vector<YAML::Node> point_yaml = { curr_arch.yaml_, curr_problem.yaml_ };
+      std::uint64_t hash = ResultStore::ConfigHash({ curr_arch.yaml_, curr_problem.yaml_, search_settings });
+      if (auto stored = store.Find(hash))
       {
-        //retrieved via reference
-        ProblemSpaceNode curr_problem = pspec_space.GetNode(problem_id);
-        
-        // use problem and arch to run a mapper
-        std::string config_name = curr_arch.name_ + "--" + curr_problem.name_;
-        std::cout << "*** working on config : " << config_name << std::endl;        
-        replace(config_name.begin(),config_name.end(),'/', '.'); 
-
-        std::string file_name = "results/" + config_name;
-
-        //output the two yaml to a single file
-        //CompoundConfigNode arch = CompoundConfigNode(nullptr, YAML::Clone(curr_arch.yaml_));
-        //CompoundConfigNode problem = CompoundConfigNode(nullptr, YAML::Clone(curr_problem.yaml_));
-        std::ofstream combined_yaml_file("temp_dse.yaml");
-        combined_yaml_file << curr_arch.yaml_ << std::endl; // <------------ HERE.
-        combined_yaml_file << curr_problem.yaml_ << std::endl; // <------------ HERE.
-        combined_yaml_file.close();
-        //pull tempfile into a compound config
-        config::CompoundConfig config("temp_dse.yaml");
-
-        //std::cout << "arch yaml: \n" << curr_arch.yaml_ << std::endl;
-        Application* mapper = new Application(&config, file_name);
-        //SimpleMapper mapper = SimpleMapper(config_name, arch, problem);
-        mapper->Run();
-        PointResult result(mapper->name_, mapper->GetGlobalBest());
-        mappers_.push_back(mapper);
-        designs_.push_back(result);
-    std::cout << "*** total arch: " << aspec_space.GetSize() << "   total prob: " << pspec_space.GetSize() << std::endl;        
-        
+        std::cout << "*** skipping config (already in result store) : " << config_name << std::endl;
+        std::lock_guard<std::mutex> lock(stream_mutex);
+        designs_.at(i) = *stored;
+        designs_.at(i).config_name_ = config_name;
+        point_done.at(i) = true;
+        pruner.Record(points[i].second, designs_.at(i));
+        num_skipped++;
+        continue;
+      }
+
+      std::string shape = ShapeKey(curr_problem);
+      if (num_started > 0 && shape != running_shape)
+        scheduler.Drain();
+      running_shape = shape;
+
+      std::cout << "*** working on config : " << config_name << std::endl;        
+      std::string file_name = "results/" + config_name;
+      // The mapper writes its outputs, and Accelergy its inputs, here.
+      mkdir(file_name.c_str(), 0755);
+
+      auto startup_begin = std::chrono::steady_clock::now();
+
+      // Compose the arch and problem directly into a compound config.
+      config::CompoundConfig config(point_yaml);
+
+      Application* mapper = new Application(&config, file_name, "timeloop-mapper", true);
+
+      PointBounds bounds;
+      if (num_started == 0)
+        pruner.SetOptimizationMetrics(mapper->GetOptimizationMetrics());
+      if (pruner.Enabled())
+      {
+        bounds = PointBounds::Compute(mapper->GetArchSpecs(), mapper->GetWorkload(),
+                                      mapper->GetMapSpace()->KeptMasks());
+        std::string reason = pruner.Check(points[i].second, bounds);
+        if (!reason.empty())
+        {
+          delete mapper;
+          record_pruned(i, config_name, bounds, reason);
+          continue;
+        }
       }
+
+      unsigned threads = scheduler.ThreadsFor(mapper->GetMapSpace(), mapper->TotalSearchSize(),
+                                              PinnedThreads(config));
+      mapper->InitSearch(threads);
+
+      std::vector<std::size_t> neighbors;
+      if (warm_start_neighbors > 0)
+        neighbors = Neighbors(aspec_space, points, i, warm_start_neighbors);
+
+      double startup_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - startup_begin).count();
+      total_startup_ms += startup_ms;
+      num_started++;
+      num_started_by_threads[threads]++;
+      std::cout << "*** startup for config : " << config_name << " " << std::fixed
+                << std::setprecision(3) << startup_ms << " ms, " << threads << " mapper threads"
+                << std::endl;
+
+      scheduler.Launch(threads, [&, mapper, config_name, hash, i, bounds, neighbors]()
+                       {
+                         // Seed from the neighbors' final results, which
+                         // may come from the store. They are earlier in
+                         // sweep order, so they have all been launched.
+                         if (warm_start_neighbors > 0)
+                         {
+                           std::vector<Mapping> seeds;
+                           {
+                             std::unique_lock<std::mutex> lock(stream_mutex);
+                             for (auto j : neighbors)
+                             {
+                               point_done_cv.wait(lock, [&] { return bool(point_done.at(j)); });
+                               Mapping seed;
+                               if (PointResult::DecodeMapping(designs_.at(j).mapping_, seed))
+                                 seeds.push_back(seed);
+                             }
+                           }
+                           unsigned num_seeds = mapper->Seed(seeds);
+                           std::lock_guard<std::mutex> lock(stream_mutex);
+                           std::cout << "*** warm start for config : " << config_name << " " << num_seeds
+                                     << " of " << seeds.size() << " neighbor mappings valid" << std::endl;
+                           if (num_seeds > 0)
+                             num_seeded++;
+                         }
+
+                         // Points that finished while this one waited for
+                         // threads may dominate it by now.
+                         if (pruner.Enabled())
+                         {
+                           std::string reason = pruner.Check(points[i].second, bounds);
+                           if (!reason.empty())
+                           {
+                             delete mapper;
+                             record_pruned(i, config_name, bounds, reason);
+                             return;
+                           }
+                         }
+
+                         auto search_begin = std::chrono::steady_clock::now();
+                         mapper->Run();
+                         double search_ms = std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - search_begin).count();
+                         double time_to_best_ms = mapper->TimeToBestMs();
+                         std::uint64_t bound_pruned = mapper->NumBoundPruned();
+                         auto best = mapper->GetGlobalBest();
+                         PointResult result(config_name, best);
+                         delete mapper;
+                         pruner.Record(points[i].second, result);
+
+                         std::lock_guard<std::mutex> lock(stream_mutex);
+                         designs_.at(i) = result;
+                         point_done.at(i) = true;
+                         point_done_cv.notify_all();
+                         store.Append(hash, result);
+                         total_search_ms += search_ms;
+                         total_time_to_best_ms += time_to_best_ms;
+                         total_bound_pruned += bound_pruned;
+                         std::cout << "*** search for config : " << config_name << " " << std::fixed
+                                   << std::setprecision(3) << search_ms << " ms, best found after "
+                                   << time_to_best_ms << " ms" << std::endl;
+                         std::cout << "*** completed config : ";
+                         result.PrintEvaluationResult(std::cout);
+                         result.PrintEvaluationResult(stream_file);
+                         stream_file.flush();
+                       });
     }
+    scheduler.Drain();
+    stream_file.close();
 
-    
+    std::cout << "*** total arch: " << aspec_space.GetSize() << "   total prob: " << pspec_space.GetSize()
+              << "   skipped: " << num_skipped << "   pruned: " << num_pruned << std::endl;        
+    if (num_started > 0)
+    {
+      std::cout << "*** per-point startup (config + mapper construction): " << std::fixed
+                << std::setprecision(3) << total_startup_ms / num_started << " ms avg, "
+                << total_startup_ms << " ms total" << std::endl;
+      std::cout << "*** time-to-quality: " << std::fixed << std::setprecision(3)
+                << total_search_ms << " ms searching, " << total_time_to_best_ms
+                << " ms to reach the final best mappings, " << num_seeded << " of "
+                << num_started << " points warm-started, " << total_bound_pruned
+                << " mappings pruned against their incumbents" << std::endl;
+      std::cout << "*** mapper threads per point:";
+      for (auto& count : num_started_by_threads)
+        std::cout << " " << count.first << " x " << count.second;
+      std::cout << " (budget " << scheduler.Budget() << ")" << std::endl;
+    }
+
+    if (pruner.GetObjective() == DominancePruner::Objective::Pareto)
+    {
+      for (int problem_id = 0; problem_id < pspec_space.GetSize(); problem_id++)
+      {
+        std::vector<std::size_t> candidates;
+        for (std::size_t i = 0; i < points.size(); i++)
+          if (points[i].second == problem_id)
+            candidates.push_back(i);
+
+        std::cout << "*** area/energy pareto front for problem " << pspec_space.GetNode(problem_id).name_
+                  << " (config, area um^2, pJ/MACC):" << std::endl;
+        for (auto i : DominancePruner::ParetoFront(designs_, candidates))
+          std::cout << "  " << designs_[i].config_name_ << ", " << std::defaultfloat << designs_[i].area_
+                    << ", " << std::fixed << std::setprecision(3)
+                    << designs_[i].energy_ / designs_[i].maccs_ << std::endl;
+      }
+    }
 
-    std::string result_filename =  "overview_" + archspec_filename_ + problemspec_filename_ + ".txt";
-    replace(result_filename.begin(),result_filename.end(),'/', '.'); 
     std::ofstream result_txt_file("results/" + result_filename);
     //print final results
-    designs_[0].PrintEvaluationResultsHeader(result_txt_file);
+    PointResult::PrintEvaluationResultsHeader(result_txt_file);
     for (size_t i = 0; i < designs_.size(); i++)
     {
       designs_[i].PrintEvaluationResult(result_txt_file);
@@ -0,0 +1,250 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <iostream>
+#include <sstream>
+#include <limits>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+#include <yaml-cpp/yaml.h>
+
+#include "model/engine.hpp"
+#include "workload/workload.hpp"
+#include "loop-analysis/tiling.hpp"
+#include "applications/mapper/cost-bound.hpp"
+
+#include "store.hpp"
+
+//--------------------------------------------//
+//                Point Bounds                //
+//--------------------------------------------//
+
+// Cheap, mapping-independent bounds for one design point, computed from the
+// parsed specs without running a mapper.
+//
+// area   : Topology area (exact; it does not depend on the mapping).
+// energy : lower bound on the energy of any mapping in the mapspace: the
+//          mapper's CostBound energy floor, over the levels the mapspace
+//          always keeps each data space at (see MapSpace::KeptMasks()).
+
+struct PointBounds
+{
+  double area = 0;
+  double energy = 0;
+  std::uint64_t maccs = 0;
+
+  static PointBounds Compute(const model::Engine::Specs& specs, const problem::Workload& workload,
+                             const tiling::CompoundMaskNest& kept_masks)
+  {
+    PointBounds bounds;
+
+    model::Topology topology;
+    topology.Spec(specs.topology);
+    bounds.area = topology.Area();
+
+    CostBound cost_bound(specs, workload);
+    bounds.maccs = cost_bound.Maccs();
+    bounds.energy = cost_bound.Energy(kept_masks);
+
+    return bounds;
+  }
+};
+
+//--------------------------------------------//
+//              Dominance Pruner              //
+//--------------------------------------------//
+
+// Decides, before a point's mapper is launched, whether the point can be
+// skipped. Configured by the optional "pruning" block of the arch space file:
+//
+//   pruning:
+//     area-budget: 1.5e6     # um^2; skip points whose area exceeds this
+//     energy-budget: 2e9     # pJ; skip points whose energy bound exceeds this
+//     objective: pareto      # energy | pareto
+//
+// With objective "energy", a point is dominated once some finished point for
+// the same problem has reached an energy at or below its energy bound. With
+// "pareto" (area vs. energy) that finished point must also be no larger.
+// Finished energies are achieved, not estimated, so a dominated point can
+// never improve on the result it is dominated by. Sweeps that visit smaller
+// architectures first prune the most. The finished energies are only the best
+// the mapper could reach when energy is what it minimizes first, so both
+// objectives are dropped unless energy leads the mapper's
+// optimization-metrics; the budgets always apply.
+
+class DominancePruner
+{
+ public:
+  enum class Objective { None, Energy, Pareto };
+
+ protected:
+  struct Finished
+  {
+    int problem_id;
+    std::string name;
+    double area;
+    double energy;
+  };
+
+  double area_budget_ = std::numeric_limits<double>::infinity();
+  double energy_budget_ = std::numeric_limits<double>::infinity();
+  Objective objective_ = Objective::None;
+
+  mutable std::mutex mutex_;
+  std::vector<Finished> finished_;
+
+ public:
+
+  DominancePruner(YAML::Node config)
+  {
+    if (!config)
+      return;
+
+    if (config["area-budget"])
+      area_budget_ = config["area-budget"].as<double>();
+    if (config["energy-budget"])
+      energy_budget_ = config["energy-budget"].as<double>();
+    if (config["objective"])
+    {
+      std::string objective = config["objective"].as<std::string>();
+      if (objective == "energy")
+        objective_ = Objective::Energy;
+      else if (objective == "pareto")
+        objective_ = Objective::Pareto;
+      else
+      {
+        std::cerr << "ERROR: unknown DSE pruning objective: " << objective
+                  << " (expected energy or pareto)" << std::endl;
+        exit(1);
+      }
+    }
+  }
+
+  // This class does not support being copied
+  DominancePruner(const DominancePruner&) = delete;
+  DominancePruner& operator=(const DominancePruner&) = delete;
+
+  bool Enabled() const
+  {
+    return objective_ != Objective::None ||
+      area_budget_ != std::numeric_limits<double>::infinity() ||
+      energy_budget_ != std::numeric_limits<double>::infinity();
+  }
+
+  Objective GetObjective() const
+  {
+    return objective_;
+  }
+
+  // Drop the dominance objective if the mapper does not minimize energy
+  // first. Call before any point is checked.
+  void SetOptimizationMetrics(const std::vector<std::string>& metrics)
+  {
+    if (objective_ == Objective::None || (!metrics.empty() && metrics.front() == "energy"))
+      return;
+    std::cerr << "WARNING: DSE pruning objective ignored: it needs energy as the mapper's "
+              << "primary optimization metric (got " << (metrics.empty() ? "none" : metrics.front())
+              << "); only the budgets are applied." << std::endl;
+    objective_ = Objective::None;
+  }
+
+  // Reason the point should be skipped, or an empty string to run it.
+  std::string Check(int problem_id, const PointBounds& bounds) const
+  {
+    std::ostringstream reason;
+    if (bounds.area > area_budget_)
+    {
+      reason << "area " << bounds.area << " um^2 exceeds area-budget " << area_budget_;
+      return reason.str();
+    }
+    if (bounds.energy > energy_budget_)
+    {
+      reason << "energy lower bound " << bounds.energy << " pJ exceeds energy-budget " << energy_budget_;
+      return reason.str();
+    }
+    if (objective_ == Objective::None)
+      return "";
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& other : finished_)
+    {
+      if (other.problem_id != problem_id || other.energy > bounds.energy)
+        continue;
+      if (objective_ == Objective::Pareto && other.area > bounds.area)
+        continue;
+      reason << "dominated by " << other.name << " (energy " << other.energy
+             << " pJ <= lower bound " << bounds.energy << " pJ";
+      if (objective_ == Objective::Pareto)
+        reason << " at area " << other.area << " <= " << bounds.area << " um^2";
+      reason << ")";
+      return reason.str();
+    }
+    return "";
+  }
+
+  // Make a finished point available for dominance checks.
+  void Record(int problem_id, const PointResult& result)
+  {
+    if (!result.valid_ || !result.pruned_.empty())
+      return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_.push_back({ problem_id, result.config_name_, result.area_, result.energy_ });
+  }
+
+  // Area/energy Pareto front of the given (finished) points for one problem,
+  // smallest area first.
+  static std::vector<std::size_t> ParetoFront(const std::vector<PointResult>& results,
+                                              const std::vector<std::size_t>& candidates)
+  {
+    std::vector<std::size_t> sorted;
+    for (auto i : candidates)
+      if (results.at(i).valid_ && results.at(i).pruned_.empty())
+        sorted.push_back(i);
+    std::sort(sorted.begin(), sorted.end(), [&](std::size_t a, std::size_t b)
+              {
+                if (results[a].area_ != results[b].area_)
+                  return results[a].area_ < results[b].area_;
+                return results[a].energy_ < results[b].energy_;
+              });
+
+    std::vector<std::size_t> front;
+    double best_energy = std::numeric_limits<double>::infinity();
+    for (auto i : sorted)
+    {
+      if (results[i].energy_ < best_energy)
+      {
+        front.push_back(i);
+        best_energy = results[i].energy_;
+      }
+    }
+    return front;
+  }
+};
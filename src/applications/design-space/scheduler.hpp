@@ -0,0 +1,157 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <vector>
+#include <map>
+
+#include "mapspaces/mapspace-base.hpp"
+
+//--------------------------------------------//
+//               DSE Scheduler                //
+//--------------------------------------------//
+
+// Runs design points concurrently under a global thread budget. Each point
+// is assigned a mapper thread count up front (see ThreadsFor()) and is only
+// launched once that many threads are free, so the sum of mapper threads in
+// flight never exceeds the budget. The thread count depends only on the
+// point itself, never on what else happens to be running, so results do not
+// depend on scheduling order.
+
+class DSEScheduler
+{
+ protected:
+  unsigned budget_;
+  uint128_t mappings_per_thread_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  unsigned free_threads_;
+  std::size_t next_worker_ = 0;
+  std::map<std::size_t, std::thread> workers_;
+  std::vector<std::size_t> finished_;
+
+ public:
+
+  DSEScheduler(unsigned budget, uint128_t mappings_per_thread) :
+      budget_(std::max(budget, 1U)),
+      mappings_per_thread_(std::max(mappings_per_thread, uint128_t(1))),
+      free_threads_(budget_)
+  {
+  }
+
+  // This class does not support being copied
+  DSEScheduler(const DSEScheduler&) = delete;
+  DSEScheduler& operator=(const DSEScheduler&) = delete;
+
+  ~DSEScheduler()
+  {
+    Drain();
+  }
+
+  unsigned Budget() const
+  {
+    return budget_;
+  }
+
+  // Mapper thread count for a point: one thread per mappings_per_thread
+  // mappings the mapper may visit (the mapspace size, or the search size if
+  // that is smaller), capped by the budget and by the number of index
+  // factorizations (the mapspace is split along that dimension). A non-zero
+  // pinned count (the point's own mapper.num-threads) is honored up to the
+  // budget.
+  unsigned ThreadsFor(mapspace::MapSpace* mapspace, uint128_t search_size = 0,
+                      unsigned pinned = 0) const
+  {
+    if (pinned > 0)
+      return std::min(pinned, budget_);
+
+    uint128_t work = mapspace->Size();
+    if (search_size > 0)
+      work = std::min(work, search_size);
+    if (work == 0)
+      return 1;
+
+    uint128_t wanted = 1 + (work - 1) / mappings_per_thread_;
+    wanted = std::min(wanted, mapspace->Size(mapspace::Dimension::IndexFactorization));
+    wanted = std::min(wanted, uint128_t(budget_));
+    return std::max(unsigned(wanted), 1U);
+  }
+
+  // Blocks until num_threads threads are free, then runs job on a new
+  // thread. Threads are returned to the pool when job finishes, and finished
+  // workers are reaped here so long sweeps do not accumulate them.
+  void Launch(unsigned num_threads, std::function<void()> job)
+  {
+    assert(num_threads > 0 && num_threads <= budget_);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return free_threads_ >= num_threads; });
+    free_threads_ -= num_threads;
+
+    for (auto id : finished_)
+    {
+      workers_.at(id).join();
+      workers_.erase(id);
+    }
+    finished_.clear();
+
+    std::size_t id = next_worker_++;
+    workers_[id] = std::thread([this, num_threads, job, id]()
+                               {
+                                 job();
+                                 std::lock_guard<std::mutex> guard(mutex_);
+                                 free_threads_ += num_threads;
+                                 finished_.push_back(id);
+                                 cv_.notify_all();
+                               });
+  }
+
+  // Waits for every launched job to finish. Like Launch(), this must only be
+  // called from the thread that launches jobs.
+  void Drain()
+  {
+    std::map<std::size_t, std::thread> workers;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      workers.swap(workers_);
+    }
+    for (auto& worker : workers)
+    {
+      worker.second.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_.clear();
+  }
+};
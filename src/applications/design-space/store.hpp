@@ -0,0 +1,303 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <bitset>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <limits>
+#include <unordered_map>
+
+#include <yaml-cpp/yaml.h>
+
+#include "applications/mapper/mapper.hpp"
+#include "util/cache-file.hpp"
+
+//--------------------------------------------//
+//                Point Result                //
+//--------------------------------------------//
+
+// Summary of the best mapping found for one design point. Only the scalars
+// needed for the overview, and the mapping itself in a compact text form
+// (for warm-starting neighbors), are kept so that finished points are cheap
+// to hold and to persist. A point skipped by the DSE's dominance pruning
+// keeps the reason in pruned_ instead of search results.
+
+struct PointResult
+{
+  std::string config_name_;
+  //Mapping best_mapping_; can't be used due to bug
+  std::string mapping_; // EncodeMapping() of the best mapping, empty if none.
+  bool valid_ = false;
+  std::uint64_t maccs_ = 0;
+  double utilization_ = 0;
+  double energy_ = 0;
+  std::uint64_t cycles_ = 0;
+  double area_ = 0;
+  std::string pruned_;
+
+  PointResult() {}
+  PointResult(std::string name, const EvaluationResult& result) :
+      config_name_(name),
+      valid_(result.valid),
+      maccs_(result.stats.maccs),
+      utilization_(result.stats.utilization),
+      energy_(result.stats.energy),
+      cycles_(result.stats.cycles),
+      area_(result.stats.area)
+  {
+    if (result.valid)
+      mapping_ = EncodeMapping(result.mapping);
+  }
+
+  // The loop nest, tiling boundaries and bypass masks of a mapping as
+  // "<loops>;<boundaries>;<masks>;", space-separated within each part, with
+  // each loop as dimension:start:end:stride:spacetime. The text has no
+  // commas, so it can be a store column, and the final ';' tells a complete
+  // mapping from one torn by a crash mid-write.
+  static std::string EncodeMapping(const Mapping& mapping)
+  {
+    std::ostringstream out;
+    std::string sep;
+    for (auto& loop : mapping.loop_nest.loops)
+    {
+      out << sep << loop.dimension << ":" << loop.start << ":" << loop.end << ":"
+          << loop.stride << ":" << int(loop.spacetime_dimension);
+      sep = " ";
+    }
+    out << ";";
+    sep = "";
+    for (auto boundary : mapping.loop_nest.storage_tiling_boundaries)
+    {
+      out << sep << boundary;
+      sep = " ";
+    }
+    out << ";";
+    sep = "";
+    for (unsigned pv = 0; pv < mapping.datatype_bypass_nest.size(); pv++)
+    {
+      out << sep << mapping.datatype_bypass_nest.at(pv).to_ullong();
+      sep = " ";
+    }
+    out << ";";
+    return out.str();
+  }
+
+  // Inverse of EncodeMapping(). The problem shape of the mapping must be the
+  // current one; returns false if the text does not fit it.
+  static bool DecodeMapping(const std::string& text, Mapping& mapping)
+  {
+    std::istringstream parts(text);
+    std::string loops, boundaries, masks;
+    if (!std::getline(parts, loops, ';') || !std::getline(parts, boundaries, ';') ||
+        !std::getline(parts, masks, ';') || parts.eof())
+      return false;
+
+    mapping = Mapping();
+    std::istringstream loop_fields(loops);
+    std::string loop;
+    while (loop_fields >> loop)
+    {
+      int dimension, start, end, stride, spacetime_dimension;
+      char c1, c2, c3, c4;
+      std::istringstream fields(loop);
+      if (!(fields >> dimension >> c1 >> start >> c2 >> end >> c3 >> stride >> c4 >> spacetime_dimension) ||
+          dimension < 0 || unsigned(dimension) >= problem::GetShape()->NumDimensions)
+        return false;
+      mapping.loop_nest.loops.push_back(
+        loop::Descriptor(dimension, start, end, stride, spacetime::Dimension(spacetime_dimension)));
+    }
+
+    std::istringstream boundary_fields(boundaries);
+    std::uint64_t boundary;
+    while (boundary_fields >> boundary)
+    {
+      if (boundary >= mapping.loop_nest.loops.size())
+        return false;
+      mapping.loop_nest.storage_tiling_boundaries.push_back(boundary);
+    }
+
+    std::istringstream mask_fields(masks);
+    unsigned long long mask;
+    unsigned pv = 0;
+    while (mask_fields >> mask)
+    {
+      if (pv == mapping.datatype_bypass_nest.size())
+        return false;
+      mapping.datatype_bypass_nest.at(pv++) = std::bitset<tiling::MaxTilingLevels>(mask);
+    }
+    return pv == mapping.datatype_bypass_nest.size();
+  }
+  
+  static void PrintEvaluationResultsHeader(std::ostream& out)
+  {
+      out << "Summary stats for best mapping found by mapper:" << std::endl; 
+      out << "config_name, MACCs, utilization, pj/MACC" << std::endl;
+  }
+
+  void PrintEvaluationResult(std::ostream& out) const
+  {
+      out << config_name_ ; 
+      out << ", " << maccs_;
+      if (!pruned_.empty())
+      {
+        out << ", pruned: " << pruned_ << std::endl;
+        return;
+      }
+      out << ", " << std::setw(4) << std::fixed << std::setprecision(2) << utilization_;
+      out << ", " << std::setw(8) << std::fixed << std::setprecision(3) << energy_ / maccs_ << std::endl;
+  }
+
+};
+
+//--------------------------------------------//
+//                Result Store                //
+//--------------------------------------------//
+
+// Append-only CSV of finished design points keyed by a hash of the point's
+// combined arch+problem config and of the sweep's search settings. Rows are flushed as soon as a point
+// finishes, so a sweep that dies part-way can be restarted and will skip
+// every point already in the store. Points skipped by dominance pruning are
+// not stored, since pruning depends on more than the key; rows with a pruned
+// reason (written by older sweeps) are ignored. A torn last row (from a
+// crash mid-write) fails to parse and is ignored. The mapping column was
+// added after config_name, so rows written before it still parse (with no
+// mapping).
+
+class ResultStore
+{
+ protected:
+  std::string path_;
+  std::ofstream out_;
+  std::unordered_map<std::uint64_t, PointResult> rows_;
+
+  static constexpr const char* header_ = "hash,valid,maccs,utilization,energy,cycles,area,pruned,config_name,mapping";
+
+ public:
+
+  // FNV-1a 64 over the emitted YAML of each config node.
+  static std::uint64_t ConfigHash(const std::vector<YAML::Node>& nodes)
+  {
+    std::uint64_t hash = cache::kHashSeed;
+    for (auto& node : nodes)
+      hash = cache::HashBytes(YAML::Dump(node) + "\n---\n", hash);
+    return hash;
+  }
+
+  ResultStore(std::string path) :
+      path_(path)
+  {
+    bool needs_header = true;
+    bool needs_newline = false;
+
+    std::ifstream in(path_);
+    std::string line;
+    while (std::getline(in, line))
+    {
+      needs_header = false;
+      needs_newline = in.eof();
+      if (line == header_)
+        continue;
+
+      std::istringstream fields(line);
+      std::string hash, valid, maccs, utilization, energy, cycles, area, pruned, name, mapping;
+      if (!std::getline(fields, hash, ',') || !std::getline(fields, valid, ',') ||
+          !std::getline(fields, maccs, ',') || !std::getline(fields, utilization, ',') ||
+          !std::getline(fields, energy, ',') || !std::getline(fields, cycles, ',') ||
+          !std::getline(fields, area, ',') || !std::getline(fields, pruned, ',') ||
+          !std::getline(fields, name, ',') || !pruned.empty())
+        continue;
+      std::getline(fields, mapping);
+
+      try
+      {
+        PointResult result;
+        result.config_name_ = name;
+        result.valid_ = (valid == "1");
+        result.maccs_ = std::stoull(maccs);
+        result.utilization_ = std::stod(utilization);
+        result.energy_ = std::stod(energy);
+        result.cycles_ = std::stoull(cycles);
+        result.area_ = std::stod(area);
+        result.pruned_ = pruned;
+        result.mapping_ = mapping;
+        rows_[std::stoull(hash, nullptr, 16)] = result;
+      }
+      catch (const std::exception&)
+      {
+        // Torn or foreign row; skip it.
+      }
+    }
+    in.close();
+
+    out_.open(path_, std::ios::app);
+    if (!out_)
+    {
+      std::cerr << "ERROR: cannot open DSE result store " << path_ << std::endl;
+      exit(1);
+    }
+    if (needs_newline)
+      out_ << std::endl;
+    if (needs_header)
+      out_ << header_ << std::endl;
+  }
+
+  // This class does not support being copied
+  ResultStore(const ResultStore&) = delete;
+  ResultStore& operator=(const ResultStore&) = delete;
+
+  std::size_t Size() const
+  {
+    return rows_.size();
+  }
+
+  const PointResult* Find(std::uint64_t hash) const
+  {
+    auto it = rows_.find(hash);
+    return it == rows_.end() ? nullptr : &it->second;
+  }
+
+  // Rows appended by this process are persisted but not added to the lookup
+  // table, so Find() may run concurrently with (serialized) Append()s.
+  void Append(std::uint64_t hash, const PointResult& result)
+  {
+    out_ << std::hex << hash << std::dec << ","
+         << (result.valid_ ? 1 : 0) << ","
+         << result.maccs_ << ","
+         << std::setprecision(std::numeric_limits<double>::max_digits10) << std::defaultfloat
+         << result.utilization_ << ","
+         << result.energy_ << ","
+         << result.cycles_ << ","
+         << result.area_ << ","
+         << result.pruned_ << ","
+         << result.config_name_ << ","
+         << result.mapping_ << std::endl;
+  }
+};
@@ -0,0 +1,284 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "model/engine.hpp"
+#include "mapping/mapping.hpp"
+#include "workload/workload.hpp"
+#include "workload/operation-space.hpp"
+#include "loop-analysis/tiling.hpp"
+
+//--------------------------------------------//
+//                 Cost Bound                 //
+//--------------------------------------------//
+
+// Cheap lower bounds on the cost of a mapping, computed from its loop nest
+// and bypass masks alone, without any nest analysis.
+//
+// energy : every MACC is charged energy_per_op (density-scaled the same way
+//          the model does it), and every element of a data space passes
+//          through each storage level that keeps it, so each such level is
+//          charged at least one access per element. Moreover:
+//          - every MACC reads its operands from (and updates its result in)
+//            the innermost level that keeps them, and a spatial fanout of F
+//            below that level can multicast (or reduce) one access to at
+//            most F MACCs;
+//          - a temporal loop over a dimension the data space does not depend
+//            on refetches all of its tiles into an inner level on every
+//            iteration if a loop inside it (and above that level) steps
+//            through disjoint tiles. Each data space is then read (or
+//            updated) from the next level out at least that many times over,
+//            and a read-only one is also written to the inner level as
+//            often.
+// cycles : the arithmetic units run one step per iteration of the temporal
+//          loops, and no level can finish before them.
+//
+// The per-element floor, taken over the levels a whole mapspace always
+// keeps a data space at, bounds every mapping of an architecture (see the
+// DSE's PointBounds).
+
+class CostBound
+{
+ protected:
+  std::uint64_t maccs_ = 0;
+  double op_energy_ = 0;
+  // Per data space: its size.
+  std::vector<double> sizes_;
+  // Per data space and dimension: whether the data space does not depend on
+  // the dimension at all, and whether stepping the dimension moves to a
+  // disjoint tile (it alone indexes one of the data space's dimensions).
+  std::vector<std::vector<bool>> irrelevant_;
+  std::vector<std::vector<bool>> disjoint_;
+  std::vector<bool> read_write_;
+  // Per storage level: the energy of one access, and whether distributed
+  // multicast can divide its accesses by the fanout above it.
+  std::vector<double> word_energy_;
+  std::vector<bool> distributed_multicast_;
+
+  // Product of the spatial loop factors up to the given storage level.
+  static double SpatialFanout(const loop::Nest& nest, unsigned storage_level)
+  {
+    double fanout = 1;
+    auto last = nest.storage_tiling_boundaries.at(storage_level);
+    for (unsigned i = 0; i <= last; i++)
+    {
+      auto& loop = nest.loops[i];
+      if (loop.spacetime_dimension != spacetime::Dimension::Time)
+        fanout *= TripCount(loop);
+    }
+    return fanout;
+  }
+
+  static double TripCount(const loop::Descriptor& loop)
+  {
+    return (loop.end - loop.start + loop.stride - 1) / loop.stride;
+  }
+
+  // How many times over a data space is at least moved into the given
+  // storage level (see above).
+  double Refetches(const loop::Nest& nest, unsigned pv, unsigned storage_level) const
+  {
+    double refetches = 1;
+    bool stepping = false;
+    for (unsigned i = nest.storage_tiling_boundaries.at(storage_level) + 1; i < nest.loops.size(); i++)
+    {
+      auto& loop = nest.loops[i];
+      if (loop.spacetime_dimension != spacetime::Dimension::Time || TripCount(loop) <= 1)
+        continue;
+      if (disjoint_[pv][loop.dimension])
+        stepping = true;
+      else if (stepping && irrelevant_[pv][loop.dimension])
+        refetches *= TripCount(loop);
+    }
+    return refetches;
+  }
+
+ public:
+  CostBound() = default;
+
+  CostBound(const model::Engine::Specs& specs, const problem::Workload& workload)
+  {
+    auto shape = workload.GetShape();
+    problem::OperationPoint low, high;
+    maccs_ = 1;
+    for (unsigned dim = 0; dim < shape->NumDimensions; dim++)
+    {
+      low[dim] = 0;
+      high[dim] = workload.GetBound(dim) - 1;
+      maccs_ *= workload.GetBound(dim);
+    }
+    auto sizes = problem::OperationSpace(&workload, low, high).GetSizes();
+    for (unsigned pv = 0; pv < shape->NumDataSpaces; pv++)
+    {
+      sizes_.push_back(sizes.at(pv));
+      read_write_.push_back(shape->IsReadWriteDataSpace.at(pv));
+      irrelevant_.emplace_back(shape->NumDimensions, true);
+      disjoint_.emplace_back(shape->NumDimensions, false);
+      for (auto& expression : shape->Projections.at(pv))
+      {
+        for (auto& term : expression)
+          irrelevant_[pv][term.second] = false;
+        auto& term = expression.front();
+        if (expression.size() == 1 &&
+            (term.first == shape->NumCoefficients || workload.GetCoefficient(term.first) != 0))
+          disjoint_[pv][term.second] = true;
+      }
+    }
+
+    op_energy_ = maccs_ * specs.topology.GetArithmeticLevel()->energy_per_op.Get();
+    for (unsigned pv = 0; pv < shape->NumDataSpaces; pv++)
+    {
+      if (!shape->IsReadWriteDataSpace.at(pv))
+        op_energy_ *= workload.GetDensity(pv);
+    }
+
+    model::Topology topology;
+    topology.Spec(specs.topology);
+
+    // A BufferLevel charges one vector_access_energy per block_size accesses
+    // of the instances in a cluster, so no access costs less than this.
+    for (unsigned level = 0; level < specs.topology.NumStorageLevels(); level++)
+    {
+      auto buffer = specs.topology.GetStorageLevel(level);
+      word_energy_.push_back(buffer->vector_access_energy.Get() /
+        double(buffer->block_size.Get() * std::max<std::uint64_t>(buffer->cluster_size.Get(), 1)));
+      distributed_multicast_.push_back(topology.DistributedMulticastSupported(level));
+    }
+  }
+
+  std::uint64_t Maccs() const
+  {
+    return maccs_;
+  }
+
+  // Lower bound on the energy of any mapping that keeps each data space at
+  // (at least) the storage levels set in keep_masks.
+  double Energy(const tiling::CompoundMaskNest& keep_masks) const
+  {
+    double energy = op_energy_;
+    for (unsigned level = 0; level < word_energy_.size(); level++)
+    {
+      for (unsigned pv = 0; pv < sizes_.size(); pv++)
+      {
+        if (keep_masks.at(pv).test(level))
+          energy += sizes_[pv] * word_energy_[level];
+      }
+    }
+    return energy;
+  }
+
+  // Lower bound on the energy of one mapping.
+  double Energy(const Mapping& mapping) const
+  {
+    auto& nest = mapping.loop_nest;
+    auto& keep_masks = mapping.datatype_bypass_nest;
+    unsigned num_levels = word_energy_.size();
+    double energy = op_energy_;
+    for (unsigned pv = 0; pv < sizes_.size(); pv++)
+    {
+      // Walk the levels that keep the data space from the inside out; for
+      // each, what it passes inwards is what the level inside it receives.
+      double inwards = 0;
+      for (unsigned level = 0; level < num_levels; level++)
+      {
+        if (!keep_masks.at(pv).test(level))
+          continue;
+        // Distributed multicast shares what the level receives and sends on
+        // among its instances, so skip the refetch bound across it.
+        double received = sizes_[pv];
+        if (!distributed_multicast_[level] && level + 1 < num_levels)
+          received *= Refetches(nest, pv, level);
+
+        if (inwards == 0)
+        {
+          // With distributed multicast, the fanout of the next level that
+          // keeps the data space counts as well.
+          unsigned top = level;
+          if (distributed_multicast_[level])
+          {
+            for (top = level + 1; top + 1 < num_levels && !keep_masks.at(pv).test(top); top++)
+            {
+              // Body is empty.
+            }
+            top = std::min(top, num_levels - 1);
+          }
+          inwards = std::max(sizes_[pv], maccs_ / SpatialFanout(nest, top));
+        }
+        else if (distributed_multicast_[level])
+        {
+          inwards = sizes_[pv];
+        }
+
+        // A read-only data space is written into the level and read out of
+        // it; a read-write one is at least updated as often as either.
+        double accesses;
+        if (level + 1 == num_levels)
+          accesses = inwards;
+        else if (read_write_[pv])
+          accesses = std::max(received, inwards);
+        else
+          accesses = received + inwards;
+        energy += accesses * word_energy_[level];
+
+        inwards = received;
+      }
+    }
+    return energy;
+  }
+
+  static double Cycles(const loop::Nest& nest)
+  {
+    double cycles = 1;
+    for (auto& loop : nest.loops)
+    {
+      if (loop.spacetime_dimension == spacetime::Dimension::Time)
+        cycles *= TripCount(loop);
+    }
+    return cycles;
+  }
+
+  // Lower bound on a mapping's cost under an optimization metric (as ranked
+  // by the mapper), or 0 if there is no useful bound for the metric.
+  double Cost(const Mapping& mapping, const std::string& metric) const
+  {
+    if (metric == "energy")
+      return Energy(mapping);
+    else if (metric == "delay")
+      return Cycles(mapping.loop_nest);
+    else if (metric == "edp")
+      return Energy(mapping) * Cycles(mapping.loop_nest);
+    else
+      return 0;
+  }
+};
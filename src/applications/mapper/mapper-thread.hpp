@@ -25,10 +25,58 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <memory>
+
 #include "model/engine.hpp"
+#include "util/trace.hpp"
+#include "util/perf-counters.hpp"
+#include "util/alloc-tracker.hpp"
+#include "applications/mapper/mapping-trace.hpp"
+#include "applications/mapper/cost-bound.hpp"
 
 extern bool gTerminate;
 
+// Stages of the mapper loop that hardware counters and heap allocations
+// are attributed to.
+enum class MapperStage
+{
+  Construct,
+  PreEvalCheck,
+  Evaluate,
+  Num
+};
+
+struct StagePerfCounts
+{
+  std::uint64_t mappings = 0;
+  PerfCounters::Values values = {};
+};
+
+struct StageAllocCounts
+{
+  std::uint64_t mappings = 0;
+  alloc::Counts total;
+  std::uint64_t max_allocations = 0;
+
+  void Add(const alloc::Counts& counts)
+  {
+    mappings++;
+    total += counts;
+    max_allocations = std::max(max_allocations, counts.allocations);
+  }
+};
+
+// Evaluations per thread that are excluded from the steady-state allocation
+// counts, while the engine's scratch state grows to its working size.
+static const std::uint64_t kAllocWarmupEvaluations = 16;
+
+// Candidates drawn, constructed and evaluated together by searches that do
+// not need the outcome of one candidate to pick the next.
+static const std::size_t kEvalBatchSize = 16;
+
 enum class Betterness
 {
   Better,
@@ -37,7 +85,11 @@ enum class Betterness
   Worse
 };
   
-static double Cost(const model::Topology::Stats& stats, const std::string metric)
+// The cost/ranking helpers below are templated so that they work on both the
+// full model::Topology::Stats and the compact EvaluationSummary (which have
+// identically-named primary metrics).
+template<class StatsType>
+static double Cost(const StatsType& stats, const std::string metric)
 {
   if (metric == "delay")
   {
@@ -58,7 +110,8 @@ static double Cost(const model::Topology::Stats& stats, const std::string metric
   }
 }
 
-static Betterness IsBetterRecursive_(const model::Topology::Stats& candidate, const model::Topology::Stats& incumbent,
+template<class CandidateType, class IncumbentType>
+static Betterness IsBetterRecursive_(const CandidateType& candidate, const IncumbentType& incumbent,
                                      const std::vector<std::string>::const_iterator metric,
                                      const std::vector<std::string>::const_iterator end)
 {
@@ -104,20 +157,62 @@ static Betterness IsBetterRecursive_(const model::Topology::Stats& candidate, co
   }
 }
 
-static inline bool IsBetter(const model::Topology::Stats& candidate, const model::Topology::Stats& incumbent,
+template<class CandidateType, class IncumbentType>
+static inline bool IsBetter(const CandidateType& candidate, const IncumbentType& incumbent,
                             const std::vector<std::string>& metrics)
 {
   Betterness b = IsBetterRecursive_(candidate, incumbent, metrics.begin(), metrics.end());
   return (b == Betterness::Better || b == Betterness::SlightlyBetter);
 }
 
-static inline bool IsBetter(const model::Topology::Stats& candidate, const model::Topology::Stats& incumbent,
+template<class CandidateType, class IncumbentType>
+static inline bool IsBetter(const CandidateType& candidate, const IncumbentType& incumbent,
                             const std::string& metric)
 {
   std::vector<std::string> metrics = { metric };
   return IsBetter(candidate, incumbent, metrics);
 }
 
+// Compact, trivially-copyable digest of a successful evaluation. This is all
+// the mapper needs to rank and log candidates. The full Mapping and
+// Topology::Stats are only copied out of the engine when a candidate actually
+// becomes a thread best, and the mapping ID is retained so that a summary can
+// always be expanded back into a Mapping via MapSpace::ConstructMapping().
+struct EvaluationSummary
+{
+  double energy;
+  double area;
+  std::uint64_t cycles;
+  double utilization;
+  std::uint64_t maccs;
+  std::uint64_t last_level_accesses;
+  uint128_t mapping_id;
+
+  EvaluationSummary() = default;
+
+  EvaluationSummary(const model::Topology::Stats& stats, const uint128_t id) :
+      energy(stats.energy),
+      area(stats.area),
+      cycles(stats.cycles),
+      utilization(stats.utilization),
+      maccs(stats.maccs),
+      last_level_accesses(stats.last_level_accesses),
+      mapping_id(id)
+  {
+  }
+
+  EvaluationSummary(const model::Engine::BatchStats& batch, std::size_t i, const uint128_t id) :
+      energy(batch.energy[i]),
+      area(batch.area[i]),
+      cycles(batch.cycles[i]),
+      utilization(batch.utilization[i]),
+      maccs(batch.maccs[i]),
+      last_level_accesses(batch.last_level_accesses[i]),
+      mapping_id(id)
+  {
+  }
+};
+
 struct EvaluationResult
 {
   bool valid = false;
@@ -137,6 +232,23 @@ struct EvaluationResult
     }
     return updated;
   }
+
+  // Rank a candidate by its summary alone, and only materialize the full
+  // mapping and stats (from the still-live evaluation state) if it wins.
+  bool UpdateIfBetter(const EvaluationSummary& candidate, const Mapping& candidate_mapping,
+                      const model::Topology::Stats& candidate_stats,
+                      const std::vector<std::string>& metrics)
+  {
+    bool updated = false;
+    if (!valid || IsBetter(candidate, stats, metrics))
+    {
+      valid = true;
+      mapping = candidate_mapping;
+      stats = candidate_stats;
+      updated = true;
+    }
+    return updated;
+  }
 };
 
 //--------------------------------------------//
@@ -152,6 +264,7 @@ class MapperThread
   mapspace::MapSpace* mapspace_;
   std::mutex* mutex_;
   uint128_t search_size_;
+  uint128_t max_evaluations_;
   std::uint32_t timeout_;
   std::uint32_t victory_condition_;
   uint128_t sync_interval_;
@@ -168,6 +281,19 @@ class MapperThread
   // Thread-local data.
   std::thread thread_;
   EvaluationResult thread_best_;
+  bool seeded_ = false;
+  double time_to_best_ms_ = 0;
+  uint128_t num_mappings_ = 0;
+  uint128_t num_valid_mappings_ = 0;
+  uint128_t num_bound_pruned_ = 0;
+  model::NetworkMemoCounters network_memo_;
+  MappingTraceWriter* trace_ = nullptr;
+  bool count_perf_events_ = false;
+  std::array<StagePerfCounts, unsigned(MapperStage::Num)> stage_perf_counts_;
+  std::string perf_error_;
+  std::array<StageAllocCounts, unsigned(MapperStage::Num)> stage_alloc_counts_;
+  StageAllocCounts steady_evaluate_allocs_;
+  alloc::Counts run_allocs_;
   std::vector<uint128_t> invalid_eval_counts_;
   std::vector<Mapping> invalid_eval_sample_mappings_;
 
@@ -178,6 +304,7 @@ class MapperThread
     mapspace::MapSpace* mapspace,
     std::mutex* mutex,
     uint128_t search_size,
+    uint128_t max_evaluations,
     std::uint32_t timeout,
     std::uint32_t victory_condition,
     uint128_t sync_interval,
@@ -196,6 +323,7 @@ class MapperThread
       mapspace_(mapspace),
       mutex_(mutex),
       search_size_(search_size),
+      max_evaluations_(max_evaluations),
       timeout_(timeout),
       victory_condition_(victory_condition),
       sync_interval_(sync_interval),
@@ -230,6 +358,96 @@ class MapperThread
     return thread_best_;
   }
 
+  // Start from a known-good incumbent (e.g., a warm-start seed) instead of
+  // from nothing. Candidates must beat it to become the thread best, but the
+  // victory condition still counts from the best mapping the thread has
+  // found itself, so a seed does not cut the search short. Candidates whose
+  // CostBound on the primary metric is already worse than the incumbent are
+  // not evaluated at all.
+  void Seed(const EvaluationResult& seed)
+  {
+    thread_best_ = seed;
+    seeded_ = true;
+  }
+
+  // Record every mapping this thread evaluates into a shared trace.
+  void Trace(MappingTraceWriter* trace)
+  {
+    trace_ = trace;
+  }
+
+  // Wall-clock time from the start of Run() to the last thread-best update
+  // (0 if the thread never improved on its seed).
+  double TimeToBestMs() const
+  {
+    return time_to_best_ms_;
+  }
+
+  // Count hardware events per stage of the mapper loop (see
+  // util/perf-counters.hpp).
+  void CountPerfEvents()
+  {
+    count_perf_events_ = true;
+  }
+
+  // Per-stage totals; stages are left at zero if no counter could be opened.
+  const std::array<StagePerfCounts, unsigned(MapperStage::Num)>& StagePerfEvents() const
+  {
+    return stage_perf_counts_;
+  }
+
+  // Why some counters could not be opened ("" if they all were).
+  const std::string& PerfEventsError() const
+  {
+    return perf_error_;
+  }
+
+  // Per-stage heap allocations (see util/alloc-tracker.hpp); all zero in
+  // builds without allocation tracking.
+  const std::array<StageAllocCounts, unsigned(MapperStage::Num)>& StageAllocations() const
+  {
+    return stage_alloc_counts_;
+  }
+
+  // Allocations of the Engine::Evaluate() calls after the first
+  // kAllocWarmupEvaluations of this thread.
+  const StageAllocCounts& SteadyStateEvaluateAllocations() const
+  {
+    return steady_evaluate_allocs_;
+  }
+
+  // Allocations made by the whole of the last Run(), including the search,
+  // the engine set-up and the best-mapping bookkeeping.
+  const alloc::Counts& RunAllocations() const
+  {
+    return run_allocs_;
+  }
+
+  // Mappings drawn from the search (valid or not) and valid mappings
+  // evaluated by the last Run().
+  uint128_t NumMappings() const
+  {
+    return num_mappings_;
+  }
+
+  uint128_t NumValidMappings() const
+  {
+    return num_valid_mappings_;
+  }
+
+  // Mappings of the last Run() that were skipped because their cost bound
+  // was worse than the incumbent (seeded threads only).
+  uint128_t NumBoundPruned() const
+  {
+    return num_bound_pruned_;
+  }
+
+  // Network evaluation memo hits and misses of the last Run().
+  const model::NetworkMemoCounters& NetworkMemo() const
+  {
+    return network_memo_;
+  }
+
   std::vector<uint128_t>& InvalidEvalCounts()
   {
     return invalid_eval_counts_;
@@ -246,18 +464,226 @@ class MapperThread
     uint128_t valid_mappings = 0;
     uint128_t invalid_mappings_mapcnstr = 0;
     uint128_t invalid_mappings_eval = 0;
+    uint128_t bound_pruned = 0;
     std::uint32_t mappings_since_last_best_update = 0;
 
+    // Best mapping found by this thread itself, which the victory condition
+    // counts from when the thread starts from a seed.
+    EvaluationSummary own_best;
+    bool own_best_valid = false;
+
     const int ncurses_line_offset = 6;
+    auto start_time = std::chrono::steady_clock::now();
+    auto run_alloc_start = alloc::ThreadCounts();
+
+    // Waits for the shared mutex show up as their own trace scope.
+    auto lock = [this]()
+      {
+        TRACE_SCOPE("mapper/lock-wait");
+        mutex_->lock();
+      };
       
     model::Engine engine;
     engine.Spec(arch_specs_);
 
+    // A seeded thread has a good incumbent from the start, so many
+    // candidates can be rejected on a lower bound of their cost, before the
+    // pre-evaluation check. Such a candidate is certainly worse than the
+    // incumbent: the bound must exceed it by more than IsBetter()'s
+    // tolerance.
+    const std::string& primary_metric = optimization_metrics_.at(0);
+    std::unique_ptr<CostBound> cost_bound;
+    if (seeded_ && (primary_metric == "energy" || primary_metric == "delay" || primary_metric == "edp"))
+      cost_bound.reset(new CostBound(arch_specs_, workload_));
+    auto bound_exceeds = [&](double bound, double cost)
+      {
+        return bound > cost * (1 + 0.001);
+      };
+    auto prune = [&](const Mapping& mapping, double& bound)
+      {
+        if (!cost_bound || !thread_best_.valid)
+          return false;
+        bound = cost_bound->Cost(mapping, primary_metric);
+        return bound_exceeds(bound, Cost(thread_best_.stats, primary_metric));
+      };
+
+    // Hardware counters, read before and after each stage.
+    std::unique_ptr<PerfCounters> perf;
+    PerfCounters::Sample perf_start;
+    if (count_perf_events_)
+    {
+      perf.reset(new PerfCounters());
+      perf_error_ = perf->Error();
+      if (!perf->Available())
+        perf.reset();
+    }
+    // Heap allocations, likewise.
+    alloc::Counts alloc_start;
+    auto perf_begin = [&]()
+      {
+        if (alloc::kEnabled)
+          alloc_start = alloc::ThreadCounts();
+        if (perf)
+          perf_start = perf->Read();
+      };
+    auto perf_end = [&](MapperStage stage)
+      {
+        if (alloc::kEnabled)
+          stage_alloc_counts_[unsigned(stage)].Add(alloc::ThreadCounts() - alloc_start);
+        if (perf)
+        {
+          auto values = PerfCounters::Delta(perf_start, perf->Read());
+          auto& counts = stage_perf_counts_[unsigned(stage)];
+          counts.mappings++;
+          for (unsigned counter = 0; counter < PerfCounters::Num; counter++)
+            counts.values[counter] += values[counter];
+        }
+      };
+
+    // Mapping trace: one row per mapping ID taken from the search.
+    std::unique_ptr<MappingTraceChunk> trace_chunk;
+    std::chrono::steady_clock::time_point eval_start;
+    if (trace_)
+      trace_chunk = trace_->NewChunk(thread_id_);
+
+    auto trace = [&](const mapspace::ID& mapping_id, TraceStatus status,
+                     const std::vector<model::EvalStatus>& status_per_level)
+      {
+        int fail_level = -1;
+        for (unsigned level = 0; level < status_per_level.size(); level++)
+        {
+          if (!status_per_level[level].success)
+          {
+            fail_level = level;
+            break;
+          }
+        }
+        auto eval_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - eval_start).count();
+        trace_chunk->Add(mapping_id, status, fail_level, std::uint32_t(eval_ns),
+                         status == TraceStatus::Success ? &engine.GetTopology() : nullptr);
+        if (trace_chunk->Full())
+          trace_chunk = trace_->Submit(std::move(trace_chunk));
+      };
+
+    auto report_eval_failure = [&](const mapspace::ID& mapping_id, const Mapping& mapping,
+                                   const std::vector<model::EvalStatus>& status_per_level,
+                                   TraceStatus trace_status)
+      {
+        if (trace_)
+          trace(mapping_id, trace_status, status_per_level);
+        invalid_mappings_eval++;
+        if (diagnostics_on_)
+        {
+          for (unsigned level = 0; level < arch_specs_.topology.NumLevels(); level++)
+          {
+            if (!status_per_level.at(level).success)
+            {
+              // Collect 1 sample failed mapping per level.
+              if (invalid_eval_counts_.at(level) == 0)
+                invalid_eval_sample_mappings_.at(level) = mapping;
+              invalid_eval_counts_.at(level)++;
+            }
+          }
+        }
+        search_->Report(search::Status::EvalFailure);
+      };
+
+    auto report_pruned = [&](const mapspace::ID& mapping_id, double bound)
+      {
+        if (trace_)
+          trace(mapping_id, TraceStatus::BoundPruned, {});
+        bound_pruned++;
+        // Had it been evaluated, it would not have improved on the thread's
+        // own best either, so it counts toward the victory condition.
+        if (own_best_valid && bound_exceeds(bound, Cost(own_best, primary_metric)))
+          mappings_since_last_best_update++;
+        search_->Report(search::Status::Pruned);
+      };
+
+    // Searches that pick candidates without looking at earlier outcomes are
+    // fed from batches: kEvalBatchSize candidates are drawn and constructed
+    // at a time and checked and evaluated with one Engine::EvaluateBatch()
+    // call, then consumed by the loop below one by one, in order, exactly as
+    // if each had been evaluated in turn. Traces and per-stage perf and
+    // allocation counts are per mapping, so they keep the one-at-a-time path.
+    const bool batched = !search_->UsesFeedback() && !trace_ && !perf && !alloc::kEnabled;
+    std::vector<mapspace::ID> batch_ids;
+    std::vector<int> batch_index; // Into batch_mappings; -1 if construction failed, -2 if pruned.
+    std::vector<double> batch_bound; // Cost bound of a pruned candidate.
+    std::vector<Mapping> batch_mappings;
+    model::Engine::BatchStats batch_stats;
+    std::size_t batch_next = 0;
+    bool search_done = false;
+
+    auto next_from_batch = [&](mapspace::ID& mapping_id)
+      {
+        if (batch_next == batch_ids.size())
+        {
+          batch_ids.clear();
+          batch_index.clear();
+          batch_bound.clear();
+          batch_mappings.clear();
+          batch_next = 0;
+
+          // Draw no more candidates than are sure to be consumed: each one
+          // moves at most one of the termination counters one step, so the
+          // smallest remaining budget is a lower bound on how many the loop
+          // below still takes before it stops.
+          uint128_t budget = kEvalBatchSize;
+          if (search_size_ > 0)
+            budget = std::min(budget, search_size_ - valid_mappings);
+          if (max_evaluations_ > 0)
+            budget = std::min(budget, max_evaluations_ - total_mappings);
+          if (victory_condition_ > 0)
+            budget = std::min(budget, uint128_t(victory_condition_ - mappings_since_last_best_update));
+          if (timeout_ > 0)
+            budget = std::min(budget, uint128_t(timeout_) - (invalid_mappings_mapcnstr + invalid_mappings_eval));
+
+          while (!search_done && !gTerminate && batch_ids.size() < budget)
+          {
+            mapspace::ID id;
+            if (!search_->Next(id))
+            {
+              search_done = true;
+              break;
+            }
+            Mapping mapping;
+            bool constructed;
+            {
+              TRACE_SCOPE("mapper/construct");
+              constructed = mapspace_->ConstructMapping(id, &mapping);
+            }
+            double bound = 0;
+            bool pruned = constructed && prune(mapping, bound);
+            batch_ids.push_back(id);
+            batch_index.push_back(pruned ? -2 : constructed ? int(batch_mappings.size()) : -1);
+            batch_bound.push_back(bound);
+            if (constructed && !pruned)
+              batch_mappings.push_back(std::move(mapping));
+          }
+
+          TRACE_SCOPE("mapper/evaluate");
+          engine.EvaluateBatch(batch_mappings, workload_, batch_stats, !diagnostics_on_);
+        }
+
+        // The reports of earlier candidates may have terminated the search,
+        // after which it would not have handed out the rest of the batch.
+        // Running out of candidates while filling it is not a termination:
+        // everything drawn before that is still consumed.
+        if (batch_next == batch_ids.size() || search_->Terminated())
+          return false;
+        mapping_id = batch_ids[batch_next];
+        return true;
+      };
+
     // =================
     // Main mapper loop.
     // =================
     while (true)
     {
+      TRACE_SCOPE("mapper/mapping");
+
       if (live_status_)
       {
         std::stringstream msg;
@@ -274,7 +700,7 @@ class MapperThread
             thread_best_.stats.maccs;
         }
 
-        mutex_->lock();
+        lock();
         mvaddstr(thread_id_ + ncurses_line_offset, 0, msg.str().c_str());
         refresh();
         mutex_->unlock();
@@ -285,7 +711,7 @@ class MapperThread
 
       if (gTerminate)
       {
-        mutex_->lock();
+        lock();
         log_stream_ << "[" << std::setw(3) << thread_id_ << "] STATEMENT: "
                     << "global termination flag activated, terminating search."
                     << std::endl;
@@ -295,7 +721,7 @@ class MapperThread
 
       if (search_size_ > 0 && valid_mappings == search_size_)
       {
-        mutex_->lock();
+        lock();
         log_stream_ << "[" << std::setw(3) << thread_id_ << "] STATEMENT: " << search_size_
                     << " valid mappings found, terminating search."
                     << std::endl;
@@ -303,9 +729,19 @@ class MapperThread
         terminate = true;
       }
 
+      if (max_evaluations_ > 0 && total_mappings == max_evaluations_)
+      {
+        lock();
+        log_stream_ << "[" << std::setw(3) << thread_id_ << "] STATEMENT: " << max_evaluations_
+                    << " mappings evaluated, terminating search."
+                    << std::endl;
+        mutex_->unlock();
+        terminate = true;
+      }
+
       if (victory_condition_ > 0 && mappings_since_last_best_update == victory_condition_)
       {
-        mutex_->lock();
+        lock();
         log_stream_ << "[" << std::setw(3) << thread_id_ << "] STATEMENT: " << victory_condition_
                     << " suboptimal mappings found since the last upgrade, terminating search."
                     << std::endl;
@@ -316,7 +752,7 @@ class MapperThread
       if ((invalid_mappings_mapcnstr + invalid_mappings_eval) > 0 &&
           (invalid_mappings_mapcnstr + invalid_mappings_eval) == timeout_)
       {
-        mutex_->lock();
+        lock();
         log_stream_ << "[" << std::setw(3) << thread_id_ << "] STATEMENT: " << timeout_
                     << " invalid mappings (" << invalid_mappings_mapcnstr << " fanout, "
                     << invalid_mappings_eval << " capacity) found since the last valid mapping, "
@@ -327,9 +763,9 @@ class MapperThread
 
       // Try to obtain the next mapping from the search algorithm.
       mapspace::ID mapping_id;
-      if (!search_->Next(mapping_id))
+      if (batched ? (!terminate && !next_from_batch(mapping_id)) : !search_->Next(mapping_id))
       {
-        mutex_->lock();
+        lock();
         log_stream_ << "[" << std::setw(3) << thread_id_ << "] STATEMENT: "
                     << "search algorithm is done, terminating search."
                     << std::endl;        
@@ -342,7 +778,7 @@ class MapperThread
       {
         if (live_status_)
         {
-          mutex_->lock();
+          lock();
           mvaddstr(thread_id_ + ncurses_line_offset, 0, "-");
           refresh();
           mutex_->unlock();
@@ -355,7 +791,7 @@ class MapperThread
       //
       if (total_mappings != 0 && sync_interval_ > 0 && total_mappings % sync_interval_ == 0)
       {
-        mutex_->lock();
+        lock();
           
         // Sync from global best to thread_best.
         bool global_pulled = false;
@@ -387,79 +823,114 @@ class MapperThread
       //          because the space of *legal* mappings isn't dense (unfortunately),
       //          so a mapping ID may point to an illegal mapping.
       Mapping mapping;
+      int batch_mapping = -1;
 
-      success &= mapspace_->ConstructMapping(mapping_id, &mapping);
+      if (trace_)
+        eval_start = std::chrono::steady_clock::now();
+
+      double bound = 0;
+      bool pruned = false;
+      if (batched)
+      {
+        batch_mapping = batch_index[batch_next];
+        bound = batch_bound[batch_next++];
+        pruned = batch_mapping == -2;
+        success &= batch_mapping >= 0 || pruned;
+        if (batch_mapping >= 0)
+          mapping = std::move(batch_mappings[batch_mapping]);
+      }
+      else
+      {
+        TRACE_SCOPE("mapper/construct");
+        perf_begin();
+        success &= mapspace_->ConstructMapping(mapping_id, &mapping);
+        perf_end(MapperStage::Construct);
+      }
       total_mappings++;
 
       if (!success)
       {
+        if (trace_)
+          trace(mapping_id, TraceStatus::ConstructionFailure, status_per_level);
         invalid_mappings_mapcnstr++;
         search_->Report(search::Status::MappingConstructionFailure);
         continue;
       }
 
-      // Stage 2: (Re)Configure a hardware model to evaluate the mapping
-      //          on, and run some lightweight pre-checks that the
-      //          model can use to quickly reject a nest.
-      //engine.Spec(arch_specs_);
-      status_per_level = engine.PreEvaluationCheck(mapping, workload_, !diagnostics_on_);
-      success &= std::accumulate(status_per_level.begin(), status_per_level.end(), true,
-                                 [](bool cur, const model::EvalStatus& status)
-                                 { return cur && status.success; });
+      if (!batched)
+        pruned = prune(mapping, bound);
+      if (pruned)
+      {
+        report_pruned(mapping_id, bound);
+        continue;
+      }
 
-      if (!success)
+      if (batched)
       {
-        invalid_mappings_eval++;
-        if (diagnostics_on_)
+        // The pre-evaluation check and the evaluation ran with the batch.
+        status_per_level = batch_stats.eval_status.at(batch_mapping);
+        success &= batch_stats.success.at(batch_mapping) != 0;
+        if (!success)
         {
-          for (unsigned level = 0; level < arch_specs_.topology.NumLevels(); level++)
-          {
-            if (!status_per_level.at(level).success)
-            {
-              // Collect 1 sample failed mapping per level.
-              if (invalid_eval_counts_.at(level) == 0)
-                invalid_eval_sample_mappings_.at(level) = mapping;
-              invalid_eval_counts_.at(level)++;
-            }
-          }
+          report_eval_failure(mapping_id, mapping, status_per_level, TraceStatus::EvalFailure);
+          continue;
         }
-        search_->Report(search::Status::EvalFailure);
-        continue;
       }
-
-      // Stage 3: Heavyweight evaluation.
-      status_per_level = engine.Evaluate(mapping, workload_, !diagnostics_on_);
-      success &= std::accumulate(status_per_level.begin(), status_per_level.end(), true,
-                                 [](bool cur, const model::EvalStatus& status)
-                                 { return cur && status.success; });
-      if (!success)
+      else
       {
-        invalid_mappings_eval++;
-        if (diagnostics_on_)
+        // Stage 2: (Re)Configure a hardware model to evaluate the mapping
+        //          on, and run some lightweight pre-checks that the
+        //          model can use to quickly reject a nest.
+        //engine.Spec(arch_specs_);
         {
-          for (unsigned level = 0; level < arch_specs_.topology.NumLevels(); level++)
-          {
-            if (!status_per_level.at(level).success)
-            {
-              // Collect 1 sample failed mapping per level.
-              if (invalid_eval_counts_.at(level) == 0)
-                invalid_eval_sample_mappings_.at(level) = mapping;
-              invalid_eval_counts_.at(level)++;
-            }
-          }
+          TRACE_SCOPE("mapper/precheck");
+          perf_begin();
+          status_per_level = engine.PreEvaluationCheck(mapping, workload_, !diagnostics_on_);
+          perf_end(MapperStage::PreEvalCheck);
+        }
+        success &= std::accumulate(status_per_level.begin(), status_per_level.end(), true,
+                                   [](bool cur, const model::EvalStatus& status)
+                                   { return cur && status.success; });
+
+        if (!success)
+        {
+          report_eval_failure(mapping_id, mapping, status_per_level, TraceStatus::PreEvalFailure);
+          continue;
+        }
+
+        // Stage 3: Heavyweight evaluation.
+        {
+          TRACE_SCOPE("mapper/evaluate");
+          perf_begin();
+          status_per_level = engine.Evaluate(mapping, workload_, !diagnostics_on_);
+          perf_end(MapperStage::Evaluate);
+          if (alloc::kEnabled && stage_alloc_counts_[unsigned(MapperStage::Evaluate)].mappings > kAllocWarmupEvaluations)
+            steady_evaluate_allocs_.Add(engine.LastEvaluateAllocations());
+        }
+        success &= std::accumulate(status_per_level.begin(), status_per_level.end(), true,
+                                   [](bool cur, const model::EvalStatus& status)
+                                   { return cur && status.success; });
+        if (!success)
+        {
+          report_eval_failure(mapping_id, mapping, status_per_level, TraceStatus::EvalFailure);
+          continue;
         }
-        search_->Report(search::Status::EvalFailure);
-        continue;
       }
 
       // SUCCESS!!!
-      auto stats = engine.GetTopology().GetStats();
-      EvaluationResult result = { true, mapping, stats };
+      // Only a compact summary is copied out of the engine here. The full
+      // stats are referenced in place and copied only on a thread-best update.
+      EvaluationSummary stats = batched ?
+        EvaluationSummary(batch_stats, batch_mapping, mapping.id) :
+        EvaluationSummary(engine.GetTopology().GetStats(), mapping.id);
+
+      if (trace_)
+        trace(mapping_id, TraceStatus::Success, status_per_level);
 
       valid_mappings++;
       if (log_stats_)
       {
-        mutex_->lock();
+        lock();
         log_stream_ << "[" << thread_id_ << "] INVALID " << total_mappings << " " << valid_mappings
                     << " " << invalid_mappings_mapcnstr + invalid_mappings_eval << std::endl;
         mutex_->unlock();
@@ -470,7 +941,7 @@ class MapperThread
 
       if (log_suboptimal_)
       {
-        mutex_->lock();
+        lock();
         log_stream_ << "[" << std::setw(3) << thread_id_ << "]" 
                     << " Utilization = " << std::setw(4) << std::fixed << std::setprecision(2) << stats.utilization 
                     << " | pJ/MACC = " << std::setw(8) << std::fixed << std::setprecision(3) << stats.energy /
@@ -478,8 +949,22 @@ class MapperThread
         mutex_->unlock();
       }
 
-      // Is the new mapping "better" than the previous best mapping?
-      if (thread_best_.UpdateIfBetter(result, optimization_metrics_))
+      bool own_improvement = false;
+      if (seeded_ && (!own_best_valid || IsBetter(stats, own_best, optimization_metrics_)))
+      {
+        own_best = stats;
+        own_best_valid = true;
+        own_improvement = true;
+      }
+
+      // Is the new mapping "better" than the previous best mapping? The
+      // engine no longer holds the full stats of a batched candidate, so a
+      // winner is evaluated again to get them.
+      bool better = !thread_best_.valid || IsBetter(stats, thread_best_.stats, optimization_metrics_);
+      if (better && batched)
+        engine.Evaluate(mapping, workload_, !diagnostics_on_);
+      if (better &&
+          thread_best_.UpdateIfBetter(stats, mapping, engine.GetTopology().GetStats(), optimization_metrics_))
       {
         if (log_stats_)
         {
@@ -487,7 +972,7 @@ class MapperThread
           double improvement = thread_best_.valid ?
             (Cost(thread_best_.stats, optimization_metrics_.at(0)) - Cost(stats, optimization_metrics_.at(0))) /
             Cost(thread_best_.stats, optimization_metrics_.at(0)) : 1.0;
-          mutex_->lock();
+          lock();
           log_stream_ << "[" << thread_id_ << "] UPDATE " << total_mappings << " " << valid_mappings
                       << " " << mappings_since_last_best_update << " " << improvement << std::endl;
           mutex_->unlock();
@@ -495,7 +980,7 @@ class MapperThread
         
         if (!log_suboptimal_)
         {
-          mutex_->lock();
+          lock();
           log_stream_ << "[" << std::setw(3) << thread_id_ << "]" 
                       << " Utilization = " << std::setw(4) << std::fixed << std::setprecision(2) << stats.utilization 
                       << " | pJ/MACC = " << std::setw(8) << std::fixed << std::setprecision(3) << stats.energy /
@@ -504,12 +989,27 @@ class MapperThread
         }
 
         mappings_since_last_best_update = 0;
+        time_to_best_ms_ = std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now() - start_time).count();
+      }
+      else if (own_improvement)
+      {
+        mappings_since_last_best_update = 0;
       }
       else
       {
         mappings_since_last_best_update++;
       }
     } // while ()
+
+    num_mappings_ = total_mappings;
+    num_valid_mappings_ = valid_mappings;
+    num_bound_pruned_ = bound_pruned;
+    network_memo_ = engine.GetTopology().NetworkMemoStats();
+    run_allocs_ = alloc::ThreadCounts() - run_alloc_start;
+
+    if (trace_)
+      trace_->Finish(std::move(trace_chunk));
       
     //
     // End Mapping.
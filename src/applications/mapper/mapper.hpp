@@ -27,7 +27,9 @@
 
 #pragma once
 
+#include <chrono>
 #include <fstream>
+#include <sstream>
 #include <thread>
 #include <mutex>
 #include <iomanip>
@@ -41,6 +43,8 @@
 #include <boost/archive/xml_oarchive.hpp>
 
 #include "util/accelergy_interface.hpp"
+#include "model/binary-stats.hpp"
+#include "model/spec-cache.hpp"
 #include "mapspaces/mapspace-factory.hpp"
 #include "search/search-factory.hpp"
 #include "compound-config/compound-config.hpp"
@@ -65,6 +69,9 @@ class Application
   std::vector<search::SearchAlgorithm*> search_;
 
   uint128_t search_size_;
+  std::uint32_t total_search_size_;
+  uint128_t max_evaluations_;
+  std::uint32_t total_max_evaluations_;
   std::uint32_t num_threads_;
   std::uint32_t timeout_;
   std::uint32_t victory_condition_;
@@ -74,14 +81,29 @@ class Application
   bool live_status_;
   bool diagnostics_on_;
   bool emit_whoop_nest_;
+  bool trace_;
+  bool perf_counters_;
+  // Maximum mean heap allocations per steady-state Engine::Evaluate() call;
+  // negative if unchecked.
+  double allocation_budget_;
   std::string out_prefix_;
 
+  // Output format of the engine stats and mapping archive: "xml", "binary"
+  // or "both" (see model/binary-stats.hpp).
+  std::string stats_format_;
+  std::string config_text_;
+
   std::vector<std::string> optimization_metrics_;
 
+  config::CompoundConfigNode search_config_;
+
   char* cfg_string_;
 
   EvaluationResult best_;
   EvaluationResult global_best_;
+  EvaluationResult seed_;
+  double time_to_best_ms_ = 0;
+  std::uint64_t num_bound_pruned_ = 0;
 
  private:
 
@@ -98,13 +120,29 @@ class Application
 
  public:
 
+  // If defer_search is set, the mapspace is constructed but not split, and the
+  // caller must call InitSearch() (while config is still alive) before Run().
   Application(config::CompoundConfig* config,
               std::string output_dir = ".",
-              std::string name = "timeloop-mapper") :
+              std::string name = "timeloop-mapper",
+              bool defer_search = false) :
       name_(name)
   {
     auto rootNode = config->getRoot();
 
+    // Stats output format. The binary archive embeds the input config, which
+    // must be captured before parsing since some parsers rewrite the tree.
+    stats_format_ = "xml";
+    rootNode.lookup("mapper").lookupValue("stats-format", stats_format_);
+    if (stats_format_ != "xml" && stats_format_ != "binary" && stats_format_ != "both")
+    {
+      std::cerr << "ERROR: unrecognized stats-format: " << stats_format_
+                << " (expected xml, binary or both)." << std::endl;
+      exit(1);
+    }
+    if (stats_format_ != "xml" && !config->hasLConfig())
+      config_text_ = YAML::Dump(config->getYConfig());
+
     // Problem configuration.
     auto problem = rootNode.lookup("problem");
     problem::ParseWorkload(problem, workload_);
@@ -118,12 +156,14 @@ class Application
 
     // Architecture configuration.
     config::CompoundConfigNode arch;
+    std::string arch_key = "architecture";
     if (rootNode.exists("arch")) {
+      arch_key = "arch";
       arch = rootNode.lookup("arch");
     } else if (rootNode.exists("architecture")) {
       arch = rootNode.lookup("architecture");
     }
-    arch_specs_ = model::Engine::ParseSpecs(arch);
+    arch_specs_ = model::SpecCache::ParseSpecs(config, arch_key);
 
     if (rootNode.exists("ERT")) {
       auto ert = rootNode.lookup("ERT");
@@ -133,12 +173,7 @@ class Application
 #ifdef USE_ACCELERGY
       // Call accelergy ERT with all input files
       if (arch.exists("subtree") || arch.exists("local")) {
-        accelergy::invokeAccelergy(config->inFiles, semi_qualified_prefix, output_dir);
-        std::string ertPath = out_prefix_ + ".ERT.yaml";
-        auto ertConfig = new config::CompoundConfig(ertPath.c_str());
-        auto ert = ertConfig->getRoot().lookup("ERT");
-        std::cout << "Generate Accelergy ERT (energy reference table) to replace internal energy model." << std::endl;
-        arch_specs_.topology.ParseAccelergyERT(ert);
+        accelergy::applyCachedERT(*config, semi_qualified_prefix, output_dir, arch_specs_.topology);
       }
 #endif
     }
@@ -152,7 +187,7 @@ class Application
     {
       std::cout << "Using threads = " << num_threads_ << std::endl;
     }
-    else
+    else if (!defer_search)
     {
       std::cout << "Using all available hardware threads = " << num_threads_ << std::endl;
     }
@@ -171,13 +206,15 @@ class Application
       optimization_metrics_ = { "edp" };
     }
 
-    // Search size (divide between threads).
-    std::uint32_t search_size = 0;
-    mapper.lookupValue("search-size", search_size);
-    mapper.lookupValue("search_size", search_size); // backwards compatibility.
-    if (search_size > 0)
-      search_size = 1 + (search_size - 1) / num_threads_;
-    search_size_ = static_cast<uint128_t>(search_size);
+    // Search size (divided between threads in InitSearch()).
+    total_search_size_ = 0;
+    mapper.lookupValue("search-size", total_search_size_);
+    mapper.lookupValue("search_size", total_search_size_); // backwards compatibility.
+
+    // Number of mappings taken from the search, valid or not (divided
+    // between threads in InitSearch()).
+    total_max_evaluations_ = 0;
+    mapper.lookupValue("max-evaluations", total_max_evaluations_);
   
     // Number of consecutive invalid mappings to trigger termination.
     timeout_ = 1000;
@@ -206,6 +243,17 @@ class Application
     mapper.lookupValue("diagnostics", diagnostics_on_);
     emit_whoop_nest_ = false;
     mapper.lookupValue("emit-whoop-nest", emit_whoop_nest_);    
+    trace_ = false;
+    mapper.lookupValue("trace", trace_);
+    perf_counters_ = false;
+    mapper.lookupValue("perf-counters", perf_counters_);
+    allocation_budget_ = -1;
+    if (mapper.lookupValue("allocation-budget", allocation_budget_) && !alloc::kEnabled)
+    {
+      std::cerr << "ERROR: allocation-budget requires a build with allocation tracking "
+                << "(scons --alloc-tracking)." << std::endl;
+      exit(1);
+    }
     std::cout << "Mapper configuration complete." << std::endl;
 
     // MapSpace configuration.
@@ -234,17 +282,14 @@ class Application
     // }
 
     mapspace_ = mapspace::ParseAndConstruct(mapspace, arch_constraints, arch_specs_, workload_);
-    split_mapspaces_ = mapspace_->Split(num_threads_);
-
-    std::cout << "Mapspace construction complete." << std::endl;
 
     // Search configuration.
-    auto search = rootNode.lookup("mapper");
-    for (unsigned t = 0; t < num_threads_; t++)
+    search_config_ = rootNode.lookup("mapper");
+    if (!defer_search)
     {
-      search_.push_back(search::ParseAndConstruct(search, split_mapspaces_.at(t), t));
+      InitSearch(num_threads_);
     }
-    std::cout << "Search configuration complete." << std::endl;
+
     // Store the complete configuration in a string.
     if (config->hasLConfig()) {
       std::size_t len;
@@ -284,6 +329,262 @@ class Application
     return global_best_;
   }
 
+  mapspace::MapSpace* GetMapSpace()
+  {
+    return mapspace_;
+  }
+
+  const model::Engine::Specs& GetArchSpecs() const
+  {
+    return arch_specs_;
+  }
+
+  const problem::Workload& GetWorkload() const
+  {
+    return workload_;
+  }
+
+  const std::vector<std::string>& GetOptimizationMetrics() const
+  {
+    return optimization_metrics_;
+  }
+
+  std::uint32_t NumThreads() const
+  {
+    return num_threads_;
+  }
+
+  std::uint32_t TotalSearchSize() const
+  {
+    return total_search_size_;
+  }
+
+  // Wall-clock time into Run() at which the final best mapping was found
+  // (0 if it was a warm-start seed).
+  double TimeToBestMs() const
+  {
+    return time_to_best_ms_;
+  }
+
+  // Candidates the last Run() skipped because their cost bound was worse
+  // than the warm-start incumbent (see MapperThread::Seed()).
+  std::uint64_t NumBoundPruned() const
+  {
+    return num_bound_pruned_;
+  }
+
+  // Hardware counters per mapping for each stage of the mapper loop,
+  // summed over all threads.
+  static void PrintPerfCounters(std::ostream& out, const std::vector<MapperThread*>& threads)
+  {
+    std::array<StagePerfCounts, unsigned(MapperStage::Num)> totals;
+    std::string error;
+    for (auto thread : threads)
+    {
+      auto& thread_counts = thread->StagePerfEvents();
+      for (unsigned stage = 0; stage < unsigned(MapperStage::Num); stage++)
+      {
+        totals[stage].mappings += thread_counts[stage].mappings;
+        for (unsigned counter = 0; counter < PerfCounters::Num; counter++)
+          totals[stage].values[counter] += thread_counts[stage].values[counter];
+      }
+      if (error.empty())
+        error = thread->PerfEventsError();
+    }
+
+    if (totals[unsigned(MapperStage::Construct)].mappings == 0)
+    {
+      out << "Hardware counters unavailable (" << error << "). Check that the kernel "
+          << "exposes a PMU and that /proc/sys/kernel/perf_event_paranoid is at most 2." << std::endl;
+      return;
+    }
+
+    static const char* stage_names[] = { "construct", "precheck", "evaluate" };
+    std::stringstream table;
+    table << "Hardware counters per mapping (user space, all threads):" << std::endl;
+    table << "  " << std::left << std::setw(10) << "stage" << std::right << std::setw(10) << "mappings";
+    for (unsigned counter = 0; counter < PerfCounters::Num; counter++)
+      table << std::setw(15) << PerfCounters::Name(counter);
+    table << std::setw(7) << "IPC" << std::endl;
+    table << std::fixed;
+    for (unsigned stage = 0; stage < unsigned(MapperStage::Num); stage++)
+    {
+      auto& counts = totals[stage];
+      table << "  " << std::left << std::setw(10) << stage_names[stage] << std::right
+            << std::setw(10) << counts.mappings;
+      for (unsigned counter = 0; counter < PerfCounters::Num; counter++)
+      {
+        // A counter that never counted anything was most likely not opened.
+        if (counts.mappings > 0 && counts.values[counter] > 0)
+          table << std::setw(15) << std::setprecision(1) << double(counts.values[counter]) / counts.mappings;
+        else
+          table << std::setw(15) << "-";
+      }
+      if (counts.values[PerfCounters::Cycles] > 0)
+        table << std::setw(7) << std::setprecision(2)
+              << double(counts.values[PerfCounters::Instructions]) / counts.values[PerfCounters::Cycles];
+      else
+        table << std::setw(7) << "-";
+      table << std::endl;
+    }
+    if (!error.empty())
+      table << "  (some counters unavailable: " << error << ")" << std::endl;
+    out << table.str();
+  }
+
+  // Heap allocations per mapping for each stage of the mapper loop, summed
+  // over all threads, followed by the steady-state Engine::Evaluate() counts
+  // of each thread. Returns the mean allocations per steady-state
+  // evaluation over all threads (0 if there were none).
+  static double PrintAllocations(std::ostream& out, const std::vector<MapperThread*>& threads)
+  {
+    std::array<StageAllocCounts, unsigned(MapperStage::Num)> totals;
+    StageAllocCounts steady;
+    alloc::Counts run;
+    uint128_t num_mappings = 0;
+    for (auto thread : threads)
+    {
+      for (unsigned stage = 0; stage < unsigned(MapperStage::Num); stage++)
+      {
+        auto& counts = thread->StageAllocations()[stage];
+        totals[stage].mappings += counts.mappings;
+        totals[stage].total += counts.total;
+        totals[stage].max_allocations = std::max(totals[stage].max_allocations, counts.max_allocations);
+      }
+      auto& thread_steady = thread->SteadyStateEvaluateAllocations();
+      steady.mappings += thread_steady.mappings;
+      steady.total += thread_steady.total;
+      steady.max_allocations = std::max(steady.max_allocations, thread_steady.max_allocations);
+      run += thread->RunAllocations();
+      num_mappings += thread->NumMappings();
+    }
+
+    static const char* stage_names[] = { "construct", "precheck", "evaluate" };
+    std::stringstream table;
+    table << std::fixed << std::setprecision(1);
+    table << "Heap allocations per mapping (all threads):" << std::endl;
+    table << "  " << std::left << std::setw(10) << "stage" << std::right << std::setw(10) << "mappings"
+          << std::setw(13) << "allocs" << std::setw(13) << "bytes" << std::setw(13) << "max allocs" << std::endl;
+    auto row = [&table](const std::string& name, const StageAllocCounts& counts)
+      {
+        table << "  " << std::left << std::setw(10) << name << std::right << std::setw(10) << counts.mappings;
+        if (counts.mappings > 0)
+          table << std::setw(13) << double(counts.total.allocations) / counts.mappings
+                << std::setw(13) << double(counts.total.bytes) / counts.mappings
+                << std::setw(13) << counts.max_allocations;
+        else
+          table << std::setw(13) << "-" << std::setw(13) << "-" << std::setw(13) << "-";
+        table << std::endl;
+      };
+    for (unsigned stage = 0; stage < unsigned(MapperStage::Num); stage++)
+      row(stage_names[stage], totals[stage]);
+    row("steady", steady);
+
+    // Everything else: search, bookkeeping, and engine set-up.
+    alloc::Counts other = run;
+    for (auto& counts : totals)
+      other = other - counts.total;
+    if (num_mappings > 0)
+      table << "  " << std::left << std::setw(10) << "other" << std::right << std::setw(10)
+            << std::uint64_t(num_mappings) << std::setw(13) << double(other.allocations) / double(num_mappings)
+            << std::setw(13) << double(other.bytes) / double(num_mappings) << std::setw(13) << "-" << std::endl;
+
+    if (threads.size() > 1)
+    {
+      table << "  steady-state evaluate allocs per thread:";
+      for (auto thread : threads)
+      {
+        auto& counts = thread->SteadyStateEvaluateAllocations();
+        if (counts.mappings > 0)
+          table << " " << double(counts.total.allocations) / counts.mappings;
+        else
+          table << " -";
+      }
+      table << std::endl;
+    }
+    out << table.str();
+
+    return steady.mappings > 0 ? double(steady.total.allocations) / steady.mappings : 0;
+  }
+
+  // ------------------------------------------------------------------
+  // Warm start: re-validate candidate mappings (typically the best ones
+  // found for neighboring design points) on this architecture and keep
+  // the best valid one as every thread's starting incumbent. Returns the
+  // number of candidates that were valid here.
+  // ------------------------------------------------------------------
+  unsigned Seed(std::vector<Mapping> candidates)
+  {
+    unsigned num_valid = 0;
+    model::Engine engine;
+    engine.Spec(arch_specs_);
+    for (auto& mapping : candidates)
+    {
+      // Mappings from a differently-shaped hierarchy cannot be re-used, and
+      // neither can mappings outside this point's mapspace constraints.
+      if (mapping.loop_nest.storage_tiling_boundaries.size() != arch_specs_.topology.NumStorageLevels())
+        continue;
+      if (!mapspace_->ConstraintsSatisfiedBy(&mapping))
+        continue;
+
+      auto status_per_level = engine.PreEvaluationCheck(mapping, workload_, true);
+      bool success = std::accumulate(status_per_level.begin(), status_per_level.end(), true,
+                                     [](bool cur, const model::EvalStatus& status)
+                                     { return cur && status.success; });
+      if (!success)
+        continue;
+
+      status_per_level = engine.Evaluate(mapping, workload_, true);
+      success = std::accumulate(status_per_level.begin(), status_per_level.end(), true,
+                                [](bool cur, const model::EvalStatus& status)
+                                { return cur && status.success; });
+      if (!success)
+        continue;
+
+      EvaluationResult candidate;
+      candidate.valid = true;
+      candidate.mapping = mapping;
+      candidate.stats = engine.GetTopology().GetStats();
+      seed_.UpdateIfBetter(candidate, optimization_metrics_);
+      num_valid++;
+    }
+    return num_valid;
+  }
+
+  // ---------------------------------------------------
+  // Split the mapspace and build one search per thread.
+  // ---------------------------------------------------
+  void InitSearch(std::uint32_t num_threads)
+  {
+    assert(search_.empty());
+    assert(num_threads > 0);
+    if (num_threads != num_threads_)
+    {
+      std::cout << "Using threads = " << num_threads << std::endl;
+    }
+    num_threads_ = num_threads;
+
+    std::uint32_t search_size = total_search_size_;
+    if (search_size > 0)
+      search_size = 1 + (search_size - 1) / num_threads_;
+    search_size_ = static_cast<uint128_t>(search_size);
+
+    std::uint32_t max_evaluations = total_max_evaluations_;
+    if (max_evaluations > 0)
+      max_evaluations = 1 + (max_evaluations - 1) / num_threads_;
+    max_evaluations_ = static_cast<uint128_t>(max_evaluations);
+
+    split_mapspaces_ = mapspace_->Split(num_threads_);
+
+    std::cout << "Mapspace construction complete." << std::endl;
+
+    for (unsigned t = 0; t < num_threads_; t++)
+    {
+      search_.push_back(search::ParseAndConstruct(search_config_, split_mapspaces_.at(t), t));
+    }
+    std::cout << "Search configuration complete." << std::endl;
+  }
+
   // ---------------
   // Run the mapper.
   // ---------------
@@ -293,6 +594,8 @@ class Application
     std::string log_file_name = out_prefix_ + ".log";
     std::string stats_file_name = out_prefix_ + ".stats.txt";
     std::string xml_file_name = out_prefix_ + ".map+stats.xml";
+    std::string bin_file_name = out_prefix_ + ".map+stats.bin";
+    std::string trace_file_name = out_prefix_ + ".trace.bin";
     std::string map_txt_file_name = out_prefix_ + ".map.txt";
     std::string map_cfg_file_name = out_prefix_ + ".map.cfg";
     std::string map_cpp_file_name = out_prefix_ + ".map.cpp";
@@ -342,6 +645,7 @@ class Application
                                           split_mapspaces_.at(t),
                                           &mutex,
                                           search_size_,
+                                          max_evaluations_,
                                           timeout_,
                                           victory_condition_,
                                           sync_interval_,
@@ -356,7 +660,36 @@ class Application
                                           &best_));
     }
 
+    // Optional trace of every evaluated mapping (see mapping-trace.hpp).
+    std::unique_ptr<MappingTraceWriter> trace;
+    if (trace_)
+    {
+      trace.reset(new MappingTraceWriter(trace_file_name, arch_specs_.topology.LevelNames()));
+      for (unsigned t = 0; t < num_threads_; t++)
+      {
+        threads_.at(t)->Trace(trace.get());
+      }
+    }
+
+    if (perf_counters_)
+    {
+      for (unsigned t = 0; t < num_threads_; t++)
+      {
+        threads_.at(t)->CountPerfEvents();
+      }
+    }
+
+    // Start every thread from the warm-start incumbent, if there is one.
+    if (seed_.valid)
+    {
+      for (unsigned t = 0; t < num_threads_; t++)
+      {
+        threads_.at(t)->Seed(seed_);
+      }
+    }
+
     // Launch the threads.
+    auto search_start = std::chrono::steady_clock::now();
     for (unsigned t = 0; t < num_threads_; t++)
     {
       threads_.at(t)->Start();
@@ -367,6 +700,15 @@ class Application
     {
       threads_.at(t)->Join();
     }
+    double search_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - search_start).count();
+
+    if (trace)
+    {
+      trace->Close();
+      std::cout << "Mapping trace: " << trace->RowsWritten() << " mappings, "
+                << trace->CompressedBytes() << " bytes (" << trace->RawBytes()
+                << " uncompressed) written to " << trace_file_name << std::endl;
+    }
 
     // Close log and end curses.
     if (live_status_)
@@ -451,7 +793,62 @@ class Application
     for (unsigned t = 0; t < num_threads_; t++)
     {
       auto& thread_best = threads_.at(t)->BestResult();
-      global_best_.UpdateIfBetter(thread_best, optimization_metrics_);
+      if (global_best_.UpdateIfBetter(thread_best, optimization_metrics_))
+        time_to_best_ms_ = threads_.at(t)->TimeToBestMs();
+    }
+
+    // Search throughput, for scripts/bench_mapper.py among others.
+    uint128_t num_mappings = 0;
+    uint128_t num_valid_mappings = 0;
+    uint128_t num_bound_pruned = 0;
+    for (unsigned t = 0; t < num_threads_; t++)
+    {
+      num_mappings += threads_.at(t)->NumMappings();
+      num_valid_mappings += threads_.at(t)->NumValidMappings();
+      num_bound_pruned += threads_.at(t)->NumBoundPruned();
+    }
+    num_bound_pruned_ = std::uint64_t(num_bound_pruned);
+    std::stringstream throughput;
+    throughput << "Search: " << std::uint64_t(num_mappings) << " mappings evaluated ("
+               << std::uint64_t(num_valid_mappings) << " valid) on " << num_threads_ << " threads in "
+               << std::fixed << std::setprecision(3) << search_s << " s, "
+               << std::setprecision(1) << (search_s > 0 ? double(num_mappings) / search_s : 0)
+               << " mappings/s";
+    std::cout << throughput.str() << std::endl;
+    if (seed_.valid)
+    {
+      std::cout << "Search: " << num_bound_pruned_ << " mappings pruned without evaluation, "
+                << "their cost bound exceeding the warm-start incumbent" << std::endl;
+    }
+
+    model::NetworkMemoCounters network_memo;
+    for (unsigned t = 0; t < num_threads_; t++)
+    {
+      network_memo += threads_.at(t)->NetworkMemo();
+    }
+    if (network_memo.hits + network_memo.misses > 0)
+    {
+      std::stringstream memo_report;
+      memo_report << "Network memo: " << network_memo.hits << " hits / " << network_memo.hits + network_memo.misses
+                  << " lookups (" << std::fixed << std::setprecision(1) << 100 * network_memo.HitRate() << "%)";
+      std::cout << memo_report.str() << std::endl;
+    }
+
+    if (perf_counters_)
+    {
+      PrintPerfCounters(std::cout, threads_);
+    }
+
+    if (alloc::kEnabled)
+    {
+      double steady_allocations = PrintAllocations(std::cout, threads_);
+      if (allocation_budget_ >= 0 && steady_allocations > allocation_budget_)
+      {
+        std::cerr << "ERROR: steady-state evaluations make " << std::fixed << std::setprecision(1) << steady_allocations
+                  << " heap allocations on average, over the allocation-budget of "
+                  << allocation_budget_ << "." << std::endl;
+        exit(1);
+      }
     }
 
     std::cout << std::endl;
@@ -494,13 +891,21 @@ class Application
                 << std::fixed << std::setprecision(3) << global_best_.stats.energy /
         global_best_.stats.maccs << std::endl;
 
-      // Print the engine stats and mapping to an XML file
-      std::ofstream ofs(xml_file_name);
-      boost::archive::xml_oarchive ar(ofs);
-      ar << boost::serialization::make_nvp("engine", engine);
-      ar << boost::serialization::make_nvp("mapping", global_best_.mapping);
-      const Application* a = this;
-      ar << BOOST_SERIALIZATION_NVP(a);
+      // Print the engine stats and mapping to an XML and/or binary file.
+      if (stats_format_ != "binary")
+      {
+        std::ofstream ofs(xml_file_name);
+        boost::archive::xml_oarchive ar(ofs);
+        ar << boost::serialization::make_nvp("engine", engine);
+        ar << boost::serialization::make_nvp("mapping", global_best_.mapping);
+        const Application* a = this;
+        ar << BOOST_SERIALIZATION_NVP(a);
+      }
+      if (stats_format_ != "xml")
+      {
+        if (!model::BinaryStats::Save(bin_file_name, engine, global_best_.mapping, workload_, config_text_))
+          std::cerr << "WARNING: could not write " << bin_file_name << std::endl;
+      }
     }
     else
     {
@@ -513,7 +918,7 @@ class Application
                 << "    Try to find the offending constraints that are likely to have caused the" << std::endl
                 << "    above violations, and disable those constraints." << std::endl;
       std::cout << "(3) Try other search algorithms, and relax the termination criteria:" << std::endl
-                << "    victory-condition, timeout and/or search-size." << std::endl;
+                << "    victory-condition, timeout, search-size and/or max-evaluations." << std::endl;
       if (!diagnostics_on_)
       {
         std::cout << "(4) Enable mapper's diagnostics (mapper.diagnostics = True) to track and emit " << std::endl
@@ -545,6 +950,9 @@ class Application
     if (mapper.exists("search_size"))
       mapper.remove("search_size");
 
+    if (mapper.exists("max-evaluations"))
+      mapper.remove("max-evaluations");
+
     if (mapper.exists("search-size"))
       mapper["search-size"] = 1;
     else
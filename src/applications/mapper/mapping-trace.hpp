@@ -0,0 +1,374 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include "mapspaces/mapspace-base.hpp"
+#include "model/topology.hpp"
+
+//--------------------------------------------//
+//                Mapping Trace               //
+//--------------------------------------------//
+
+// Optional trace of every mapping the mapper threads evaluate, valid or
+// not, for offline analysis of the search's cost landscape (enabled with
+// mapper.trace = True). Each thread fills its own columnar chunk without
+// any locking. Full chunks are handed to a background writer that
+// compresses (zlib) and appends them to <prefix>.trace.bin, and an
+// already-written chunk is handed back for reuse, so steady-state tracing
+// does not allocate.
+//
+// File layout (native endianness):
+//   magic[8] version:u32 num_columns:u32
+//   { name:char[]\0 type:char size:u8 }[num_columns]    (type: u, i or f)
+//   { thread_id:u32 rows:u32 raw_bytes:u64 compressed_bytes:u64
+//     zlib(column[0][rows] column[1][rows] ...) }*
+//
+// scripts/parse_mapping_trace.py reads this format.
+
+enum class TraceStatus : std::uint8_t
+{
+  Success,
+  ConstructionFailure, // The mapping ID did not decode into a legal mapping.
+  PreEvalFailure,      // Rejected by the model's pre-evaluation check.
+  EvalFailure,         // Rejected by the full evaluation.
+  BoundPruned          // Skipped: its cost bound exceeds the incumbent's cost.
+};
+
+class MappingTraceChunk
+{
+ public:
+  static const unsigned kRows = 4096;
+  static const unsigned kDims = unsigned(mapspace::Dimension::Num);
+
+  unsigned thread_id;
+  unsigned num_levels;
+  unsigned rows = 0;
+
+  // Columns. Mapping IDs are 128-bit and are split into low/high words.
+  std::vector<std::uint64_t> id_lo;
+  std::vector<std::uint64_t> id_hi;
+  std::vector<std::uint64_t> dim_lo[kDims];
+  std::vector<std::uint64_t> dim_hi[kDims];
+  std::vector<std::uint8_t> status;
+  std::vector<std::int8_t> fail_level; // First failing level id, -1 if none.
+  std::vector<std::uint32_t> eval_ns;  // Construction + evaluation time.
+  std::vector<double> energy;
+  std::vector<std::uint64_t> cycles;
+  std::vector<std::uint64_t> accesses; // Column-major: level * kRows + row.
+
+  MappingTraceChunk(unsigned thread, unsigned levels) :
+      thread_id(thread),
+      num_levels(levels),
+      id_lo(kRows), id_hi(kRows),
+      status(kRows), fail_level(kRows), eval_ns(kRows),
+      energy(kRows), cycles(kRows),
+      accesses(levels * kRows)
+  {
+    for (unsigned d = 0; d < kDims; d++)
+    {
+      dim_lo[d].resize(kRows);
+      dim_hi[d].resize(kRows);
+    }
+  }
+
+  bool Full() const { return rows == kRows; }
+
+  // Append a row. topology must hold the stats of this mapping if (and only
+  // if) status is Success.
+  void Add(const mapspace::ID& mapping_id, TraceStatus row_status, int row_fail_level,
+           std::uint32_t row_eval_ns, const model::Topology* topology)
+  {
+    unsigned row = rows++;
+
+    SplitID(mapping_id.Integer(), id_lo[row], id_hi[row]);
+    auto dims = mapping_id.Read();
+    for (unsigned d = 0; d < kDims; d++)
+      SplitID(dims[d], dim_lo[d][row], dim_hi[d][row]);
+
+    status[row] = std::uint8_t(row_status);
+    fail_level[row] = std::int8_t(row_fail_level);
+    eval_ns[row] = row_eval_ns;
+
+    if (row_status == TraceStatus::Success)
+    {
+      auto& stats = topology->GetStats();
+      energy[row] = stats.energy;
+      cycles[row] = stats.cycles;
+      for (unsigned level = 0; level < num_levels; level++)
+        accesses[level * kRows + row] = topology->LevelAccesses(level);
+    }
+    else
+    {
+      energy[row] = 0;
+      cycles[row] = 0;
+      for (unsigned level = 0; level < num_levels; level++)
+        accesses[level * kRows + row] = 0;
+    }
+  }
+
+  // Concatenate the first `rows` entries of every column, in schema order.
+  void Serialize(std::string& out) const
+  {
+    out.clear();
+    Append(out, id_lo);
+    Append(out, id_hi);
+    for (unsigned d = 0; d < kDims; d++)
+    {
+      Append(out, dim_lo[d]);
+      Append(out, dim_hi[d]);
+    }
+    Append(out, status);
+    Append(out, fail_level);
+    Append(out, eval_ns);
+    Append(out, energy);
+    Append(out, cycles);
+    for (unsigned level = 0; level < num_levels; level++)
+      out.append(reinterpret_cast<const char*>(accesses.data() + level * kRows),
+                 rows * sizeof(std::uint64_t));
+  }
+
+  // Column names and types, in Serialize() order.
+  static std::vector<std::pair<std::string, std::string>> Schema(const std::vector<std::string>& level_names)
+  {
+    std::vector<std::pair<std::string, std::string>> schema = {
+      { "id_lo", "u8" }, { "id_hi", "u8" } };
+    for (unsigned d = 0; d < kDims; d++)
+    {
+      std::stringstream name;
+      name << mapspace::Dimension(d);
+      schema.push_back({ name.str() + "_lo", "u8" });
+      schema.push_back({ name.str() + "_hi", "u8" });
+    }
+    schema.push_back({ "status", "u1" });
+    schema.push_back({ "fail_level", "i1" });
+    schema.push_back({ "eval_ns", "u4" });
+    schema.push_back({ "energy", "f8" });
+    schema.push_back({ "cycles", "u8" });
+    for (auto& name : level_names)
+      schema.push_back({ "accesses." + name, "u8" });
+    return schema;
+  }
+
+ private:
+  static void SplitID(const uint128_t& id, std::uint64_t& lo, std::uint64_t& hi)
+  {
+    lo = static_cast<std::uint64_t>(id & std::numeric_limits<std::uint64_t>::max());
+    hi = static_cast<std::uint64_t>(id >> 64);
+  }
+
+  template<class T>
+  void Append(std::string& out, const std::vector<T>& column) const
+  {
+    out.append(reinterpret_cast<const char*>(column.data()), rows * sizeof(T));
+  }
+};
+
+class MappingTraceWriter
+{
+ private:
+  // Bound on chunks waiting to be written. Threads block on Submit() when
+  // the writer falls this far behind, which bounds memory use.
+  static const unsigned kMaxPending = 64;
+
+  std::ofstream out_;
+  unsigned num_levels_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::unique_ptr<MappingTraceChunk>> pending_;
+  std::vector<std::unique_ptr<MappingTraceChunk>> free_;
+  bool done_ = false;
+  std::thread thread_;
+
+  std::uint64_t rows_written_ = 0;
+  std::uint64_t raw_bytes_ = 0;
+  std::uint64_t compressed_bytes_ = 0;
+
+ public:
+  MappingTraceWriter(const std::string& path, const std::vector<std::string>& level_names) :
+      out_(path, std::ios::binary),
+      num_levels_(level_names.size())
+  {
+    if (!out_)
+    {
+      std::cerr << "ERROR: cannot open mapping trace file: " << path << std::endl;
+      exit(1);
+    }
+
+    static const char kTraceMagic[8] = { 'T', 'L', 'T', 'R', 'A', 'C', 'E', '\0' };
+    const std::uint32_t version = 1;
+    auto schema = MappingTraceChunk::Schema(level_names);
+    const std::uint32_t num_columns = schema.size();
+
+    out_.write(kTraceMagic, sizeof(kTraceMagic));
+    out_.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    out_.write(reinterpret_cast<const char*>(&num_columns), sizeof(num_columns));
+    for (auto& column : schema)
+    {
+      out_.write(column.first.c_str(), column.first.size() + 1);
+      out_.put(column.second[0]);
+      out_.put(char(column.second[1] - '0'));
+    }
+
+    thread_ = std::thread(&MappingTraceWriter::Run, this);
+  }
+
+  ~MappingTraceWriter()
+  {
+    Close();
+  }
+
+  // A fresh (or recycled) empty chunk for a mapper thread.
+  std::unique_ptr<MappingTraceChunk> NewChunk(unsigned thread_id)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return NewChunkLocked(thread_id);
+  }
+
+  // Queue a full chunk for writing and return an empty one in its place.
+  std::unique_ptr<MappingTraceChunk> Submit(std::unique_ptr<MappingTraceChunk> chunk)
+  {
+    unsigned thread_id = chunk->thread_id;
+    std::unique_lock<std::mutex> lock(mutex_);
+    EnqueueLocked(std::move(chunk), lock);
+    return NewChunkLocked(thread_id);
+  }
+
+  // Queue a thread's last (possibly partial) chunk.
+  void Finish(std::unique_ptr<MappingTraceChunk> chunk)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    EnqueueLocked(std::move(chunk), lock);
+  }
+
+  // Drain the queue and close the file.
+  void Close()
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (done_)
+        return;
+      done_ = true;
+      cv_.notify_all();
+    }
+    thread_.join();
+    out_.close();
+  }
+
+  std::uint64_t RowsWritten() const { return rows_written_; }
+  std::uint64_t RawBytes() const { return raw_bytes_; }
+  std::uint64_t CompressedBytes() const { return compressed_bytes_; }
+
+ private:
+  void EnqueueLocked(std::unique_ptr<MappingTraceChunk> chunk, std::unique_lock<std::mutex>& lock)
+  {
+    cv_.wait(lock, [this] { return pending_.size() < kMaxPending; });
+    if (chunk->rows > 0)
+      pending_.push_back(std::move(chunk));
+    else
+      free_.push_back(std::move(chunk));
+    cv_.notify_all();
+  }
+
+  std::unique_ptr<MappingTraceChunk> NewChunkLocked(unsigned thread_id)
+  {
+    if (free_.empty())
+      return std::unique_ptr<MappingTraceChunk>(new MappingTraceChunk(thread_id, num_levels_));
+
+    auto chunk = std::move(free_.back());
+    free_.pop_back();
+    chunk->thread_id = thread_id;
+    chunk->rows = 0;
+    return chunk;
+  }
+
+  void Run()
+  {
+    std::string raw, compressed;
+    while (true)
+    {
+      std::unique_ptr<MappingTraceChunk> chunk;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return done_ || !pending_.empty(); });
+        if (pending_.empty())
+          return; // done_ and drained.
+        chunk = std::move(pending_.front());
+        pending_.pop_front();
+        cv_.notify_all();
+      }
+
+      chunk->Serialize(raw);
+
+      // Level 1: the trace must keep up with the mapper threads, and the
+      // columns (IDs, zeroed stats of failed mappings) compress well anyway.
+      compressed.clear();
+      {
+        boost::iostreams::filtering_ostream zout;
+        zout.push(boost::iostreams::zlib_compressor(boost::iostreams::zlib::best_speed));
+        zout.push(boost::iostreams::back_inserter(compressed));
+        zout.write(raw.data(), raw.size());
+      }
+
+      const std::uint32_t thread_id = chunk->thread_id;
+      const std::uint32_t rows = chunk->rows;
+      const std::uint64_t raw_bytes = raw.size();
+      const std::uint64_t compressed_bytes = compressed.size();
+      out_.write(reinterpret_cast<const char*>(&thread_id), sizeof(thread_id));
+      out_.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+      out_.write(reinterpret_cast<const char*>(&raw_bytes), sizeof(raw_bytes));
+      out_.write(reinterpret_cast<const char*>(&compressed_bytes), sizeof(compressed_bytes));
+      out_.write(compressed.data(), compressed.size());
+
+      rows_written_ += rows;
+      raw_bytes_ += raw_bytes;
+      compressed_bytes_ += compressed_bytes;
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      free_.push_back(std::move(chunk));
+    }
+  }
+};
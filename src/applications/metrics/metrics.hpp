@@ -76,11 +76,7 @@ class Application
 #ifdef USE_ACCELERGY
       // Call accelergy ERT with all input files
       if (arch.exists("subtree") || arch.exists("local")) {
-        accelergy::invokeAccelergy(config->inFiles, out_prefix_, ".");
-        std::string ertPath = out_prefix_ + ".ERT.yaml";
-        auto ertConfig = new config::CompoundConfig(ertPath.c_str());
-        auto ert = ertConfig->getRoot().lookup("ERT");
-        arch_specs_.topology.ParseAccelergyERT(ert);
+        accelergy::applyCachedERT(*config, out_prefix_, ".", arch_specs_.topology, false);
       }
 #endif
     }
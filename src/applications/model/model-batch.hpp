@@ -0,0 +1,231 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+#include "model-request.hpp"
+
+//--------------------------------------------//
+//                Model Batch                 //
+//--------------------------------------------//
+
+// Batch evaluation for timeloop-model: reads a file of mapping requests (see
+// model-request.hpp), e.g., JSON lines or a multi-document YAML file, and
+// evaluates them in parallel on one engine per thread. Workers claim
+// requests by index and scatter their stats into pre-sized columns, and each
+// parses mappings against its own copy of the config variables (see
+// RequestEvaluator::Worker). Workers therefore share nothing but the
+// read-only specs and an atomic counter, and the results table comes out in
+// input order regardless of the thread count.
+
+class ModelBatch
+{
+ private:
+  using Outcome = RequestEvaluator::Outcome;
+
+  RequestEvaluator evaluator_;
+  unsigned num_threads_;
+
+  // Inputs and results, indexed by request.
+  std::vector<std::string> requests_;
+  std::vector<Outcome> outcomes_;
+  std::vector<std::string> ids_;
+  std::vector<std::string> messages_;
+  model::Engine::BatchStats stats_;
+
+  std::atomic<std::size_t> next_request_;
+
+ public:
+  ModelBatch(config::CompoundConfig* config,
+             const problem::Workload& workload,
+             model::Engine::Specs& arch_specs,
+             const mapping::Constraints* constraints,
+             unsigned num_threads) :
+      evaluator_(config, workload, arch_specs, constraints),
+      num_threads_(std::max(num_threads, 1U))
+  {
+  }
+
+  // Evaluate all requests in input_file_name and write the results table to
+  // output_file_name.
+  void Run(const std::string& input_file_name, const std::string& output_file_name)
+  {
+    std::ifstream input(input_file_name);
+    if (!input)
+    {
+      std::cerr << "ERROR: cannot open batch mapping file: " << input_file_name << std::endl;
+      exit(1);
+    }
+    RequestEvaluator::SplitRequests(
+      [&](std::string& line) { return bool(std::getline(input, line)); },
+      [&](std::string text) { requests_.push_back(std::move(text)); });
+
+    auto num_requests = requests_.size();
+    auto num_threads = unsigned(std::min<std::size_t>(num_threads_, std::max<std::size_t>(num_requests, 1)));
+    outcomes_.assign(num_requests, Outcome::Error);
+    ids_.assign(num_requests, "");
+    messages_.assign(num_requests, "");
+    stats_.Reset(num_requests, evaluator_.LevelNames().size());
+    next_request_ = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < num_threads; t++)
+      workers.emplace_back(&ModelBatch::Work, this);
+    for (auto& worker : workers)
+      worker.join();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    WriteResults(output_file_name);
+
+    std::array<std::size_t, 3> counts = { 0, 0, 0 };
+    std::size_t best = num_requests;
+    for (std::size_t i = 0; i < num_requests; i++)
+    {
+      counts[unsigned(outcomes_[i])]++;
+      if (outcomes_[i] == Outcome::Success && (best == num_requests || stats_.energy[i] < stats_.energy[best]))
+        best = i;
+    }
+
+    std::cout << "Evaluated " << num_requests << " mappings (" << counts[0] << " ok, " << counts[1]
+              << " invalid, " << counts[2] << " errors) on " << num_threads << " threads in "
+              << std::fixed << std::setprecision(3) << elapsed.count() << " s ("
+              << std::setprecision(1) << num_requests / elapsed.count() << " mappings/s), results in "
+              << output_file_name << std::endl;
+    if (best < num_requests)
+      std::cout << "Best energy: mapping " << ids_[best] << " | Utilization = " << std::setprecision(2)
+                << stats_.utilization[best] << " | pJ/MACC = " << std::setw(8) << std::setprecision(3)
+                << stats_.energy[best] / stats_.maccs[best] << std::endl;
+  }
+
+ private:
+  void Work()
+  {
+    RequestEvaluator::Worker worker;
+    evaluator_.InitWorker(worker);
+    auto& engine = worker.engine;
+
+    auto num_levels = evaluator_.LevelNames().size();
+    auto num_requests = requests_.size();
+
+    for (auto i = next_request_++; i < num_requests; i = next_request_++)
+    {
+      auto result = evaluator_.Evaluate(requests_[i], i, worker);
+      outcomes_[i] = result.outcome;
+      ids_[i] = std::move(result.id);
+
+      if (result.outcome == Outcome::Error)
+      {
+        messages_[i] = result.error;
+      }
+      else if (result.outcome == Outcome::Invalid)
+      {
+        for (unsigned level = 0; level < result.eval_status.size(); level++)
+          if (!result.eval_status[level].success)
+            messages_[i] += (messages_[i].empty() ? "" : "; ") + evaluator_.LevelNames().at(level) +
+              ": " + result.eval_status[level].fail_reason;
+      }
+      else
+      {
+        auto& topology = engine.GetTopology();
+        stats_.success[i] = 1;
+        stats_.energy[i] = engine.Energy();
+        stats_.area[i] = engine.Area();
+        stats_.cycles[i] = engine.Cycles();
+        stats_.utilization[i] = engine.Utilization();
+        stats_.maccs[i] = topology.MACCs();
+        stats_.last_level_accesses[i] = topology.LastLevelAccesses();
+        for (unsigned level = 0; level < num_levels; level++)
+        {
+          stats_.level_energy[level * num_requests + i] = topology.LevelEnergy(level);
+          stats_.level_accesses[level * num_requests + i] = topology.LevelAccesses(level);
+        }
+      }
+    }
+  }
+
+  // One row per request in input order, one column per stat. Stats of
+  // failed mappings are left empty; their message column says why.
+  void WriteResults(const std::string& output_file_name)
+  {
+    static const char* status_names[] = { "ok", "invalid", "error" };
+    auto& level_names = evaluator_.LevelNames();
+
+    std::ofstream out(output_file_name);
+    out << std::setprecision(10);
+    out << "index,id,status,MACCs,cycles,utilization,energy (pJ),pJ/MACC";
+    for (auto& name : level_names)
+      out << "," << name << " energy (pJ)," << name << " accesses";
+    out << ",message" << std::endl;
+
+    for (std::size_t i = 0; i < requests_.size(); i++)
+    {
+      out << i << "," << CSVField(ids_[i]) << "," << status_names[unsigned(outcomes_[i])];
+      if (stats_.success[i])
+      {
+        out << "," << stats_.maccs[i]
+            << "," << stats_.cycles[i]
+            << "," << stats_.utilization[i]
+            << "," << stats_.energy[i]
+            << "," << stats_.energy[i] / stats_.maccs[i];
+        for (unsigned level = 0; level < level_names.size(); level++)
+          out << "," << stats_.LevelEnergy(level, i) << "," << stats_.LevelAccesses(level, i);
+      }
+      else
+      {
+        out << std::string(5 + 2 * level_names.size(), ',');
+      }
+      out << "," << CSVField(messages_[i]) << std::endl;
+    }
+  }
+
+  static std::string CSVField(const std::string& field)
+  {
+    if (field.find_first_of(",\"\n") == std::string::npos)
+      return field;
+    std::string quoted = "\"";
+    for (char c : field)
+    {
+      quoted += c;
+      if (c == '"')
+        quoted += '"';
+    }
+    return quoted + "\"";
+  }
+};
@@ -0,0 +1,273 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <cctype>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <yaml-cpp/yaml.h>
+
+#include "model/engine.hpp"
+#include "mapping/parser.hpp"
+#include "mapping/constraints.hpp"
+#include "compound-config/compound-config.hpp"
+
+//--------------------------------------------//
+//              Mapping Requests              //
+//--------------------------------------------//
+
+// Mappings submitted to timeloop-model's server and batch modes, evaluated
+// against the workload, arch specs and constraints the Application parsed.
+//
+// A request is either one line holding a JSON (or flow-style YAML) value, or
+// a block-style YAML document terminated by a "---" or "..." line or by the
+// end of input. The value is an object {id: <scalar>, mapping: [...]} or just
+// the list of mapping directives, in which case its id is its 0-based
+// position in the request stream.
+
+class RequestEvaluator
+{
+ public:
+  enum class Outcome : std::uint8_t { Success, Invalid, Error };
+
+  struct Result
+  {
+    Outcome outcome;
+    std::string id;
+    bool id_is_number;
+    std::vector<model::EvalStatus> eval_status;
+    std::string error;
+  };
+
+  // Everything a worker evaluates requests with. Mapping directives may name
+  // config variables, and yaml-cpp nodes are not safe to read from several
+  // threads (lookups can insert into a map, or turn a null node into one),
+  // so each worker resolves them against its own copy of the variables.
+  struct Worker
+  {
+    model::Engine engine;
+    problem::Workload workload;
+    std::unique_ptr<config::CompoundConfig> config;
+  };
+
+ private:
+  // Parsed state, shared read-only by all workers.
+  config::CompoundConfig* config_;
+  const problem::Workload& workload_;
+  model::Engine::Specs& arch_specs_;
+  const mapping::Constraints* constraints_;
+  std::vector<std::string> level_names_;
+  std::string variables_yaml_;
+
+ public:
+  RequestEvaluator(config::CompoundConfig* config,
+                   const problem::Workload& workload,
+                   model::Engine::Specs& arch_specs,
+                   const mapping::Constraints* constraints) :
+      config_(config),
+      workload_(workload),
+      arch_specs_(arch_specs),
+      constraints_(constraints),
+      level_names_(arch_specs.topology.LevelNames())
+  {
+    // libconfig lookups do not modify the config, so workers can share a
+    // libconfig config as is.
+    if (!config->hasLConfig())
+    {
+      auto variables = config->getVariableRoot().getYNode();
+      if (variables.IsMap())
+        variables_yaml_ = YAML::Dump(variables);
+    }
+  }
+
+  const std::vector<std::string>& LevelNames() const { return level_names_; }
+
+  // Set up one worker. Called on the worker's own thread.
+  void InitWorker(Worker& worker) const
+  {
+    worker.engine.Spec(arch_specs_);
+    worker.workload = workload_;
+    if (!config_->hasLConfig())
+    {
+      YAML::Node root(YAML::NodeType::Map);
+      if (!variables_yaml_.empty())
+        root["variables"] = YAML::Load(variables_yaml_);
+      worker.config.reset(new config::CompoundConfig(std::vector<YAML::Node>{ root }));
+    }
+  }
+
+  // Parse a request and evaluate its mapping on the worker's engine. On
+  // success, the engine holds the evaluated stats.
+  Result Evaluate(const std::string& text, std::uint64_t sequence, Worker& worker) const
+  {
+    auto& engine = worker.engine;
+    auto& workload = worker.workload;
+    Result result = { Outcome::Error, std::to_string(sequence), true, {}, "" };
+
+    try
+    {
+      YAML::Node doc = YAML::Load(text);
+      YAML::Node mapping_yaml = doc;
+      if (doc.IsMap())
+      {
+        if (auto id = doc["id"])
+        {
+          if (!id.IsScalar())
+            throw mapping::ParseError("request id must be a scalar");
+          result.id = id.Scalar();
+          result.id_is_number = IsNumber(id);
+        }
+        mapping_yaml = doc["mapping"];
+        if (!mapping_yaml)
+          throw mapping::ParseError("request has no mapping");
+      }
+
+      auto config = worker.config ? worker.config.get() : config_;
+      Mapping mapping = mapping::ParseAndConstruct(config::CompoundConfigNode(nullptr, mapping_yaml, config),
+                                                   arch_specs_, workload);
+      if (constraints_ && !constraints_->SatisfiedBy(&mapping))
+        throw mapping::ParseError("mapping violates architecture constraints");
+
+      result.eval_status = engine.Evaluate(mapping, workload);
+      result.outcome = Outcome::Success;
+      for (auto& status : result.eval_status)
+        if (!status.success)
+          result.outcome = Outcome::Invalid;
+    }
+    catch (const std::exception& e)
+    {
+      result.outcome = Outcome::Error;
+      result.error = e.what();
+    }
+
+    return result;
+  }
+
+  // Split an input stream into requests. read_line returns false at the end
+  // of input.
+  static void SplitRequests(std::function<bool(std::string&)> read_line,
+                            std::function<void(std::string)> submit)
+  {
+    std::string block;
+    std::string line;
+
+    while (read_line(line))
+    {
+      if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+
+      auto first = line.find_first_not_of(" \t");
+      if (block.empty() && first == std::string::npos)
+        continue;
+
+      if (block.empty() && (line[first] == '{' || line[first] == '['))
+      {
+        submit(line);
+      }
+      else if (line == "---" || line == "...")
+      {
+        if (block.find_first_not_of(" \t\n") != std::string::npos)
+          submit(block);
+        block.clear();
+      }
+      else
+      {
+        block += line;
+        block += '\n';
+      }
+    }
+
+    if (block.find_first_not_of(" \t\n") != std::string::npos)
+      submit(block);
+  }
+
+  static std::string JSONString(const std::string& str)
+  {
+    std::ostringstream out;
+    out << '"';
+    for (unsigned char c : str)
+    {
+      if (c == '"' || c == '\\')
+        out << '\\' << c;
+      else if (c == '\n')
+        out << "\\n";
+      else if (c < 0x20)
+        out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << unsigned(c) << std::dec;
+      else
+        out << c;
+    }
+    out << '"';
+    return out.str();
+  }
+
+ private:
+  // Unquoted ids that are JSON numbers, -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?,
+  // are echoed as numbers, everything else (including YAML numbers such as
+  // "1.", ".5", "+1" or "007") as strings.
+  static bool IsNumber(const YAML::Node& node)
+  {
+    if (node.Tag() != "?")
+      return false;
+    const char* c = node.Scalar().c_str();
+    auto digits = [&c]()
+      {
+        const char* start = c;
+        while (std::isdigit(static_cast<unsigned char>(*c)))
+          c++;
+        return c != start;
+      };
+
+    if (*c == '-')
+      c++;
+    if (*c == '0')
+      c++;
+    else if (!digits())
+      return false;
+    if (*c == '.')
+    {
+      c++;
+      if (!digits())
+        return false;
+    }
+    if (*c == 'e' || *c == 'E')
+    {
+      c++;
+      if (*c == '+' || *c == '-')
+        c++;
+      if (!digits())
+        return false;
+    }
+    return *c == '\0';
+  }
+};
@@ -0,0 +1,474 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "model-request.hpp"
+
+extern bool gTerminate;
+
+//--------------------------------------------//
+//                Model Server                //
+//--------------------------------------------//
+
+// Persistent evaluation server for timeloop-model. The workload, arch specs
+// and constraints are parsed once by the Application; the server then reads
+// mapping requests (see model-request.hpp) from stdin or from clients of a
+// Unix-domain socket and answers each one with a single line of JSON.
+// Requests are evaluated by a pool of workers with one engine each, so
+// responses come back in completion order and clients match them up by id.
+
+class ModelServer
+{
+ public:
+  // Request latencies in microseconds, counted in buckets that are 1/16 of
+  // an octave wide, so that a server that runs for days keeps a fixed-size
+  // record. Percentiles are resolved to within a bucket (about 4.4%).
+  class LatencyHistogram
+  {
+   private:
+    static constexpr unsigned kBucketsPerOctave = 16;
+    static constexpr unsigned kOctaves = 40; // Up to 2^40 us, about 12 days.
+
+    std::array<std::uint64_t, kBucketsPerOctave * kOctaves> counts_ = {};
+    std::uint64_t count_ = 0;
+    double sum_ = 0;
+    double max_ = 0;
+
+    // Bucket b holds latencies in [2^(b/16), 2^((b+1)/16)); the first also
+    // holds everything below 1 us, the last everything above its range.
+    static std::size_t Bucket(double us)
+    {
+      if (!(us > 1))
+        return 0;
+      auto bucket = std::size_t(std::log2(us) * kBucketsPerOctave);
+      return std::min<std::size_t>(bucket, kBucketsPerOctave * kOctaves - 1);
+    }
+
+   public:
+    void Add(double us)
+    {
+      counts_[Bucket(us)]++;
+      count_++;
+      sum_ += us;
+      max_ = std::max(max_, us);
+    }
+
+    std::uint64_t Count() const { return count_; }
+    double Mean() const { return count_ > 0 ? sum_ / count_ : 0; }
+    double Max() const { return max_; }
+
+    // The upper bound of the bucket holding the p-quantile, capped at the
+    // largest latency seen.
+    double Percentile(double p) const
+    {
+      auto rank = std::uint64_t(std::ceil(p * count_));
+      std::uint64_t seen = 0;
+      for (std::size_t bucket = 0; bucket < counts_.size(); bucket++)
+      {
+        seen += counts_[bucket];
+        if (seen > 0 && seen >= rank)
+          return std::min(std::exp2(double(bucket + 1) / kBucketsPerOctave), max_);
+      }
+      return max_;
+    }
+  };
+
+  // A client endpoint: stdin/stdout or one accepted socket. Responses from
+  // different workers are written whole, one line at a time.
+  class Connection
+  {
+   private:
+    int in_fd_;
+    int out_fd_;
+    bool owns_fd_;
+    std::string buffer_;
+    std::mutex write_mutex_;
+
+   public:
+    Connection(int in_fd, int out_fd, bool owns_fd) :
+        in_fd_(in_fd), out_fd_(out_fd), owns_fd_(owns_fd)
+    {
+    }
+
+    ~Connection()
+    {
+      if (owns_fd_)
+        close(in_fd_);
+    }
+
+    // Returns false at end of input, or once the server is terminating.
+    bool ReadLine(std::string& line)
+    {
+      while (true)
+      {
+        auto newline = buffer_.find('\n');
+        if (newline != std::string::npos)
+        {
+          line = buffer_.substr(0, newline);
+          buffer_.erase(0, newline + 1);
+          return true;
+        }
+
+        // Wake up periodically to notice a termination request.
+        pollfd pfd = { in_fd_, POLLIN, 0 };
+        int ready = poll(&pfd, 1, 200);
+        if (gTerminate)
+          return false;
+        if (ready <= 0)
+          continue;
+
+        char chunk[65536];
+        ssize_t bytes = read(in_fd_, chunk, sizeof(chunk));
+        if (bytes < 0 && errno == EINTR)
+          continue;
+        if (bytes <= 0)
+        {
+          // Hand out a final unterminated line.
+          line.swap(buffer_);
+          buffer_.clear();
+          return !line.empty();
+        }
+        buffer_.append(chunk, bytes);
+      }
+    }
+
+    // Failures (e.g., the client went away) are ignored.
+    void WriteLine(std::string line)
+    {
+      line.push_back('\n');
+      std::lock_guard<std::mutex> lock(write_mutex_);
+      std::size_t written = 0;
+      while (written < line.size())
+      {
+        ssize_t bytes = write(out_fd_, line.data() + written, line.size() - written);
+        if (bytes < 0 && errno == EINTR)
+          continue;
+        if (bytes <= 0)
+          return;
+        written += bytes;
+      }
+    }
+  };
+
+ private:
+  struct Request
+  {
+    std::shared_ptr<Connection> connection;
+    std::uint64_t sequence;
+    std::string text;
+    std::chrono::steady_clock::time_point arrival;
+  };
+
+  using Outcome = RequestEvaluator::Outcome;
+
+  RequestEvaluator evaluator_;
+  unsigned num_threads_;
+
+  // Bounded request queue: readers block when workers fall behind.
+  std::deque<Request> queue_;
+  std::size_t queue_capacity_;
+  bool queue_closed_ = false;
+  std::mutex queue_mutex_;
+  std::condition_variable queue_not_empty_;
+  std::condition_variable queue_not_full_;
+
+  // Active socket readers, waited for at shutdown.
+  unsigned num_readers_ = 0;
+  std::mutex readers_mutex_;
+  std::condition_variable readers_done_;
+
+  // Per-request latency (arrival to response written), outcome counts and
+  // the busy interval (first arrival to last response) for throughput.
+  LatencyHistogram latencies_us_;
+  std::array<std::uint64_t, 3> outcomes_ = { 0, 0, 0 };
+  std::chrono::steady_clock::time_point first_arrival_;
+  std::chrono::steady_clock::time_point last_response_;
+  std::mutex stats_mutex_;
+
+ public:
+  ModelServer(config::CompoundConfig* config,
+              const problem::Workload& workload,
+              model::Engine::Specs& arch_specs,
+              const mapping::Constraints* constraints,
+              unsigned num_threads) :
+      evaluator_(config, workload, arch_specs, constraints),
+      num_threads_(std::max(num_threads, 1U)),
+      queue_capacity_(4 * num_threads_)
+  {
+  }
+
+  // Serve until the end of stdin (endpoint "stdin") or, for a socket path,
+  // until SIGINT. Prints a latency/throughput summary to stderr.
+  void Run(const std::string& endpoint)
+  {
+    // A client closing its end must not kill the server.
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < num_threads_; t++)
+      workers.emplace_back(&ModelServer::Work, this);
+
+    if (endpoint == "stdin")
+    {
+      std::cerr << "Model server reading requests from stdin with "
+                << num_threads_ << " workers." << std::endl;
+      ReadRequests(std::make_shared<Connection>(STDIN_FILENO, STDOUT_FILENO, false));
+    }
+    else
+    {
+      ServeSocket(endpoint);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      queue_closed_ = true;
+    }
+    queue_not_empty_.notify_all();
+    for (auto& worker : workers)
+      worker.join();
+
+    PrintSummary();
+  }
+
+ private:
+  void ServeSocket(const std::string& path)
+  {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+      std::cerr << "ERROR: model server socket path too long: " << path << std::endl;
+      exit(1);
+    }
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    // Replace a socket left behind by an earlier server, but nothing else:
+    // the path comes from the config and may name some other file.
+    struct stat existing;
+    if (lstat(path.c_str(), &existing) == 0)
+    {
+      if (!S_ISSOCK(existing.st_mode))
+      {
+        std::cerr << "ERROR: model server socket path exists and is not a socket: " << path << std::endl;
+        exit(1);
+      }
+      unlink(path.c_str());
+    }
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0 ||
+        bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(listen_fd, 64) != 0)
+    {
+      std::cerr << "ERROR: model server cannot listen on " << path << ": "
+                << std::strerror(errno) << std::endl;
+      exit(1);
+    }
+
+    std::cerr << "Model server listening on " << path << " with "
+              << num_threads_ << " workers." << std::endl;
+
+    while (!gTerminate)
+    {
+      pollfd pfd = { listen_fd, POLLIN, 0 };
+      if (poll(&pfd, 1, 200) <= 0)
+        continue;
+
+      int fd = accept(listen_fd, nullptr, nullptr);
+      if (fd < 0)
+        continue;
+
+      {
+        std::lock_guard<std::mutex> lock(readers_mutex_);
+        num_readers_++;
+      }
+      auto connection = std::make_shared<Connection>(fd, fd, true);
+      std::thread([this, connection]()
+                  {
+                    ReadRequests(connection);
+                    std::lock_guard<std::mutex> lock(readers_mutex_);
+                    num_readers_--;
+                    readers_done_.notify_all();
+                  }).detach();
+    }
+
+    close(listen_fd);
+    unlink(path.c_str());
+
+    std::unique_lock<std::mutex> lock(readers_mutex_);
+    readers_done_.wait(lock, [this]() { return num_readers_ == 0; });
+  }
+
+  // Split a connection's input into requests and queue them.
+  void ReadRequests(std::shared_ptr<Connection> connection)
+  {
+    std::uint64_t sequence = 0;
+    RequestEvaluator::SplitRequests(
+      [&](std::string& line) { return connection->ReadLine(line); },
+      [&](std::string text)
+      {
+        Request request = { connection, sequence++, std::move(text), std::chrono::steady_clock::now() };
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        queue_not_full_.wait(lock, [this]() { return queue_.size() < queue_capacity_; });
+        queue_.push_back(std::move(request));
+        lock.unlock();
+        queue_not_empty_.notify_one();
+      });
+  }
+
+  bool Pop(Request& request)
+  {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    queue_not_empty_.wait(lock, [this]() { return queue_closed_ || !queue_.empty(); });
+    if (queue_.empty())
+      return false;
+    request = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+    queue_not_full_.notify_one();
+    return true;
+  }
+
+  void Work()
+  {
+    RequestEvaluator::Worker worker;
+    evaluator_.InitWorker(worker);
+    auto& engine = worker.engine;
+
+    Request request;
+    while (Pop(request))
+    {
+      auto result = evaluator_.Evaluate(request.text, request.sequence, worker);
+      auto outcome = result.outcome;
+      request.connection->WriteLine(Response(result, engine));
+      request.connection.reset();
+
+      auto now = std::chrono::steady_clock::now();
+      std::chrono::duration<double, std::micro> latency = now - request.arrival;
+      std::lock_guard<std::mutex> lock(stats_mutex_);
+      if (latencies_us_.Count() == 0 || request.arrival < first_arrival_)
+        first_arrival_ = request.arrival;
+      last_response_ = std::max(last_response_, now);
+      latencies_us_.Add(latency.count());
+      outcomes_[unsigned(outcome)]++;
+    }
+  }
+
+  std::string Response(const RequestEvaluator::Result& result, const model::Engine& engine) const
+  {
+    auto& level_names = evaluator_.LevelNames();
+
+    std::ostringstream out;
+    out << std::setprecision(12);
+    out << "{\"id\":" << (result.id_is_number ? result.id : RequestEvaluator::JSONString(result.id));
+
+    if (result.outcome == Outcome::Error)
+    {
+      out << ",\"status\":\"error\",\"error\":" << RequestEvaluator::JSONString(result.error) << "}";
+    }
+    else if (result.outcome == Outcome::Invalid)
+    {
+      out << ",\"status\":\"invalid\",\"failures\":[";
+      bool first = true;
+      for (unsigned level = 0; level < result.eval_status.size(); level++)
+      {
+        if (result.eval_status[level].success)
+          continue;
+        out << (first ? "" : ",") << "{\"level\":" << RequestEvaluator::JSONString(level_names.at(level))
+            << ",\"reason\":" << RequestEvaluator::JSONString(result.eval_status[level].fail_reason) << "}";
+        first = false;
+      }
+      out << "]}";
+    }
+    else
+    {
+      auto& topology = engine.GetTopology();
+      out << ",\"status\":\"ok\""
+          << ",\"energy_pJ\":" << engine.Energy()
+          << ",\"area_um2\":" << engine.Area()
+          << ",\"cycles\":" << engine.Cycles()
+          << ",\"utilization\":" << engine.Utilization()
+          << ",\"maccs\":" << topology.MACCs()
+          << ",\"pJ_per_macc\":" << engine.Energy() / topology.MACCs()
+          << ",\"levels\":[";
+      for (unsigned level = 0; level < level_names.size(); level++)
+      {
+        out << (level == 0 ? "" : ",") << "{\"name\":" << RequestEvaluator::JSONString(level_names.at(level))
+            << ",\"energy_pJ\":" << topology.LevelEnergy(level)
+            << ",\"accesses\":" << topology.LevelAccesses(level) << "}";
+      }
+      out << "]}";
+    }
+
+    return out.str();
+  }
+
+  void PrintSummary()
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    auto num_requests = latencies_us_.Count();
+    std::chrono::duration<double> busy = last_response_ - first_arrival_;
+    double seconds = num_requests > 0 ? busy.count() : 0;
+
+    std::cerr << "Model server: " << num_requests << " requests (" << outcomes_[0] << " ok, "
+              << outcomes_[1] << " invalid, " << outcomes_[2] << " errors) in "
+              << std::fixed << std::setprecision(3) << seconds << " s";
+    if (num_requests > 0)
+    {
+      std::cerr << ", " << std::setprecision(1) << num_requests / seconds << " requests/s"
+                << std::endl << "  latency (us): mean " << latencies_us_.Mean()
+                << " | p50 " << latencies_us_.Percentile(0.5) << " | p99 " << latencies_us_.Percentile(0.99)
+                << " | max " << latencies_us_.Max();
+    }
+    std::cerr << std::endl;
+  }
+};
@@ -40,10 +40,15 @@
 
 #include "util/accelergy_interface.hpp"
 #include "util/banner.hpp"
+#include "model/binary-stats.hpp"
+#include "model/spec-cache.hpp"
+#include "model-server.hpp"
+#include "model-batch.hpp"
 #include "mapping/parser.hpp"
 #include "mapping/arch-properties.hpp"
 #include "mapping/constraints.hpp"
 #include "compound-config/compound-config.hpp"
+#include "util/arch-space.hpp"
 
 //--------------------------------------------//
 //                Application                 //
@@ -63,20 +68,49 @@ class Application
   // we can only instantiate them after certain config files have
   // been parsed.
 
-  // The mapping.
-  Mapping* mapping_;
+  // The mapping (absent in server mode if the config has none).
+  Mapping* mapping_ = nullptr;
 
   // Abstract representation of the architecture.
-  ArchProperties* arch_props_;
+  ArchProperties* arch_props_ = nullptr;
 
   // Constraints.
-  mapping::Constraints* constraints_;  
+  mapping::Constraints* constraints_ = nullptr;
+
+  // Server mode: instead of evaluating the config's mapping, keep the parsed
+  // workload and arch and evaluate mappings sent over stdin ("stdin") or a
+  // Unix-domain socket (a path). See model-server.hpp and model-request.hpp.
+  config::CompoundConfig* config_;
+  std::string server_;
+  unsigned server_threads_ = std::thread::hardware_concurrency();
+
+  // Batch mode: evaluate every mapping in a file (JSON lines or multi-document
+  // YAML) in parallel, writing <prefix>.batch.csv. See model-batch.hpp.
+  std::string batch_;
+  unsigned batch_threads_ = std::thread::hardware_concurrency();
   
   // Application flags/config.
   bool verbose_ = false;
   bool auto_bypass_on_failure_ = false;
   std::string out_prefix_;
 
+  // Output format of the engine stats and mapping archive: "xml"
+  // (map+stats.xml), "binary" (map+stats.bin, see model/binary-stats.hpp)
+  // or "both". The binary archive embeds the input config so the XML and
+  // text outputs can be regenerated from it by timeloop-stats-convert.
+  std::string stats_format_ = "xml";
+  std::string config_text_;
+
+  // Alternative ERTs to re-cost the evaluated mapping's energy against.
+  std::vector<std::string> ert_sweep_files_;
+  std::vector<model::Topology::Specs> ert_sweep_specs_;
+
+  // Architecture variants to evaluate the same mapping on, read from a
+  // design-space arch sweep file (arch-space-files or arch-space-sweep).
+  std::string arch_sweep_file_;
+  std::vector<std::string> arch_sweep_names_;
+  std::vector<model::Engine::Specs> arch_sweep_specs_;
+
  private:
 
   // Serialization
@@ -95,7 +129,8 @@ class Application
   Application(config::CompoundConfig* config,
               std::string output_dir = ".",
               std::string name = "timeloop-model") :
-      name_(name)
+      name_(name),
+      config_(config)
   {    
     auto rootNode = config->getRoot();
 
@@ -109,8 +144,26 @@ class Application
       model.lookupValue("verbose", verbose_);
       model.lookupValue("auto_bypass_on_failure", auto_bypass_on_failure_);
       model.lookupValue("out_prefix", semi_qualified_prefix);
+      if (model.exists("ert_sweep"))
+        model.lookupArrayValue("ert_sweep", ert_sweep_files_);
+      model.lookupValue("arch_sweep", arch_sweep_file_);
+      model.lookupValue("stats_format", stats_format_);
+      model.lookupValue("server", server_);
+      model.lookupValue("server_threads", server_threads_);
+      model.lookupValue("batch", batch_);
+      model.lookupValue("batch_threads", batch_threads_);
     }
 
+    if (stats_format_ != "xml" && stats_format_ != "binary" && stats_format_ != "both")
+    {
+      std::cerr << "ERROR: unrecognized stats_format: " << stats_format_
+                << " (expected xml, binary or both)." << std::endl;
+      exit(1);
+    }
+    // Captured before parsing, since some parsers rewrite the config tree.
+    if (stats_format_ != "xml" && !config->hasLConfig())
+      config_text_ = YAML::Dump(config->getYConfig());
+
     out_prefix_ = output_dir + "/" + semi_qualified_prefix;
 
     if (verbose_)
@@ -128,22 +181,31 @@ class Application
 
     // Architecture configuration.
     config::CompoundConfigNode arch;
+    std::string arch_key = "architecture";
     if (rootNode.exists("arch"))
     {
+      arch_key = "arch";
       arch = rootNode.lookup("arch");
     }
     else if (rootNode.exists("architecture"))
     {
       arch = rootNode.lookup("architecture");
     }
-    arch_specs_ = model::Engine::ParseSpecs(arch);
-
+    // Kept for parsing arch sweep variants against (see below).
+    YAML::Node arch_yaml;
+    if (!arch_sweep_file_.empty() && !config->hasLConfig() && arch.exists("subtree"))
+      arch_yaml = YAML::Clone(arch.getYNode());
+    arch_specs_ = model::SpecCache::ParseSpecs(config, arch_key);
+
+    // Compiled once: arch sweep variants reuse it (see below).
+    model::CompiledERT config_ert;
     if (rootNode.exists("ERT"))
     {
       auto ert = rootNode.lookup("ERT");
       if (verbose_)
         std::cout << "Found Accelergy ERT (energy reference table), replacing internal energy model." << std::endl;
-      arch_specs_.topology.ParseAccelergyERT(ert);
+      config_ert = arch_specs_.topology.CompileAccelergyERT(ert);
+      arch_specs_.topology.ApplyAccelergyERT(config_ert);
     }
     else
     {
@@ -151,17 +213,122 @@ class Application
       // Call accelergy ERT with all input files
       if (arch.exists("subtree") || arch.exists("local"))
       {
-        accelergy::invokeAccelergy(config->inFiles, semi_qualified_prefix, output_dir);
-        std::string ertPath = out_prefix_ + ".ERT.yaml";
-        auto ertConfig = new config::CompoundConfig(ertPath.c_str());
-        auto ert = ertConfig->getRoot().lookup("ERT");
-        if (verbose_)
-          std::cout << "Generate Accelergy ERT (energy reference table) to replace internal energy model." << std::endl;
-        arch_specs_.topology.ParseAccelergyERT(ert);
+        accelergy::applyCachedERT(*config, semi_qualified_prefix, output_dir,
+                                  arch_specs_.topology, verbose_);
       }
 #endif
     }
 
+    // Alternative ERTs: each one is applied to its own (shallow) copy of the
+    // architecture specs, so only the re-costed levels are duplicated.
+    for (auto& ert_path : ert_sweep_files_)
+    {
+      auto ertConfig = new config::CompoundConfig(ert_path.c_str());
+      auto ertRoot = ertConfig->getRoot();
+      if (!ertRoot.exists("ERT"))
+      {
+        std::cerr << "ERROR: no ERT found in " << ert_path << std::endl;
+        exit(1);
+      }
+      auto ert_specs = arch_specs_.topology;
+      ert_specs.ParseAccelergyERT(ertRoot.lookup("ERT"));
+      ert_sweep_specs_.push_back(ert_specs);
+    }
+
+    if (!arch_sweep_file_.empty())
+    {
+      std::ifstream sweep_stream(arch_sweep_file_);
+      YAML::Node sweep_yaml = YAML::Load(sweep_stream);
+
+      ArchSpace arch_space;
+      if (auto list = sweep_yaml["arch-space-files"])
+        arch_space.InitializeFromFileList(list);
+      else if (auto sweep = sweep_yaml["arch-space-sweep"])
+        arch_space.InitializeFromFileSweep(sweep);
+      else
+        arch_space.InitializeFromFile(arch_sweep_file_);
+
+      // The config's ERT was generated for its own architecture, so it only
+      // holds for variants that change nothing it depends on.
+      const std::set<std::string> ert_invariant_attributes = { "instances", "meshX", "meshY" };
+
+      for (int arch_id = 0; arch_id < arch_space.GetSize(); arch_id++)
+      {
+        auto& variant = arch_space.GetNode(arch_id);
+        YAML::Node variant_arch = variant.yaml_["architecture"];
+        if (!variant_arch)
+          variant_arch = variant.yaml_["arch"];
+        if (!variant_arch)
+        {
+          std::cerr << "ERROR: no architecture found in arch sweep variant " << variant.name_ << std::endl;
+          exit(1);
+        }
+
+        // A variant that only changes some components' attributes shares
+        // everything else with the config's architecture, which is not
+        // parsed again.
+        std::map<std::string, std::set<std::string>> changed;
+        bool patched = arch_yaml && DiffComponentAttributes(arch_yaml, variant_arch, changed);
+        config::CompoundConfigNode variant_node(nullptr, variant_arch, config);
+        model::Engine::Specs variant_specs;
+        if (patched)
+        {
+          std::set<std::string> changed_components;
+          for (auto& component : changed)
+            changed_components.insert(component.first);
+          variant_specs.topology = model::Topology::ParseTreeSpecs(variant_node, arch_specs_.topology,
+                                                                   changed_components);
+        }
+        else
+        {
+          variant_specs = model::Engine::ParseSpecs(variant_node);
+        }
+
+        if (rootNode.exists("ERT"))
+        {
+          bool ert_holds = patched;
+          for (auto& component : changed)
+            for (auto& attribute : component.second)
+              ert_holds &= ert_invariant_attributes.count(attribute) != 0;
+          if (!ert_holds)
+          {
+            std::cerr << "ERROR: arch sweep variant " << variant.name_ << " changes attributes that "
+                      << "the ERT in the config depends on; remove the ERT to cost each variant "
+                      << "with its own energy model, or sweep only";
+            for (auto& attribute : ert_invariant_attributes)
+              std::cerr << " " << attribute;
+            std::cerr << "." << std::endl;
+            exit(1);
+          }
+          try
+          {
+            variant_specs.topology.ApplyAccelergyERT(config_ert);
+          }
+          catch (const model::SpecsMismatch& e)
+          {
+            std::cerr << "ERROR: arch sweep variant " << variant.name_ << ": " << e.what() << std::endl;
+            exit(1);
+          }
+        }
+        else
+        {
+#ifdef USE_ACCELERGY
+          // Each variant gets the ERT Accelergy generates for it, cached by
+          // content like the config's own.
+          if (variant_arch["subtree"] || variant_arch["local"])
+          {
+            config::CompoundConfig variant_config({ variant.yaml_ });
+            accelergy::applyCachedERT(variant_config, semi_qualified_prefix + ".arch-sweep-" + std::to_string(arch_id),
+                                      output_dir, variant_specs.topology, verbose_);
+          }
+#endif
+        }
+
+        arch_sweep_names_.push_back(variant.name_);
+        arch_sweep_specs_.push_back(variant_specs);
+      }
+    }
+
     arch_props_ = new ArchProperties(arch_specs_);
 
     // Architecture constraints.
@@ -181,8 +348,19 @@ class Application
       std::cout << "Architecture configuration complete." << std::endl;
 
     // Mapping configuration: expressed as a mapspace or mapping.
+    if ((!server_.empty() || !batch_.empty()) && !rootNode.exists("mapping"))
+      return;
+
     auto mapping = rootNode.lookup("mapping");
-    mapping_ = new Mapping(mapping::ParseAndConstruct(mapping, arch_specs_, workload_));
+    try
+    {
+      mapping_ = new Mapping(mapping::ParseAndConstruct(mapping, arch_specs_, workload_));
+    }
+    catch (const mapping::ParseError& e)
+    {
+      std::cerr << "ERROR: " << e.what() << std::endl;
+      exit(1);
+    }
     if (verbose_)
       std::cout << "Mapping construction complete." << std::endl;
 
@@ -213,9 +391,24 @@ class Application
   // Run the evaluation.
   void Run()
   {
+    if (!server_.empty())
+    {
+      ModelServer server(config_, workload_, arch_specs_, constraints_, server_threads_);
+      server.Run(server_);
+      return;
+    }
+
+    if (!batch_.empty())
+    {
+      ModelBatch batch(config_, workload_, arch_specs_, constraints_, batch_threads_);
+      batch.Run(batch_, out_prefix_ + ".batch.csv");
+      return;
+    }
+
     // Output file names.
     std::string stats_file_name = out_prefix_ + ".stats.txt";
     std::string xml_file_name = out_prefix_ + ".map+stats.xml";
+    std::string bin_file_name = out_prefix_ + ".map+stats.bin";
     std::string map_txt_file_name = out_prefix_ + ".map.txt";
 
     model::Engine engine;
@@ -279,15 +472,90 @@ class Application
       std::ofstream stats_file(stats_file_name);
       stats_file << engine << std::endl;
       stats_file.close();
+
+      if (!ert_sweep_specs_.empty())
+      {
+        // Re-cost the access counts of this single evaluation against every
+        // alternative ERT instead of re-evaluating the mapping once per ERT.
+        auto profile = engine.GetTopology().GetAccessProfile();
+        std::vector<double> energies;
+        try
+        {
+          energies = model::Topology::Recost(profile, ert_sweep_specs_);
+        }
+        catch (const model::SpecsMismatch& e)
+        {
+          std::cerr << "ERROR: ERT sweep: " << e.what() << std::endl;
+          exit(1);
+        }
+
+        std::cout << "ERT sweep:" << std::endl;
+        for (unsigned i = 0; i < energies.size(); i++)
+        {
+          std::cout << "  " << ert_sweep_files_.at(i) << ": Energy = "
+                    << std::setprecision(3) << energies.at(i) / 1000000 << " uJ | pJ/MACC = "
+                    << std::setw(8) << std::setprecision(3)
+                    << energies.at(i) / engine.GetTopology().MACCs() << std::endl;
+        }
+      }
     }
 
-    // Print the engine stats and mapping to an XML file
-    std::ofstream ofs(xml_file_name);
-    boost::archive::xml_oarchive ar(ofs);
-    ar << BOOST_SERIALIZATION_NVP(engine);
-    ar << BOOST_SERIALIZATION_NVP(mapping);
-    const Application* a = this;
-    ar << BOOST_SERIALIZATION_NVP(a);
+    if (!arch_sweep_specs_.empty())
+    {
+      // Evaluate the same mapping on every architecture variant, running the
+      // nest analysis only once.
+      auto results = engine.EvaluateVariants(arch_sweep_specs_, mapping, workload_);
+
+      std::string sweep_file_name = out_prefix_ + ".arch-sweep.csv";
+      std::ofstream sweep_file(sweep_file_name);
+      sweep_file << "config_name, success, MACCs, cycles, utilization, energy (uJ), area (um^2), pJ/MACC" << std::endl;
+      for (unsigned i = 0; i < results.size(); i++)
+      {
+        auto& result = results.at(i);
+        sweep_file << arch_sweep_names_.at(i) << ", " << result.success;
+        if (result.success)
+        {
+          sweep_file << ", " << result.stats.maccs
+                     << ", " << result.stats.cycles
+                     << ", " << std::fixed << std::setprecision(2) << result.stats.utilization
+                     << ", " << std::setprecision(3) << result.stats.energy / 1000000
+                     << ", " << std::setprecision(2) << result.stats.area
+                     << ", " << std::setprecision(3) << result.stats.energy / result.stats.maccs;
+        }
+        else
+        {
+          std::cerr << "WARNING: mapping is invalid on architecture variant " << arch_sweep_names_.at(i) << ": ";
+          if (!result.fail_reason.empty())
+            std::cerr << result.fail_reason;
+          for (unsigned level_id = 0; level_id < result.eval_status.size(); level_id++)
+            if (!result.eval_status.at(level_id).success)
+              std::cerr << "[" << arch_sweep_specs_.at(i).topology.GetLevel(level_id)->level_name << "] "
+                        << result.eval_status.at(level_id).fail_reason << " ";
+          std::cerr << std::endl;
+        }
+        sweep_file << std::endl;
+      }
+      sweep_file.close();
+
+      std::cout << "Evaluated mapping on " << results.size() << " architecture variants, results in "
+                << sweep_file_name << std::endl;
+    }
+
+    // Print the engine stats and mapping to an XML and/or binary file.
+    if (stats_format_ != "binary")
+    {
+      std::ofstream ofs(xml_file_name);
+      boost::archive::xml_oarchive ar(ofs);
+      ar << BOOST_SERIALIZATION_NVP(engine);
+      ar << BOOST_SERIALIZATION_NVP(mapping);
+      const Application* a = this;
+      ar << BOOST_SERIALIZATION_NVP(a);
+    }
+    if (stats_format_ != "xml" && engine.IsEvaluated())
+    {
+      if (!model::BinaryStats::Save(bin_file_name, engine, mapping, workload_, config_text_))
+        std::cerr << "WARNING: could not write " << bin_file_name << std::endl;
+    }
   }
 };
 
@@ -0,0 +1,96 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <iostream>
+#include <cstring>
+
+#include "stats-convert.hpp"
+#include "util/args.hpp"
+
+bool gTerminateEval = false;
+
+//--------------------------------------------//
+//                    MAIN                    //
+//--------------------------------------------//
+
+// Usage: timeloop-stats-convert [--summary] [-o <odir>] <prefix>.map+stats.bin...
+int main(int argc, char* argv[])
+{
+  assert(argc >= 2);
+
+  std::vector<std::string> args;
+  std::string output_dir = ".";
+  bool success = ParseArgs(argc, argv, args, output_dir);
+  if (!success)
+  {
+    std::cerr << "ERROR: error parsing command line." << std::endl;
+    exit(1);
+  }
+
+  bool summary = false;
+  std::vector<std::string> input_files;
+  for (auto& arg: args)
+  {
+    if (arg == "--summary")
+      summary = true;
+    else
+      input_files.push_back(arg);
+  }
+
+  Application application;
+
+  int failures = 0;
+  for (auto& input_file: input_files)
+  {
+    model::BinaryStats stats;
+    if (!stats.Load(input_file))
+    {
+      std::cerr << "ERROR: cannot read binary stats archive: " << input_file << std::endl;
+      failures++;
+      continue;
+    }
+
+    if (summary)
+    {
+      application.PrintSummary(stats, std::cout);
+      continue;
+    }
+
+    // Outputs are named after the archive, minus its extension.
+    std::string name = input_file.substr(input_file.find_last_of('/') + 1);
+    const std::string extension = ".map+stats.bin";
+    if (name.size() > extension.size() &&
+        name.compare(name.size() - extension.size(), extension.size(), extension) == 0)
+      name.resize(name.size() - extension.size());
+
+    if (!application.Convert(stats, output_dir + "/" + name))
+      failures++;
+  }
+
+  return failures == 0 ? 0 : 1;
+}
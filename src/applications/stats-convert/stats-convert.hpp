@@ -0,0 +1,207 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <fstream>
+#include <iomanip>
+
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/array.hpp>
+#include <boost/serialization/map.hpp>
+#include <boost/serialization/bitset.hpp>
+#include <boost/archive/xml_oarchive.hpp>
+
+#include "model/binary-stats.hpp"
+#include "compound-config/compound-config.hpp"
+
+//--------------------------------------------//
+//                Application                 //
+//--------------------------------------------//
+
+// Converts a binary stats archive (map+stats.bin) back to the outputs that
+// timeloop-model and timeloop-mapper write in XML mode: map.txt, stats.txt
+// and map+stats.xml. The flat records in the archive only cover the stats
+// summary, so the full outputs are regenerated by re-evaluating the stored
+// mapping against the config embedded in the archive, with the energies
+// the run applied (which may come from an Accelergy run that is not part of
+// the config), and conversion fails if the result differs from the recorded
+// summary.
+class Application
+{
+ protected:
+  problem::Workload workload_;
+
+  // Serialization
+  friend class boost::serialization::access;
+  template <class Archive>
+  void serialize(Archive& ar, const unsigned int version=0)
+  {
+    if(version == 0)
+    {
+      ar& BOOST_SERIALIZATION_NVP(workload_);
+    }
+  }
+
+ public:
+
+  // Print the summary held in the flat records, without re-evaluating.
+  void PrintSummary(const model::BinaryStats& stats, std::ostream& out)
+  {
+    auto& header = stats.Header();
+
+    out << "Problem:";
+    for (unsigned dim = 0; dim < header.num_dimensions; dim++)
+      out << " " << stats.DimensionName(dim) << "=" << stats.Bound(dim);
+    out << std::endl;
+
+    out << "Energy: " << std::setprecision(6) << header.energy / 1000000 << " uJ" << std::endl;
+    out << "Area: " << header.area << " um^2" << std::endl;
+    out << "Cycles: " << header.cycles << std::endl;
+    out << "Utilization: " << std::fixed << std::setprecision(2) << header.utilization << std::endl;
+    out << "MACCs: " << header.maccs << std::endl;
+    out << "pJ/MACC: " << std::setprecision(3) << header.energy / header.maccs << std::endl;
+    out << std::endl;
+
+    auto& arithmetic = stats.Arithmetic();
+    out << std::left << std::setw(24) << stats.String(arithmetic.name) << std::right
+        << " energy = " << std::setw(14) << arithmetic.energy << " pJ"
+        << " | utilized instances = " << arithmetic.utilized_instances
+        << " / " << arithmetic.instances << std::endl;
+
+    for (unsigned level = 0; level < header.num_storage_levels; level++)
+    {
+      auto& record = stats.StorageLevel(level);
+      out << std::left << std::setw(24) << stats.String(record.name) << std::right
+          << " energy = " << std::setw(14) << record.energy << " pJ"
+          << " | cycles = " << record.cycles << std::endl;
+      for (unsigned pv = 0; pv < header.num_data_spaces; pv++)
+      {
+        if (!stats.StorageCount(level, model::StorageCounter::Keep, pv))
+          continue;
+        out << "    " << std::left << std::setw(20) << stats.DataSpaceName(pv) << std::right
+            << " tile = " << stats.StorageCount(level, model::StorageCounter::TileSize, pv)
+            << " | reads = " << stats.StorageCount(level, model::StorageCounter::Reads, pv)
+            << " | fills = " << stats.StorageCount(level, model::StorageCounter::Fills, pv)
+            << " | updates = " << stats.StorageCount(level, model::StorageCounter::Updates, pv)
+            << std::endl;
+      }
+    }
+
+    for (unsigned network = 0; network < header.num_networks; network++)
+    {
+      auto& record = stats.Network(network);
+      out << std::left << std::setw(24) << stats.String(record.name) << std::right
+          << " energy = " << std::setw(14) << record.energy << " pJ" << std::endl;
+    }
+  }
+
+  // Regenerate the XML-mode outputs as <out_prefix>.{map.txt,stats.txt,map+stats.xml}.
+  bool Convert(const model::BinaryStats& stats, const std::string& out_prefix)
+  {
+    auto config_text = stats.Config();
+    if (config_text.empty())
+    {
+      std::cerr << "ERROR: archive has no embedded config (was the run configured "
+                << "with a .cfg file?), only --summary is available." << std::endl;
+      return false;
+    }
+
+    config::CompoundConfig config(std::vector<YAML::Node>{ YAML::Load(config_text) });
+    auto rootNode = config.getRoot();
+
+    auto problem = rootNode.lookup("problem");
+    problem::ParseWorkload(problem, workload_);
+
+    config::CompoundConfigNode arch;
+    if (rootNode.exists("arch"))
+      arch = rootNode.lookup("arch");
+    else if (rootNode.exists("architecture"))
+      arch = rootNode.lookup("architecture");
+    auto arch_specs = model::Engine::ParseSpecs(arch);
+
+    model::CompiledERT ert;
+    if (!stats.GetERT(ert))
+    {
+      std::cerr << "ERROR: archive has a malformed energy section." << std::endl;
+      return false;
+    }
+    try
+    {
+      arch_specs.topology.ApplyAccelergyERT(ert);
+    }
+    catch (const model::SpecsMismatch& e)
+    {
+      std::cerr << "ERROR: archive energies do not match its config: " << e.what() << std::endl;
+      return false;
+    }
+
+    Mapping mapping = stats.GetMapping();
+
+    model::Engine engine;
+    engine.Spec(arch_specs);
+    auto eval_status = engine.Evaluate(mapping, workload_);
+    for (unsigned level = 0; level < eval_status.size(); level++)
+    {
+      if (!eval_status[level].success)
+      {
+        std::cerr << "ERROR: stored mapping failed to re-evaluate at level " << level << ": "
+                  << eval_status[level].fail_reason << std::endl;
+        return false;
+      }
+    }
+
+    auto& header = stats.Header();
+    if (engine.Cycles() != header.cycles ||
+        std::abs(engine.Energy() - header.energy) > 1e-9 * std::abs(header.energy))
+    {
+      std::cerr << "ERROR: regenerated stats differ from the recorded run (energy "
+                << engine.Energy() << " vs. " << header.energy << " pJ, cycles "
+                << engine.Cycles() << " vs. " << header.cycles << ")." << std::endl;
+      return false;
+    }
+
+    std::ofstream map_txt_file(out_prefix + ".map.txt");
+    mapping.PrettyPrint(map_txt_file, arch_specs.topology.StorageLevelNames(),
+                        engine.GetTopology().TileSizes());
+    map_txt_file.close();
+
+    std::ofstream stats_file(out_prefix + ".stats.txt");
+    stats_file << engine << std::endl;
+    stats_file.close();
+
+    std::ofstream ofs(out_prefix + ".map+stats.xml");
+    boost::archive::xml_oarchive ar(ofs);
+    ar << BOOST_SERIALIZATION_NVP(engine);
+    ar << BOOST_SERIALIZATION_NVP(mapping);
+    const Application* a = this;
+    ar << BOOST_SERIALIZATION_NVP(a);
+
+    return true;
+  }
+};
@@ -522,6 +522,7 @@ bool CompoundConfigNode::getMapKeys(std::vector<std::string> &mapKeys) {
 /* CompoundConfig */
 
 CompoundConfig::CompoundConfig(const char* inputFile) {
+  inFiles = { inputFile };
   if (std::strstr(inputFile, ".cfg")) {
     LConfig.readFile(inputFile);
     auto& lroot = LConfig.getRoot();
@@ -578,6 +579,33 @@ CompoundConfig::CompoundConfig(std::vector<std::string> inputFiles) {
 
 }
 
+CompoundConfig::CompoundConfig(std::vector<YAML::Node> inputNodes) {
+  assert(inputNodes.size() > 0);
+  inNodes = inputNodes;
+
+  YConfig = YAML::Node(YAML::NodeType::Map);
+  for (auto& node : inputNodes) {
+    if (!node.IsMap()) {
+      std::cerr << "ERROR: in-memory configuration node is not a map" << std::endl;
+      exit(1);
+    }
+    for (auto it = node.begin(); it != node.end(); it++) {
+      auto key = it->first.as<std::string>();
+      if (!YConfig[key]) {
+        YConfig[key] = YAML::Clone(it->second);
+      }
+    }
+  }
+  root = CompoundConfigNode(nullptr, YConfig, this);
+  useLConfig = false;
+
+  if (root.exists("variables")) {
+    variableRoot = root.lookup("variables");
+  } else {
+    variableRoot = CompoundConfigNode(nullptr, YAML::Node()); // null node
+  }
+}
+
 libconfig::Config& CompoundConfig::getLConfig() {
   return LConfig;
 }
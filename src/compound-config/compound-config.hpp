@@ -129,6 +129,11 @@ class CompoundConfig
   CompoundConfig(const char* inputFile);
   CompoundConfig(char* inputFile) : CompoundConfig((const char*) inputFile) {}
   CompoundConfig(std::vector<std::string> inputFiles);
+  // Compose a config from in-memory YAML maps, as if their files had been
+  // concatenated (on duplicate top-level keys the first node wins). The
+  // inputs are deep-copied: lookups through non-const yaml-cpp nodes can
+  // restructure them, and the inputs may be reused for other configs.
+  CompoundConfig(std::vector<YAML::Node> inputNodes);
 
   ~CompoundConfig(){}
 
@@ -139,7 +144,11 @@ class CompoundConfig
 
   bool hasLConfig() { return useLConfig;}
 
+  // The inputs the config was built from: its files, or, for a config
+  // composed in memory, the (uncopied) input nodes. Accelergy is run on
+  // these (see util/accelergy_interface.hpp).
   std::vector<std::string> inFiles;
+  std::vector<YAML::Node> inNodes;
 
 };
 
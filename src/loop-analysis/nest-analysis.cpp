@@ -40,6 +40,7 @@
 //        limited to the ComputeNetworkLinkTransfers() function.
 
 #include "util/misc.hpp"
+#include "util/trace.hpp"
 
 #include "nest-analysis.hpp"
 
@@ -200,6 +201,8 @@ std::ostream& operator << (std::ostream& out, const NestAnalysis& n)
 
 void NestAnalysis::ComputeWorkingSets()
 {
+  TRACE_SCOPE("nest-analysis/working-sets");
+
   if (nest_state_.size() != 0)
   {
     InitializeNestProperties();
@@ -26,6 +26,7 @@
  */
 
 #include <map>
+#include <set>
 #include <regex>
 
 #pragma once
@@ -310,9 +311,10 @@ class Constraints
   }
 
   //
-  // Check if a given mapping satisfies these constraints.
+  // Check if a given mapping satisfies these constraints. Permutations are
+  // not checked at the given levels, e.g., where a mapspace ignores them.
   //
-  bool SatisfiedBy(Mapping* mapping) const
+  bool SatisfiedBy(Mapping* mapping, const std::set<unsigned>& unchecked_permutation_levels = {}) const
   {
     // First generate a constraints object from the mapping.
     Constraints other(arch_props_, workload_);
@@ -324,25 +326,28 @@ class Constraints
 
     // (NOT IMPLEMENTED) return (*this >= candidate);
 
+    // Other has no entry for a spatial level the mapping does not fan out
+    // at, i.e., all of that level's factors are 1.
+    auto other_factor = [&other](unsigned level, problem::Shape::DimensionID dim)
+      {
+        auto other_level_it = other.factors_.find(level);
+        if (other_level_it == other.factors_.end())
+          return 1;
+        return other_level_it->second.at(dim);
+      };
+
     // --- Factors vs. other's Factors ---
     for (auto& level_entry: factors_)
     {
       unsigned level = level_entry.first;
       auto& level_factors = level_entry.second;
 
-      auto other_level_it = other.factors_.find(level);
-      assert(other_level_it != other.factors_.end());
-
-      auto other_level_factors = other_level_it->second;
       for (auto& dim_entry: level_factors)
       {
         auto dim = dim_entry.first;
         auto val = dim_entry.second;
         
-        auto other_dim_entry = other_level_factors.find(dim);
-        assert(other_dim_entry != other_level_factors.end());
-
-        if (other_dim_entry->second != val)
+        if (other_factor(level, dim) != val)
         {
           return false;
         }
@@ -357,19 +362,12 @@ class Constraints
       unsigned level = level_entry.first;
       auto& level_max_factors = level_entry.second;
 
-      auto other_level_it = other.factors_.find(level);
-      assert(other_level_it != other.factors_.end());
-
-      auto& other_level_factors = other_level_it->second;
       for (auto& dim_entry: level_max_factors)
       {
         auto dim = dim_entry.first;
         auto max_val = dim_entry.second;
         
-        auto other_dim_entry = other_level_factors.find(dim);
-        assert(other_dim_entry != other_level_factors.end());
-
-        if (other_dim_entry->second > max_val)
+        if (other_factor(level, dim) > max_val)
         {
           return false;
         }
@@ -379,39 +377,41 @@ class Constraints
     // --- Permutations ---
     for (auto& level_entry: permutations_)
     {
-      // This is tricky. We need to ignore unit-factors in other.
+      // This is tricky. The position of a unit-factor loop is meaningless, so
+      // we ignore unit-factors on both sides. What remains of our permutation
+      // (which may be partial, fixing only the innermost loops) must then be
+      // a prefix of what remains of other's.
       unsigned level = level_entry.first;
       auto& permutation = level_entry.second;
-
-      auto other_factors_level_it = other.factors_.find(level);
-      assert(other_factors_level_it != other.factors_.end());
-      auto& other_level_factors = other_factors_level_it->second;
+      if (unchecked_permutation_levels.count(level) != 0)
+        continue;
 
       auto other_permutation_level_it = other.permutations_.find(level);
-      assert(other_permutation_level_it != other.permutations_.end());
+      if (other_permutation_level_it == other.permutations_.end())
+        continue;
       auto& other_permutation = other_permutation_level_it->second;
       
       unsigned idx = 0, other_idx = 0;
-      while (idx < permutation.size() && other_idx < other_permutation.size())
+      while (true)
       {
-        if (permutation.at(idx) == other_permutation.at(other_idx))
-        {
-          // So far so good...
+        while (idx < permutation.size() && other_factor(level, permutation.at(idx)) == 1)
           idx++;
+        while (other_idx < other_permutation.size() &&
+               other_factor(level, other_permutation.at(other_idx)) == 1)
           other_idx++;
-          continue;
-        }
 
-        // We have a mismatch. However, if this is a unit-factor
-        // we can skip ahead.
-        if (other_level_factors.at(other_permutation.at(idx)) == 1)
+        if (idx == permutation.size())
+          break;
+
+        if (other_idx == other_permutation.size() ||
+            permutation.at(idx) != other_permutation.at(other_idx))
         {
-          other_idx++;
-          continue;
+          // Fail.
+          return false;
         }
 
-        // Fail.
-        return false;
+        idx++;
+        other_idx++;
       }
     }
     
@@ -422,7 +422,21 @@ class Constraints
       auto split = level_entry.second;
 
       auto other_level_it = other.spatial_splits_.find(level);
-      assert(other_level_it != other.spatial_splits_.end());
+      if (other_level_it == other.spatial_splits_.end())
+        continue;
+
+      // Other's split counts only its non-unit-factor X loops, so count ours
+      // the same way.
+      auto permutation_it = permutations_.find(level);
+      if (permutation_it != permutations_.end())
+      {
+        auto& permutation = permutation_it->second;
+        unsigned x_split = 0;
+        for (unsigned idx = 0; idx < split && idx < permutation.size(); idx++)
+          if (other_factor(level, permutation.at(idx)) != 1)
+            x_split++;
+        split = x_split;
+      }
 
       if (split != other_level_it->second)
       {
@@ -741,7 +755,8 @@ class Constraints
     std::string buffer;
     if (constraint.lookupValue("factors", buffer))
     {
-      std::regex re("([A-Za-z]+)[[:space:]]*[=]*[[:space:]]*([0-9]+)", std::regex::extended);
+      // Compiling the pattern dominates constraint parsing, so build it once.
+      static const std::regex re("([A-Za-z]+)[[:space:]]*[=]*[[:space:]]*([0-9]+)", std::regex::extended);
       std::smatch sm;
       std::string str = std::string(buffer);
 
@@ -799,7 +814,7 @@ class Constraints
     std::string buffer;
     if (constraint.lookupValue("factors", buffer))
     {
-      std::regex re("([A-Za-z]+)[[:space:]]*<=[[:space:]]*([0-9]+)", std::regex::extended);
+      static const std::regex re("([A-Za-z]+)[[:space:]]*<=[[:space:]]*([0-9]+)", std::regex::extended);
       std::smatch sm;
       std::string str = std::string(buffer);
 
@@ -26,6 +26,7 @@
  */
 
 #include <regex>
+#include <sstream>
 
 #include "parser.hpp"
 #include "arch-properties.hpp"
@@ -34,11 +35,11 @@ namespace mapping
 {
 
 //
-// Shared state.
+// Shared state (per thread, see ParseAndConstruct()).
 //
 
-ArchProperties arch_props_;
-problem::Workload workload_;
+thread_local ArchProperties arch_props_;
+thread_local problem::Workload workload_;
 
 //
 // Forward declarations.
@@ -56,7 +57,9 @@ Mapping ParseAndConstruct(config::CompoundConfigNode config,
                           model::Engine::Specs& arch_specs,
                           problem::Workload workload)
 {
-  arch_props_.Construct(arch_specs);
+  // Construct() appends to the level maps, so start from a fresh object in
+  // case this thread has parsed a mapping before.
+  arch_props_ = ArchProperties(arch_specs);
   workload_ = workload;
   
   std::map<unsigned, std::map<problem::Shape::DimensionID, int>> user_factors;
@@ -74,7 +77,8 @@ Mapping ParseAndConstruct(config::CompoundConfigNode config,
   }
 
   // Parse user-provided mapping.
-  assert(config.isList());
+  if (!config.isList())
+    throw ParseError("parsing mapping: mapping must be a list of directives");
   
   // Iterate over all the directives.
   int len = config.getLength();
@@ -83,7 +87,8 @@ Mapping ParseAndConstruct(config::CompoundConfigNode config,
     auto directive = config[i];
     // Find out if this is a temporal directive or a spatial directive.
     std::string type;
-    assert(directive.lookupValue("type", type));
+    if (!directive.lookupValue("type", type))
+      throw ParseError("parsing mapping: directive " + std::to_string(i) + " has no type");
 
     auto level_id = FindTargetTilingLevel(directive, type);
 
@@ -137,29 +142,25 @@ Mapping ParseAndConstruct(config::CompoundConfigNode config,
     auto permutation = user_permutations.find(level);
     if (permutation == user_permutations.end())
     {
-      std::cerr << "ERROR: parsing mapping: permutation not found for level: "
-                << arch_props_.TilingLevelName(level) << std::endl;
-      exit(1);
+      throw ParseError("parsing mapping: permutation not found for level: " +
+                       arch_props_.TilingLevelName(level));
     }
     if (permutation->second.size() != std::size_t(problem::GetShape()->NumDimensions))
     {
-      std::cerr << "ERROR: parsing mapping: permutation contains insufficient dimensions at level: "
-                << arch_props_.TilingLevelName(level) << std::endl;
-      exit(1);
+      throw ParseError("parsing mapping: permutation contains insufficient dimensions at level: " +
+                       arch_props_.TilingLevelName(level));
     }
       
     auto factors = user_factors.find(level);
     if (factors == user_factors.end())
     {
-      std::cerr << "ERROR: parsing mapping: factors not found for level: "
-                << arch_props_.TilingLevelName(level) << std::endl;
-      exit(1);
+      throw ParseError("parsing mapping: factors not found for level: " +
+                       arch_props_.TilingLevelName(level));
     }
     if (factors->second.size() != std::size_t(problem::GetShape()->NumDimensions))
     {
-      std::cerr << "ERROR: parsing mapping: factors not provided for all dimensions at level: "
-                << arch_props_.TilingLevelName(level) << std::endl;
-      exit(1);
+      throw ParseError("parsing mapping: factors not provided for all dimensions at level: " +
+                       arch_props_.TilingLevelName(level));
     }
 
     // Each partition has problem::GetShape()->NumDimensions loops.
@@ -180,22 +181,23 @@ Mapping ParseAndConstruct(config::CompoundConfigNode config,
   }
 
   // All user-provided factors must multiply-up to the dimension size.
-  bool fault = false;
+  std::ostringstream faults;
   for (unsigned dim = 0; dim < problem::GetShape()->NumDimensions; dim++)
   {
     if (dimension_factor_products[dim] != workload_.GetBound(dim))
     {
-      std::cerr << "ERROR: parsing mapping: product of all factors of dimension "
-                << problem::GetShape()->DimensionIDToName.at(dim) << " is "
-                << dimension_factor_products[dim] << ", which is not equal to "
-                << "the dimension size of the workload " << workload_.GetBound(dim)
-                << "." << std::endl;
-      fault = true;
+      if (faults.tellp() > 0)
+        faults << "; ";
+      faults << "parsing mapping: product of all factors of dimension "
+             << problem::GetShape()->DimensionIDToName.at(dim) << " is "
+             << dimension_factor_products[dim] << ", which is not equal to "
+             << "the dimension size of the workload " << workload_.GetBound(dim)
+             << ".";
     }
   }
-  if (fault)
+  if (faults.tellp() > 0)
   {
-    exit(1);
+    throw ParseError(faults.str());
   }
 
   // Concatenate the subnests to form the final mapping nest.
@@ -295,15 +297,16 @@ unsigned FindTargetTilingLevel(config::CompoundConfigNode directive, std::string
     }
     if (storage_level_id == num_storage_levels)
     {
-      std::cerr << "ERROR: target storage level not found: " << storage_level_name << std::endl;
-      exit(1);
+      throw ParseError("target storage level not found: " + storage_level_name);
     }
   }
   else
   {
     int id;
-    assert(directive.lookupValue("target", id));
-    assert(id >= 0  && id < int(num_storage_levels));
+    if (!directive.lookupValue("target", id))
+      throw ParseError("parsing mapping: " + type + " directive has no target");
+    if (id < 0 || id >= int(num_storage_levels))
+      throw ParseError("target storage level ID out of range: " + std::to_string(id));
     storage_level_id = static_cast<unsigned>(id);
   }
 
@@ -327,23 +330,23 @@ unsigned FindTargetTilingLevel(config::CompoundConfigNode directive, std::string
     }
     catch (const std::out_of_range& oor)
     {
-      std::cerr << "ERROR: cannot find spatial tiling level associated with "
-                << "storage level " << arch_props_.StorageLevelName(storage_level_id)
-                << ". This is because the number of instances of the next-inner "
-                << "level ";
+      std::ostringstream msg;
+      msg << "cannot find spatial tiling level associated with "
+          << "storage level " << arch_props_.StorageLevelName(storage_level_id)
+          << ". This is because the number of instances of the next-inner "
+          << "level ";
       if (storage_level_id != 0)
       {
-        std::cerr << "(" << arch_props_.StorageLevelName(storage_level_id-1) << ") ";
+        msg << "(" << arch_props_.StorageLevelName(storage_level_id-1) << ") ";
       }
-      std::cerr << "is the same as this level, which means there cannot "
-                << "be a spatial fanout." << std::endl;
-      exit(1);
+      msg << "is the same as this level, which means there cannot "
+          << "be a spatial fanout.";
+      throw ParseError(msg.str());
     }
   }
   else
   {
-    std::cerr << "ERROR: unrecognized mapping directive type: " << type << std::endl;
-    exit(1);
+    throw ParseError("unrecognized mapping directive type: " + type);
   }
 
   return tiling_level_id;
@@ -359,7 +362,7 @@ std::map<problem::Shape::DimensionID, int> ParseUserFactors(config::CompoundConf
   std::string buffer;
   if (directive.lookupValue("factors", buffer))
   {
-    std::regex re("([A-Za-z]+)[[:space:]]*[=]*[[:space:]]*([0-9]+)", std::regex::extended);
+    static const std::regex re("([A-Za-z]+)[[:space:]]*[=]*[[:space:]]*([0-9]+)", std::regex::extended);
     std::smatch sm;
     std::string str = std::string(buffer);
 
@@ -373,9 +376,8 @@ std::map<problem::Shape::DimensionID, int> ParseUserFactors(config::CompoundConf
       }
       catch (const std::out_of_range& oor)
       {
-        std::cerr << "ERROR: parsing factors: " << buffer << ": dimension " << dimension_name
-                  << " not found in problem shape." << std::endl;
-        exit(1);
+        throw ParseError("parsing factors: " + buffer + ": dimension " + dimension_name +
+                         " not found in problem shape.");
       }
 
       int end = std::stoi(sm[2]);
@@ -421,8 +423,11 @@ std::vector<problem::Shape::DimensionID> ParseUserPermutations(config::CompoundC
     char token;
     while (iss >> token)
     {
-      auto dimension = problem::GetShape()->DimensionNameToID.at(std::string(1, token)); // note: can fault.
-      retval.push_back(dimension);
+      auto dimension = problem::GetShape()->DimensionNameToID.find(std::string(1, token));
+      if (dimension == problem::GetShape()->DimensionNameToID.end())
+        throw ParseError("parsing permutation: " + buffer + ": dimension " + std::string(1, token) +
+                         " not found in problem shape.");
+      retval.push_back(dimension->second);
     }
   }
 
@@ -443,8 +448,11 @@ void ParseUserDatatypeBypassSettings(config::CompoundConfigNode directive,
     directive.lookupArrayValue("keep", datatype_strings);
     for (const std::string& datatype_string: datatype_strings)
     {
-      auto datatype = problem::GetShape()->DataSpaceNameToID.at(datatype_string);
-      user_bypass_strings.at(datatype).at(level) = '1';
+      auto datatype = problem::GetShape()->DataSpaceNameToID.find(datatype_string);
+      if (datatype == problem::GetShape()->DataSpaceNameToID.end())
+        throw ParseError("parsing bypass directive: data space " + datatype_string +
+                         " not found in problem shape.");
+      user_bypass_strings.at(datatype->second).at(level) = '1';
     }
   }
       
@@ -455,8 +463,11 @@ void ParseUserDatatypeBypassSettings(config::CompoundConfigNode directive,
     directive.lookupArrayValue("bypass", datatype_strings);
     for (const std::string& datatype_string: datatype_strings)
     {
-      auto datatype = problem::GetShape()->DataSpaceNameToID.at(datatype_string);
-      user_bypass_strings.at(datatype).at(level) = '0';
+      auto datatype = problem::GetShape()->DataSpaceNameToID.find(datatype_string);
+      if (datatype == problem::GetShape()->DataSpaceNameToID.end())
+        throw ParseError("parsing bypass directive: data space " + datatype_string +
+                         " not found in problem shape.");
+      user_bypass_strings.at(datatype->second).at(level) = '0';
     }
   }
 }
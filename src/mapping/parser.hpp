@@ -27,6 +27,8 @@
 
 #pragma once
 
+#include <stdexcept>
+
 #include "mapping.hpp"
 #include "model/engine.hpp"
 #include "compound-config/compound-config.hpp"
@@ -34,6 +36,17 @@
 namespace mapping
 {
 
+// Thrown when a user-provided mapping is malformed or does not fit the
+// workload or architecture. Callers that cannot recover report what() as an
+// error and exit; the model server reports it back to the client.
+class ParseError : public std::runtime_error
+{
+ public:
+  explicit ParseError(const std::string& what) : std::runtime_error(what) {}
+};
+
+// Safe to call concurrently from multiple threads: the parser's shared state
+// is per-thread.
 Mapping ParseAndConstruct(config::CompoundConfigNode config, model::Engine::Specs& arch_specs, problem::Workload workload);
 
 } // namespace mapping
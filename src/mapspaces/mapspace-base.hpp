@@ -83,6 +83,24 @@ class MapSpace
 
   virtual bool ConstructMapping(ID mapping_id, Mapping* mapping) = 0;
 
+  // Storage levels that every mapping in this space keeps each data space
+  // at (bit set = always kept). The default makes no such guarantee.
+  virtual tiling::CompoundMaskNest KeptMasks() const
+  {
+    tiling::CompoundMaskNest masks;
+    for (unsigned pvi = 0; pvi < unsigned(problem::GetShape()->NumDataSpaces); pvi++)
+      masks.at(pvi).reset();
+    return masks;
+  }
+
+  // Whether a mapping built elsewhere (e.g., a warm-start candidate) meets
+  // this space's constraints. The default accepts every mapping.
+  virtual bool ConstraintsSatisfiedBy(Mapping* mapping) const
+  {
+    (void) mapping;
+    return true;
+  }
+
   bool ConstructMapping(const uint128_t mapping_id,
                         Mapping* mapping)
   {
@@ -44,6 +44,7 @@ MapSpace* ParseAndConstruct(config::CompoundConfigNode config,
                             model::Engine::Specs& arch_specs,
                             const problem::Workload& workload)
 {
+  TRACE_SCOPE("mapspace/construct");
   MapSpace* mapspace = nullptr;
   
   std::string mapspace_template = "uber";
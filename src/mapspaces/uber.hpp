@@ -33,6 +33,7 @@
 
 #include "util/numeric.hpp"
 #include "util/misc.hpp"
+#include "util/trace.hpp"
 #include "workload/problem-shape.hpp"
 #include "mapspaces/mapspace-base.hpp"
 #include "mapspaces/subspaces.hpp"
@@ -68,6 +69,10 @@ class Uber : public MapSpace
   // Constraints.
   mapping::Constraints constraints_;
 
+  // Levels whose loop order is the canonical pattern, whatever the
+  // constraints say (see InitLoopPermutationSpace()).
+  std::set<unsigned> canonical_permutation_levels_;
+
  public:
 
   //
@@ -222,6 +227,7 @@ class Uber : public MapSpace
     auto user_permutations = constraints_.Permutations();
 
     permutation_space_.Init(arch_props_.TilingLevels());
+    canonical_permutation_levels_.clear();
     
     for (uint64_t level = 0; level < arch_props_.TilingLevels(); level++)
     {
@@ -247,6 +253,7 @@ class Uber : public MapSpace
       {
         // Permutations do not matter; use canonical pattern.
         permutation_space_.InitLevelCanonical(level);
+        canonical_permutation_levels_.insert(level);
       }
       else
       {
@@ -406,6 +413,23 @@ class Uber : public MapSpace
 
 
   Uber(const Uber& other) = default;
+
+  //
+  // Levels at which every datatype bypass nest in the space keeps a data space.
+  //
+  tiling::CompoundMaskNest KeptMasks() const
+  {
+    tiling::CompoundMaskNest masks;
+    for (unsigned pvi = 0; pvi < unsigned(problem::GetShape()->NumDataSpaces); pvi++)
+    {
+      masks.at(pvi).set();
+      for (auto& compound_mask_nest: datatype_bypass_nest_space_)
+      {
+        masks.at(pvi) &= compound_mask_nest.at(pvi);
+      }
+    }
+    return masks;
+  }
   
   //
   // Split the mapspace (used for parallelization).
@@ -564,10 +588,16 @@ class Uber : public MapSpace
     InitSubnests(subnests);
 
     // === Stage 1 ===
-    PermuteSubnests(mapping_permutation_id, subnests);
+    {
+      TRACE_SCOPE("mapspace/permute");
+      PermuteSubnests(mapping_permutation_id, subnests);
+    }
 
     // === Stage 2 ===
-    AssignIndexFactors(mapping_index_factorization_id, subnests);
+    {
+      TRACE_SCOPE("mapspace/index-factors");
+      AssignIndexFactors(mapping_index_factorization_id, subnests);
+    }
 
     // === Stage 4 ===
     mapping->datatype_bypass_nest = ConstructDatatypeBypassNest(mapping_datatype_bypass_id);
@@ -580,7 +610,11 @@ class Uber : public MapSpace
     // not.
     
     // === Stage 3 ===
-    bool success = AssignSpatialTilingDirections(mapping_spatial_id, subnests, mapping->datatype_bypass_nest);
+    bool success;
+    {
+      TRACE_SCOPE("mapspace/spatial");
+      success = AssignSpatialTilingDirections(mapping_spatial_id, subnests, mapping->datatype_bypass_nest);
+    }
     if (!success)
     {
       return false;
@@ -864,6 +898,11 @@ class Uber : public MapSpace
     constraints_.Parse(config);
     constraints_.Parse(arch_constraints);
   }
+
+  bool ConstraintsSatisfiedBy(Mapping* mapping) const override
+  {
+    return constraints_.SatisfiedBy(mapping, canonical_permutation_levels_);
+  }
 };
 
 
@@ -38,11 +38,15 @@ namespace model
 {
 
 ArithmeticUnits::ArithmeticUnits(const Specs& specs) :
+    ArithmeticUnits(std::make_shared<const Specs>(specs))
+{ }
+
+ArithmeticUnits::ArithmeticUnits(std::shared_ptr<const Specs> specs) :
     specs_(specs)
 {
   is_specced_ = true;
   is_evaluated_ = false;
-  area_ = specs_.area.Get();
+  area_ = specs_->area.Get();
 }
 
 ArithmeticUnits::Specs ArithmeticUnits::ParseSpecs(config::CompoundConfigNode setting, uint32_t nElements)
@@ -235,7 +239,7 @@ void ArithmeticUnits::ConnectResult(std::shared_ptr<Network> network)
 std::string ArithmeticUnits::Name() const
 {
   assert(is_specced_);
-  return specs_.name.Get();
+  return specs_->name.Get();
 }
 
 double ArithmeticUnits::Energy(problem::Shape::DataSpaceID pv) const
@@ -248,7 +252,7 @@ double ArithmeticUnits::Energy(problem::Shape::DataSpaceID pv) const
 double ArithmeticUnits::Area() const
 {
   assert(is_specced_);
-  return AreaPerInstance() * specs_.instances.Get();
+  return AreaPerInstance() * specs_->instances.Get();
 }
 
 double ArithmeticUnits::AreaPerInstance() const
@@ -275,17 +279,17 @@ void ArithmeticUnits::Print(std::ostream& out) const
   std::string indent = "    ";
 
   // Print level name.
-  out << "=== " << specs_.name << " ===" << std::endl;  
+  out << "=== " << specs_->name << " ===" << std::endl;  
   out << std::endl;
 
   // Print specs.
   out << indent << "SPECS" << std::endl;
   out << indent << "-----" << std::endl;
 
-  out << indent << "Word bits            : " << specs_.word_bits << std::endl;    
-  out << indent << "Instances            : " << specs_.instances << " ("
-      << specs_.meshX << "*" << specs_.meshY << ")" << std::endl;
-  out << indent << "Energy-per-op        : " << specs_.energy_per_op << " pJ" << std::endl;
+  out << indent << "Word bits            : " << specs_->word_bits << std::endl;    
+  out << indent << "Instances            : " << specs_->instances << " ("
+      << specs_->meshX << "*" << specs_->meshY << ")" << std::endl;
+  out << indent << "Energy-per-op        : " << specs_->energy_per_op << " pJ" << std::endl;
   out << std::endl;
 
   // Print stats.
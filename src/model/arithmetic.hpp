@@ -28,6 +28,7 @@
 #pragma once
 
 #include <boost/serialization/export.hpp>
+#include <boost/serialization/split_member.hpp>
 
 #include "loop-analysis/nest-analysis.hpp"
 #include "model/level.hpp"
@@ -38,7 +39,7 @@
 namespace model
 {
 
-class ArithmeticUnits : public Level
+class ArithmeticUnits final : public Level
 {
  public:
   struct Specs : public LevelSpecs
@@ -81,7 +82,8 @@ class ArithmeticUnits : public Level
   };
   
  private:
-  Specs specs_;
+  // Immutable, shared with the Topology::Specs this level was created from.
+  std::shared_ptr<const Specs> specs_;
 
   // Network endpoints.
   std::shared_ptr<Network> network_operand_;
@@ -93,16 +95,19 @@ class ArithmeticUnits : public Level
   std::uint64_t cycles_ = 0;
   std::size_t utilized_instances_ = 0;
   std::uint64_t maccs_ = 0;
+  double op_count_ = 0; // Density-scaled MACCs, i.e., energy_ / energy_per_op.
 
   // Serialization
   friend class boost::serialization::access;
   template <class Archive>
-  void serialize(Archive& ar, const unsigned int version = 0)
+  void save(Archive& ar, const unsigned int version) const
   {
     ar & BOOST_SERIALIZATION_BASE_OBJECT_NVP(Level);    
     if (version == 0)
     {
-      ar& BOOST_SERIALIZATION_NVP(specs_);
+      // Specs are serialized by value.
+      const Specs& specs = *specs_;
+      ar& boost::serialization::make_nvp("specs_", specs);
       ar& BOOST_SERIALIZATION_NVP(energy_);
       ar& BOOST_SERIALIZATION_NVP(area_);
       ar& BOOST_SERIALIZATION_NVP(cycles_);
@@ -110,10 +115,30 @@ class ArithmeticUnits : public Level
       ar& BOOST_SERIALIZATION_NVP(maccs_);
     }
   }
+
+  template <class Archive>
+  void load(Archive& ar, const unsigned int version)
+  {
+    ar & BOOST_SERIALIZATION_BASE_OBJECT_NVP(Level);    
+    if (version == 0)
+    {
+      Specs specs;
+      ar& boost::serialization::make_nvp("specs_", specs);
+      ar& BOOST_SERIALIZATION_NVP(energy_);
+      ar& BOOST_SERIALIZATION_NVP(area_);
+      ar& BOOST_SERIALIZATION_NVP(cycles_);
+      ar& BOOST_SERIALIZATION_NVP(utilized_instances_);
+      ar& BOOST_SERIALIZATION_NVP(maccs_);
+      specs_ = std::make_shared<const Specs>(specs);
+    }
+  }
+
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
   
  public:
   ArithmeticUnits() { }
   ArithmeticUnits(const Specs & specs);
+  ArithmeticUnits(std::shared_ptr<const Specs> specs);
   ~ArithmeticUnits() { }
   
   std::shared_ptr<Level> Clone() const override
@@ -127,7 +152,7 @@ class ArithmeticUnits : public Level
   static Specs ParseSpecs(config::CompoundConfigNode setting, uint32_t nElements);
   static void ValidateTopology(ArithmeticUnits::Specs& specs);
   
-  Specs& GetSpecs() { return specs_; }
+  const Specs& GetSpecs() const { return *specs_; }
 
   // Connect to networks.
   void ConnectOperand(std::shared_ptr<Network> network);
@@ -197,17 +222,21 @@ class ArithmeticUnits : public Level
 
     // maccs_ = analysis->GetMACs();
 
-    if (utilized_instances_ <= specs_.instances.Get())
+    if (utilized_instances_ <= specs_->instances.Get())
     {
       cycles_ = compute_cycles;
       maccs_ = utilized_instances_ * compute_cycles;
-      energy_ = maccs_ * specs_.energy_per_op.Get();
+      energy_ = maccs_ * specs_->energy_per_op.Get();
+      op_count_ = maccs_;
 
       // Scale energy for sparsity.
       for (unsigned d = 0; d < problem::GetShape()->NumDataSpaces; d++)
       {
         if (!problem::GetShape()->IsReadWriteDataSpace.at(d))
+        {
           energy_ *= workload.GetDensity(d);
+          op_count_ *= workload.GetDensity(d);
+        }
       }
 
       is_evaluated_ = true;    
@@ -217,7 +246,7 @@ class ArithmeticUnits : public Level
       eval_status.success = false;
       std::ostringstream str;
       str << "mapped Arithmetic instances " << utilized_instances_
-          << " exceeds hardware instances " << specs_.instances.Get();
+          << " exceeds hardware instances " << specs_->instances.Get();
       eval_status.fail_reason = str.str();
     }
     
@@ -230,11 +259,18 @@ class ArithmeticUnits : public Level
     return maccs_;
   }
 
+  // Number of ops that Energy() charges energy_per_op for.
+  double ActionCount() const
+  {
+    assert(is_evaluated_);
+    return op_count_;
+  }
+
   double IdealCycles() const
   {
     // FIXME: why would this be different from Cycles()?
     assert(is_evaluated_);
-    return double(maccs_) / specs_.instances.Get();
+    return double(maccs_) / specs_->instances.Get();
   }
 };
 
@@ -0,0 +1,456 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "model/binary-stats.hpp"
+#include "util/cache-file.hpp"
+
+namespace model
+{
+
+static const char kStatsMagic[8] = { 'T', 'L', 'S', 'T', 'A', 'T', 'S', '\0' };
+static const std::uint32_t kStatsVersion = 2;
+
+// A section of the file under construction.
+class StatsSection
+{
+ public:
+  std::string bytes;
+
+  template<class T>
+  void Append(const T& value)
+  {
+    bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  void Align()
+  {
+    bytes.resize((bytes.size() + 7) & ~std::size_t(7), '\0');
+  }
+};
+
+static std::uint64_t AddString(StatsSection& strings, const std::string& str)
+{
+  std::uint64_t offset = strings.bytes.size();
+  strings.bytes.append(str);
+  strings.bytes.push_back('\0');
+  return offset;
+}
+
+bool BinaryStats::Save(const std::string& path, const Engine& engine, const Mapping& mapping,
+                       const problem::Workload& workload, const std::string& config_text)
+{
+  auto& topology = engine.GetTopology();
+  auto& stats = topology.GetStats();
+  auto shape = problem::GetShape();
+
+  unsigned num_data_spaces = shape->NumDataSpaces;
+  unsigned num_storage_levels = topology.NumStorageLevels();
+  unsigned num_networks = topology.NumNetworkModules();
+
+  BinaryStatsHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kStatsMagic, sizeof(kStatsMagic));
+  header.version = kStatsVersion;
+  header.num_data_spaces = num_data_spaces;
+  header.num_dimensions = shape->NumDimensions;
+  header.num_storage_levels = num_storage_levels;
+  header.num_networks = num_networks;
+  header.num_loops = mapping.loop_nest.loops.size();
+  header.num_boundaries = mapping.loop_nest.storage_tiling_boundaries.size();
+  header.energy = stats.energy;
+  header.area = stats.area;
+  header.utilization = stats.utilization;
+  header.cycles = stats.cycles;
+  header.maccs = stats.maccs;
+  header.last_level_accesses = stats.last_level_accesses;
+
+  StatsSection strings, names, bounds, storage, arithmetic, networks, loops, boundaries, bypass, ert;
+
+  for (unsigned dim = 0; dim < shape->NumDimensions; dim++)
+  {
+    names.Append(AddString(strings, shape->DimensionIDToName.at(dim)));
+    bounds.Append(std::int64_t(workload.GetBound(dim)));
+  }
+  for (unsigned pv = 0; pv < num_data_spaces; pv++)
+    names.Append(AddString(strings, shape->DataSpaceIDToName.at(pv)));
+
+  for (unsigned storage_level_id = 0; storage_level_id < num_storage_levels; storage_level_id++)
+  {
+    auto& level = topology.GetStorageLevelModule(storage_level_id);
+    auto& specs = level.GetSpecs();
+    auto& level_stats = level.GetStats();
+
+    StorageLevelRecord record;
+    record.name = AddString(strings, level.Name());
+    record.instances = specs.instances.IsSpecified() ? specs.instances.Get() : 0;
+    record.size = specs.size.IsSpecified() ? specs.size.Get() : 0;
+    record.cycles = level_stats.cycles;
+    record.slowdown = level_stats.slowdown;
+    record.energy = level.Energy();
+    record.area = level.Area();
+    record.reserved = 0;
+    storage.Append(record);
+
+    // Counters and metrics are stored column-wise, in enum order.
+    auto append_counts = [&](const auto& per_data_space)
+      {
+        for (unsigned pv = 0; pv < num_data_spaces; pv++)
+          storage.Append(std::uint64_t(per_data_space.at(pv)));
+      };
+    append_counts(level_stats.keep);
+    append_counts(level_stats.partition_size);
+    append_counts(level_stats.utilized_capacity);
+    append_counts(level_stats.utilized_instances);
+    append_counts(level_stats.utilized_clusters);
+    append_counts(level_stats.reads);
+    append_counts(level_stats.updates);
+    append_counts(level_stats.fills);
+    append_counts(level_stats.address_generations);
+    append_counts(level_stats.temporal_reductions);
+    append_counts(stats.tile_sizes.at(storage_level_id));
+
+    auto append_values = [&](const problem::PerDataSpace<double>& per_data_space)
+      {
+        for (unsigned pv = 0; pv < num_data_spaces; pv++)
+          storage.Append(per_data_space.at(pv));
+      };
+    append_values(level_stats.read_bandwidth);
+    append_values(level_stats.write_bandwidth);
+    append_values(level_stats.energy_per_access);
+    append_values(level_stats.energy);
+    append_values(level_stats.temporal_reduction_energy);
+    append_values(level_stats.addr_gen_energy);
+  }
+
+  auto& arithmetic_level = topology.GetArithmeticLevelModule();
+  auto& arithmetic_specs = arithmetic_level.GetSpecs();
+  ArithmeticRecord arithmetic_record;
+  arithmetic_record.name = AddString(strings, arithmetic_level.Name());
+  arithmetic_record.instances = arithmetic_specs.instances.IsSpecified() ? arithmetic_specs.instances.Get() : 0;
+  arithmetic_record.utilized_instances = arithmetic_level.UtilizedInstances();
+  arithmetic_record.cycles = arithmetic_level.Cycles();
+  arithmetic_record.maccs = stats.maccs;
+  arithmetic_record.energy = arithmetic_level.Energy();
+  arithmetic_record.area = arithmetic_level.Area();
+  arithmetic_record.reserved = 0;
+  arithmetic.Append(arithmetic_record);
+
+  for (unsigned network_id = 0; network_id < num_networks; network_id++)
+  {
+    auto& network = topology.GetNetworkModule(network_id);
+    NetworkRecord record;
+    record.name = AddString(strings, network.Name());
+    record.word_bits = network.WordBits();
+    record.energy = network.Energy();
+    record.reserved = 0;
+    networks.Append(record);
+    for (unsigned pv = 0; pv < num_data_spaces; pv++)
+      networks.Append(network.Energy(pv));
+  }
+
+  for (auto& loop : mapping.loop_nest.loops)
+  {
+    LoopRecord record;
+    record.dimension = loop.dimension;
+    record.start = loop.start;
+    record.end = loop.end;
+    record.stride = loop.stride;
+    record.spacetime_dimension = int(loop.spacetime_dimension);
+    record.reserved = 0;
+    loops.Append(record);
+  }
+
+  for (auto boundary : mapping.loop_nest.storage_tiling_boundaries)
+    boundaries.Append(std::uint64_t(boundary));
+
+  for (unsigned pv = 0; pv < num_data_spaces; pv++)
+    bypass.Append(std::uint64_t(mapping.datatype_bypass_nest.at(pv).to_ullong()));
+
+  // The energies may come from an ERT that is not in the config (e.g., one
+  // generated by Accelergy), so they are stored for re-evaluation.
+  std::ostringstream ert_image;
+  engine.GetSpecs().topology.AppliedERT().Write(ert_image);
+  ert.bytes = ert_image.str();
+
+  // Lay the sections out back to back after the header.
+  std::uint64_t offset = sizeof(header);
+  auto place = [&offset](StatsSection& section)
+    {
+      section.Align();
+      std::uint64_t section_offset = offset;
+      offset += section.bytes.size();
+      return section_offset;
+    };
+
+  header.strings_bytes = strings.bytes.size();
+  header.strings_offset = place(strings);
+  header.names_offset = place(names);
+  header.bounds_offset = place(bounds);
+  header.storage_offset = place(storage);
+  header.storage_stride = sizeof(StorageLevelRecord) +
+    (unsigned(StorageCounter::Num) + unsigned(StorageMetric::Num)) * num_data_spaces * 8;
+  header.arithmetic_offset = place(arithmetic);
+  header.networks_offset = place(networks);
+  header.network_stride = sizeof(NetworkRecord) + num_data_spaces * 8;
+  header.loops_offset = place(loops);
+  header.boundaries_offset = place(boundaries);
+  header.bypass_offset = place(bypass);
+  header.ert_bytes = ert.bytes.size();
+  header.ert_offset = place(ert);
+  header.config_offset = offset;
+  header.config_bytes = config_text.size();
+  header.file_bytes = offset + config_text.size();
+
+  // Readers never map a partially-written file.
+  return cache::SaveAtomically(path, [&](std::ostream& out)
+  {
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (auto section : { &strings, &names, &bounds, &storage, &arithmetic, &networks,
+                          &loops, &boundaries, &bypass, &ert })
+      out.write(section->bytes.data(), section->bytes.size());
+    out.write(config_text.data(), config_text.size());
+  });
+}
+
+bool BinaryStats::Load(const std::string& path)
+{
+  Close();
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || std::size_t(st.st_size) < sizeof(BinaryStatsHeader))
+  {
+    close(fd);
+    return false;
+  }
+
+  void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED)
+    return false;
+
+  base_ = static_cast<const char*>(addr);
+  bytes_ = st.st_size;
+
+  auto& header = Header();
+  if (std::memcmp(header.magic, kStatsMagic, sizeof(kStatsMagic)) != 0 ||
+      header.version != kStatsVersion ||
+      header.file_bytes != bytes_ ||
+      !IsConsistent())
+  {
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+// Whether every section, and every name the records refer to, lies within
+// the mapped file, so that the accessors never read outside it.
+bool BinaryStats::IsConsistent() const
+{
+  auto& header = Header();
+  std::uint64_t num_data_spaces = header.num_data_spaces;
+
+  // A section of count elements of the given size, 8-byte aligned.
+  auto fits = [this](std::uint64_t offset, std::uint64_t count, std::uint64_t size)
+    {
+      return offset % 8 == 0 && offset >= sizeof(BinaryStatsHeader) && offset <= bytes_ &&
+        (size == 0 || count <= (bytes_ - offset) / size);
+    };
+  auto is_string = [&header](std::uint64_t offset)
+    {
+      return offset < header.strings_bytes;
+    };
+
+  std::uint64_t storage_stride = sizeof(StorageLevelRecord) +
+    (unsigned(StorageCounter::Num) + unsigned(StorageMetric::Num)) * num_data_spaces * 8;
+  std::uint64_t network_stride = sizeof(NetworkRecord) + num_data_spaces * 8;
+  if (header.storage_stride != storage_stride ||
+      header.network_stride != network_stride ||
+      !fits(header.strings_offset, header.strings_bytes, 1) ||
+      (header.strings_bytes > 0 && base_[header.strings_offset + header.strings_bytes - 1] != '\0') ||
+      !fits(header.names_offset, std::uint64_t(header.num_dimensions) + num_data_spaces, 8) ||
+      !fits(header.bounds_offset, header.num_dimensions, 8) ||
+      !fits(header.storage_offset, header.num_storage_levels, storage_stride) ||
+      !fits(header.arithmetic_offset, 1, sizeof(ArithmeticRecord)) ||
+      !fits(header.networks_offset, header.num_networks, network_stride) ||
+      !fits(header.loops_offset, header.num_loops, sizeof(LoopRecord)) ||
+      !fits(header.boundaries_offset, header.num_boundaries, 8) ||
+      !fits(header.bypass_offset, num_data_spaces, 8) ||
+      !fits(header.ert_offset, header.ert_bytes, 1) ||
+      header.config_offset < sizeof(BinaryStatsHeader) || header.config_offset > bytes_ ||
+      header.config_bytes > bytes_ - header.config_offset)
+    return false;
+
+  auto names = At<std::uint64_t>(header.names_offset);
+  for (std::uint64_t i = 0; i < header.num_dimensions + num_data_spaces; i++)
+  {
+    if (!is_string(names[i]))
+      return false;
+  }
+  for (unsigned i = 0; i < header.num_storage_levels; i++)
+  {
+    if (!is_string(StorageLevel(i).name))
+      return false;
+  }
+  if (!is_string(Arithmetic().name))
+    return false;
+  for (unsigned i = 0; i < header.num_networks; i++)
+  {
+    if (!is_string(Network(i).name))
+      return false;
+  }
+
+  // GetMapping() indexes the problem dimensions and the loop nest with these.
+  auto loops = At<LoopRecord>(header.loops_offset);
+  for (unsigned i = 0; i < header.num_loops; i++)
+  {
+    if (loops[i].dimension < 0 || std::uint32_t(loops[i].dimension) >= header.num_dimensions)
+      return false;
+  }
+  auto boundaries = At<std::uint64_t>(header.boundaries_offset);
+  for (unsigned i = 0; i < header.num_boundaries; i++)
+  {
+    if (boundaries[i] >= header.num_loops)
+      return false;
+  }
+  return true;
+}
+
+void BinaryStats::Close()
+{
+  if (base_)
+  {
+    munmap(const_cast<char*>(base_), bytes_);
+    base_ = nullptr;
+    bytes_ = 0;
+  }
+}
+
+const char* BinaryStats::DimensionName(unsigned dim) const
+{
+  return String(At<std::uint64_t>(Header().names_offset)[dim]);
+}
+
+const char* BinaryStats::DataSpaceName(unsigned pv) const
+{
+  return String(At<std::uint64_t>(Header().names_offset)[Header().num_dimensions + pv]);
+}
+
+std::int64_t BinaryStats::Bound(unsigned dim) const
+{
+  return At<std::int64_t>(Header().bounds_offset)[dim];
+}
+
+const StorageLevelRecord& BinaryStats::StorageLevel(unsigned storage_level_id) const
+{
+  auto& header = Header();
+  return *At<StorageLevelRecord>(header.storage_offset + storage_level_id * header.storage_stride);
+}
+
+std::uint64_t BinaryStats::StorageCount(unsigned storage_level_id, StorageCounter counter, unsigned pv) const
+{
+  auto& header = Header();
+  auto counters = At<std::uint64_t>(header.storage_offset + storage_level_id * header.storage_stride +
+                                    sizeof(StorageLevelRecord));
+  return counters[unsigned(counter) * header.num_data_spaces + pv];
+}
+
+double BinaryStats::StorageValue(unsigned storage_level_id, StorageMetric metric, unsigned pv) const
+{
+  auto& header = Header();
+  auto metrics = At<double>(header.storage_offset + storage_level_id * header.storage_stride +
+                            sizeof(StorageLevelRecord) +
+                            unsigned(StorageCounter::Num) * header.num_data_spaces * 8);
+  return metrics[unsigned(metric) * header.num_data_spaces + pv];
+}
+
+const NetworkRecord& BinaryStats::Network(unsigned network_id) const
+{
+  auto& header = Header();
+  return *At<NetworkRecord>(header.networks_offset + network_id * header.network_stride);
+}
+
+double BinaryStats::NetworkEnergy(unsigned network_id, unsigned pv) const
+{
+  auto& header = Header();
+  return At<double>(header.networks_offset + network_id * header.network_stride +
+                    sizeof(NetworkRecord))[pv];
+}
+
+std::string BinaryStats::Config() const
+{
+  auto& header = Header();
+  return std::string(At<char>(header.config_offset), header.config_bytes);
+}
+
+bool BinaryStats::GetERT(CompiledERT& ert) const
+{
+  auto& header = Header();
+  std::istringstream image(std::string(At<char>(header.ert_offset), header.ert_bytes));
+  return ert.Read(image);
+}
+
+Mapping BinaryStats::GetMapping() const
+{
+  auto& header = Header();
+  assert(header.num_data_spaces == problem::GetShape()->NumDataSpaces);
+
+  Mapping mapping;
+  auto loops = At<LoopRecord>(header.loops_offset);
+  for (unsigned i = 0; i < header.num_loops; i++)
+  {
+    mapping.loop_nest.loops.push_back(
+      loop::Descriptor(loops[i].dimension, loops[i].start, loops[i].end, loops[i].stride,
+                       spacetime::Dimension(loops[i].spacetime_dimension)));
+  }
+
+  auto boundaries = At<std::uint64_t>(header.boundaries_offset);
+  mapping.loop_nest.storage_tiling_boundaries.assign(boundaries, boundaries + header.num_boundaries);
+
+  auto bypass = At<std::uint64_t>(header.bypass_offset);
+  for (unsigned pv = 0; pv < header.num_data_spaces; pv++)
+    mapping.datatype_bypass_nest.at(pv) = std::bitset<tiling::MaxTilingLevels>(bypass[pv]);
+
+  return mapping;
+}
+
+} // namespace model
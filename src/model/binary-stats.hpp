@@ -0,0 +1,239 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "mapping/mapping.hpp"
+#include "model/engine.hpp"
+
+namespace model
+{
+
+//--------------------------------------------//
+//            Binary stats archive            //
+//--------------------------------------------//
+
+// A compact alternative to the map+stats XML archive for runs that produce
+// many outputs. The file is a flat image with 8-byte aligned sections that
+// is mmap'ed and indexed in place, so reading one stat does not require
+// parsing the rest of the file:
+//
+//   BinaryStatsHeader
+//   strings:    NUL-terminated names, referenced by byte offset
+//   names:      u64[num_dimensions + num_data_spaces] (string offsets)
+//   bounds:     i64[num_dimensions]
+//   storage:    num_storage_levels x { StorageLevelRecord,
+//                                      u64[StorageCounter::Num][num_data_spaces],
+//                                      f64[StorageMetric::Num][num_data_spaces] }
+//   arithmetic: ArithmeticRecord
+//   networks:   num_networks x { NetworkRecord, f64[num_data_spaces] }
+//   loops:      LoopRecord[num_loops]
+//   boundaries: u64[num_boundaries] (storage tiling boundaries)
+//   bypass:     u64[num_data_spaces] (keep masks, bit i = storage level i)
+//   ert:        the energies the run applied, as a CompiledERT image (see
+//               Topology::Specs::AppliedERT)
+//   config:     YAML text of the input configuration (may be empty)
+//
+// Multi-byte values use native endianness. The version is bumped on any
+// layout change and readers reject files of other versions.
+
+struct BinaryStatsHeader
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t num_data_spaces;
+  std::uint32_t num_dimensions;
+  std::uint32_t num_storage_levels;
+  std::uint32_t num_networks;
+  std::uint32_t num_loops;
+  std::uint32_t num_boundaries;
+  std::uint32_t reserved;
+
+  // Topology-level summary.
+  double energy;
+  double area;
+  double utilization;
+  std::uint64_t cycles;
+  std::uint64_t maccs;
+  std::uint64_t last_level_accesses;
+
+  // Section offsets (bytes from the start of the file) and sizes.
+  std::uint64_t strings_offset;
+  std::uint64_t strings_bytes;
+  std::uint64_t names_offset;
+  std::uint64_t bounds_offset;
+  std::uint64_t storage_offset;
+  std::uint64_t storage_stride;
+  std::uint64_t arithmetic_offset;
+  std::uint64_t networks_offset;
+  std::uint64_t network_stride;
+  std::uint64_t loops_offset;
+  std::uint64_t boundaries_offset;
+  std::uint64_t bypass_offset;
+  std::uint64_t ert_offset;
+  std::uint64_t ert_bytes;
+  std::uint64_t config_offset;
+  std::uint64_t config_bytes;
+  std::uint64_t file_bytes;
+};
+
+// Per-data-space integer stats of a storage level.
+enum class StorageCounter
+{
+  Keep,
+  PartitionSize,
+  UtilizedCapacity,
+  UtilizedInstances,
+  UtilizedClusters,
+  Reads,
+  Updates,
+  Fills,
+  AddressGenerations,
+  TemporalReductions,
+  TileSize,
+  Num
+};
+
+// Per-data-space floating-point stats of a storage level.
+enum class StorageMetric
+{
+  ReadBandwidth,
+  WriteBandwidth,
+  EnergyPerAccess,
+  Energy,
+  TemporalReductionEnergy,
+  AddrGenEnergy,
+  Num
+};
+
+struct StorageLevelRecord
+{
+  std::uint64_t name;      // String offset.
+  std::uint64_t instances; // Specified instances, 0 if unspecified.
+  std::uint64_t size;      // Specified capacity in words, 0 if unspecified.
+  std::uint64_t cycles;
+  double slowdown;
+  double energy;
+  double area;
+  double reserved;
+};
+
+struct ArithmeticRecord
+{
+  std::uint64_t name;
+  std::uint64_t instances;
+  std::uint64_t utilized_instances;
+  std::uint64_t cycles;
+  std::uint64_t maccs;
+  double energy;
+  double area;
+  double reserved;
+};
+
+struct NetworkRecord
+{
+  std::uint64_t name;
+  std::uint64_t word_bits;
+  double energy;
+  double reserved;
+};
+
+struct LoopRecord
+{
+  std::int32_t dimension;
+  std::int32_t start;
+  std::int32_t end;
+  std::int32_t stride;
+  std::int32_t spacetime_dimension;
+  std::int32_t reserved;
+};
+
+class BinaryStats
+{
+ private:
+  const char* base_ = nullptr;
+  std::size_t bytes_ = 0;
+
+  template<class T>
+  const T* At(std::uint64_t offset) const
+  {
+    return reinterpret_cast<const T*>(base_ + offset);
+  }
+
+  bool IsConsistent() const;
+
+ public:
+  BinaryStats() = default;
+  ~BinaryStats() { Close(); }
+
+  BinaryStats(const BinaryStats&) = delete;
+  BinaryStats& operator = (const BinaryStats&) = delete;
+
+  // Writes an evaluated engine and its mapping. The problem shape must be
+  // the one the engine was evaluated with. config_text is stored verbatim
+  // so that the full XML/text outputs can be regenerated from the file.
+  static bool Save(const std::string& path, const Engine& engine, const Mapping& mapping,
+                   const problem::Workload& workload, const std::string& config_text = "");
+
+  // Maps a file written by Save(). Returns false (and stays closed) if the
+  // file is missing, of a different version, or truncated or corrupt such
+  // that a section or name lies outside it.
+  bool Load(const std::string& path);
+  void Close();
+  bool IsLoaded() const { return base_ != nullptr; }
+
+  // Accessors. These index directly into the mapped file.
+  const BinaryStatsHeader& Header() const { return *At<BinaryStatsHeader>(0); }
+  const char* String(std::uint64_t offset) const { return At<char>(Header().strings_offset + offset); }
+  const char* DimensionName(unsigned dim) const;
+  const char* DataSpaceName(unsigned pv) const;
+  std::int64_t Bound(unsigned dim) const;
+
+  const StorageLevelRecord& StorageLevel(unsigned storage_level_id) const;
+  std::uint64_t StorageCount(unsigned storage_level_id, StorageCounter counter, unsigned pv) const;
+  double StorageValue(unsigned storage_level_id, StorageMetric metric, unsigned pv) const;
+
+  const ArithmeticRecord& Arithmetic() const { return *At<ArithmeticRecord>(Header().arithmetic_offset); }
+
+  const NetworkRecord& Network(unsigned network_id) const;
+  double NetworkEnergy(unsigned network_id, unsigned pv) const;
+
+  std::string Config() const;
+
+  // The energies the run applied. Returns false if the image is corrupt.
+  bool GetERT(CompiledERT& ert) const;
+
+  // Rebuilds the mapping. The problem shape must already be set up (e.g.,
+  // by parsing the problem section of Config()).
+  Mapping GetMapping() const;
+};
+
+} // namespace model
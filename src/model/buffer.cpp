@@ -51,12 +51,37 @@ BufferLevel::BufferLevel()
 { }
 
 BufferLevel::BufferLevel(const Specs& specs) :
+    BufferLevel(std::make_shared<Specs>(specs))
+{ }
+
+BufferLevel::BufferLevel(std::shared_ptr<const Specs> specs) :
     specs_(specs)
 {
+  // Address-generation bits are a constant of the level if its size is
+  // known, so derive them once here instead of on every evaluation.
+  addr_gen_bits_ = specs_->addr_gen_bits;
+  if (specs_->size.IsSpecified())
+  {
+    addr_gen_bits_ = AddrGenBits(specs_->size.Get());
+  }
+
   is_specced_ = true;
   is_evaluated_ = false;
 }
 
+#ifdef UPDATE_UNSPECIFIED_SPECS
+// Specs are shared between engines, so take a private copy before
+// back-annotating any unspecified attributes.
+BufferLevel::Specs& BufferLevel::MutableSpecs()
+{
+  if (specs_.use_count() > 1)
+  {
+    specs_ = std::make_shared<Specs>(*specs_);
+  }
+  return const_cast<Specs&>(*specs_);
+}
+#endif
+
 BufferLevel::~BufferLevel()
 { }
 
@@ -436,17 +461,17 @@ EvalStatus BufferLevel::PreEvaluationCheck(
   bool success = true;
   std::ostringstream fail_reason;
   
-  if (specs_.size.IsSpecified())
+  if (specs_->size.IsSpecified())
   {
     // Ugh. If we can do a distributed multicast from this level,
     // then the required size may be smaller. However, that depends
     // on the multicast factor etc. that we don't know at this point.
     // Use a very loose filter and fail this check only if there's
     // no chance that this mapping can fit.
-    auto available_capacity = specs_.effective_size.Get();
+    auto available_capacity = specs_->effective_size.Get();
     if (network_read_->DistributedMulticastSupported())
     {
-      available_capacity *= specs_.instances.Get();
+      available_capacity *= specs_->instances.Get();
     }
 
     // Find the total capacity required by all un-masked data types.
@@ -465,12 +490,12 @@ EvalStatus BufferLevel::PreEvaluationCheck(
       fail_reason << "mapped tile size " << required_capacity << " exceeds buffer capacity "
                   << available_capacity;
     }
-    else if (required_capacity < specs_.effective_size.Get()
-             * specs_.min_utilization.Get())
+    else if (required_capacity < specs_->effective_size.Get()
+             * specs_->min_utilization.Get())
     {
       success = false;
       fail_reason << "mapped tile size " << required_capacity << " is less than constrained "
-                  << "minimum utilization " << specs_.effective_size.Get() * specs_.min_utilization.Get();
+                  << "minimum utilization " << specs_->effective_size.Get() * specs_->min_utilization.Get();
     }
   }
 
@@ -503,8 +528,8 @@ EvalStatus BufferLevel::Evaluate(const tiling::CompoundTile& tile, const tiling:
 bool BufferLevel::HardwareReductionSupported()
 {
   // FIXME: take this information from an explicit arch spec.
-  return !(specs_.technology.IsSpecified() &&
-           specs_.technology.Get() == Technology::DRAM);
+  return !(specs_->technology.IsSpecified() &&
+           specs_->technology.Get() == Technology::DRAM);
 }
 
 void BufferLevel::ConnectRead(std::shared_ptr<Network> network)
@@ -589,64 +614,63 @@ EvalStatus BufferLevel::ComputeAccesses(const tiling::CompoundTile& tile,
   auto total_utilized_capacity = std::accumulate(stats_.utilized_capacity.begin(),
                                                  stats_.utilized_capacity.end(),
                                                  0ULL);
-  if (!specs_.size.IsSpecified())
+  if (!specs_->size.IsSpecified())
   {
 #ifdef UPDATE_UNSPECIFIED_SPECS
-    specs_.size = std::ceil(total_utilized_capacity * specs_.multiple_buffering.Get());
+    MutableSpecs().size = std::ceil(total_utilized_capacity * specs_->multiple_buffering.Get());
+    addr_gen_bits_ = AddrGenBits(specs_->size.Get());
 #endif
   }
-  else if (total_utilized_capacity > specs_.effective_size.Get())
+  else if (total_utilized_capacity > specs_->effective_size.Get())
   {
     success = false;
     fail_reason << "mapped tile size " << total_utilized_capacity << " exceeds buffer capacity "
-                << specs_.effective_size.Get();
+                << specs_->effective_size.Get();
   }
-  else if (total_utilized_capacity < specs_.effective_size.Get()
-           * specs_.min_utilization.Get())
+  else if (total_utilized_capacity < specs_->effective_size.Get()
+           * specs_->min_utilization.Get())
   {
     success = false;
     fail_reason << "mapped tile size " << total_utilized_capacity << " is less than constrained "
-                << "minimum utilization " << specs_.effective_size.Get() * specs_.min_utilization.Get();
+                << "minimum utilization " << specs_->effective_size.Get() * specs_->min_utilization.Get();
   }
 
-  assert (specs_.block_size.IsSpecified());
+  assert (specs_->block_size.IsSpecified());
     
-  assert (specs_.cluster_size.IsSpecified());
+  assert (specs_->cluster_size.IsSpecified());
    
-  // Compute address-generation bits.
-  if (specs_.size.IsSpecified())
+  // Compute address-generation bits. If the size is specified, this was
+  // already done once at construction time.
+  if (specs_->size.IsSpecified())
   {
-    double address_range = std::ceil(static_cast<double>(specs_.size.Get() / specs_.block_size.Get()));
-    specs_.addr_gen_bits = static_cast<unsigned long>(std::ceil(std::log2(address_range)));
+    assert(addr_gen_bits_.IsSpecified());
   }
-  else if (specs_.technology.Get() == Technology::SRAM)
+  else if (specs_->technology.Get() == Technology::SRAM)
   {
     // Use utilized capacity as proxy for size.
-    double address_range = std::ceil(static_cast<double>(total_utilized_capacity / specs_.block_size.Get()));
-    specs_.addr_gen_bits = static_cast<unsigned long>(std::ceil(std::log2(address_range)));
+    addr_gen_bits_ = AddrGenBits(total_utilized_capacity);
   }
   else // DRAM.
   {
 #ifdef FIXED_DRAM_SIZE_IF_UNSPECIFIED
     // DRAM of un-specified size, use 48-bit physical address.
-    specs_.addr_gen_bits = 48;
+    addr_gen_bits_ = 48;
 #else
     // Use utilized capacity as proxy for size.
-    double address_range = std::ceil(static_cast<double>(total_utilized_capacity / specs_.block_size.Get()));
-    specs_.addr_gen_bits = static_cast<unsigned long>(std::ceil(std::log2(address_range)));
+    addr_gen_bits_ = AddrGenBits(total_utilized_capacity);
 #endif
   }
-  if (!specs_.instances.IsSpecified())
+  if (!specs_->instances.IsSpecified())
   {
 #ifdef UPDATE_UNSPECIFIED_SPECS
-    specs_.instances = stats_.utilized_instances.Max();
+    MutableSpecs().instances = stats_.utilized_instances.Max();
 #endif
   }
-  else if (stats_.utilized_instances.Max() > specs_.instances.Get())
+  else if (stats_.utilized_instances.Max() > specs_->instances.Get())
   {
     success = false;
     fail_reason << "mapped instances " << stats_.utilized_instances.Max() << " exceeds available hardware instances "
-                << specs_.instances.Get();
+                << specs_->instances.Get();
   }
 
   // Bandwidth constraints cannot be checked/inherited at this point
@@ -655,14 +679,14 @@ EvalStatus BufferLevel::ComputeAccesses(const tiling::CompoundTile& tile,
 
   // Compute utilized clusters.
   // FIXME: should derive this from precise spatial mapping.
+  auto num_clusters = specs_->instances.Get() / specs_->cluster_size.Get();
   for (unsigned pvi = 0; pvi < unsigned(problem::GetShape()->NumDataSpaces); pvi++)
   {
     auto pv = problem::Shape::DataSpaceID(pvi);
     // The following equation assumes fully condensed mapping. Do a ceil-div.
     // stats_.utilized_clusters[pv] = 1 + (stats_.utilized_instances[pv] - 1) /
-    //    specs_.cluster_size.Get();
+    //    specs_->cluster_size.Get();
     // Assume utilized instances are sprinkled uniformly across all clusters.
-    auto num_clusters = specs_.instances.Get() / specs_.cluster_size.Get();
     stats_.utilized_clusters[pv] = std::min(stats_.utilized_instances[pv],
                                             num_clusters);
   }
@@ -676,37 +700,59 @@ EvalStatus BufferLevel::ComputeAccesses(const tiling::CompoundTile& tile,
   return eval_status;
 }
 
+// Number of bits needed to address a given capacity (in words).
+std::uint64_t BufferLevel::AddrGenBits(const std::uint64_t capacity) const
+{
+  double address_range = std::ceil(static_cast<double>(capacity / specs_->block_size.Get()));
+  return static_cast<unsigned long>(std::ceil(std::log2(address_range)));
+}
+
 // Compute buffer energy.
+//
+// The energy and performance kernels below run once per level per
+// evaluation. They read the per-data-space stats through raw pointers into
+// the (contiguous) PerDataSpace arrays, with the problem shape, the specs
+// and any PAT calls hoisted out of the data-space loops. Expressions and
+// summation orders are unchanged, so results are bit-identical.
 void BufferLevel::ComputeBufferEnergy()
 {
+  const unsigned num_data_spaces = unsigned(problem::GetShape()->NumDataSpaces);
+  const auto block_size = specs_->block_size.Get();
+  const double vector_access_energy = specs_->vector_access_energy.Get();
+
+  const unsigned long* reads = &stats_.reads[0];
+  const unsigned long* updates = &stats_.updates[0];
+  const unsigned long* fills = &stats_.fills[0];
+  const std::uint64_t* utilized_instances = &stats_.utilized_instances[0];
+  const std::uint64_t* utilized_clusters = &stats_.utilized_clusters[0];
+  double* energy = &stats_.energy[0];
+  double* energy_per_access = &stats_.energy_per_access[0];
+
   // NOTE! Stats are always maintained per-DataSpaceID
-  for (unsigned pvi = 0; pvi < unsigned(problem::GetShape()->NumDataSpaces); pvi++)
+  for (unsigned pv = 0; pv < num_data_spaces; pv++)
   {
-    auto pv = problem::Shape::DataSpaceID(pvi);
-    auto instance_accesses = stats_.reads.at(pv) + stats_.updates.at(pv) + stats_.fills.at(pv);
+    auto instance_accesses = reads[pv] + updates[pv] + fills[pv];
 
-    auto block_size = specs_.block_size.Get();
     double vector_accesses =
       (instance_accesses % block_size == 0) ?
       (instance_accesses / block_size)      :
       (instance_accesses / block_size) + 1;
     
-    double cluster_access_energy = vector_accesses *
-      specs_.vector_access_energy.Get();
+    double cluster_access_energy = vector_accesses * vector_access_energy;
 
     // Spread out the cost between the utilized instances in each cluster.
     // This is because all the later stat-processing is per-instance.
-    if (stats_.utilized_instances.at(pv) > 0)
+    if (utilized_instances[pv] > 0)
     {
-      double cluster_utilization = double(stats_.utilized_instances.at(pv)) /
-        double(stats_.utilized_clusters.at(pv));
-      stats_.energy[pv] = cluster_access_energy / cluster_utilization;
-      stats_.energy_per_access[pv] = stats_.energy.at(pv) / instance_accesses;
+      double cluster_utilization = double(utilized_instances[pv]) /
+        double(utilized_clusters[pv]);
+      energy[pv] = cluster_access_energy / cluster_utilization;
+      energy_per_access[pv] = energy[pv] / instance_accesses;
     }
     else
     {
-      stats_.energy[pv] = 0;
-      stats_.energy_per_access[pv] = 0;
+      energy[pv] = 0;
+      energy_per_access[pv] = 0;
     }
   }
 }
@@ -716,14 +762,23 @@ void BufferLevel::ComputeBufferEnergy()
 //
 void BufferLevel::ComputeReductionEnergy()
 {
+  auto shape = problem::GetShape();
+  const unsigned num_data_spaces = unsigned(shape->NumDataSpaces);
+
   // Temporal reduction: add a value coming in on the network to a value stored locally.
-  for (unsigned pvi = 0; pvi < unsigned(problem::GetShape()->NumDataSpaces); pvi++)
+  double adder_energy = 0;
+  bool adder_energy_known = false;
+  for (unsigned pvi = 0; pvi < num_data_spaces; pvi++)
   {
     auto pv = problem::Shape::DataSpaceID(pvi);
-    if (problem::GetShape()->IsReadWriteDataSpace.at(pv))
+    if (shape->IsReadWriteDataSpace.at(pv))
     {
-      stats_.temporal_reduction_energy[pv] = stats_.temporal_reductions[pv] * 
-        pat::AdderEnergy(specs_.word_bits.Get(), network_update_->WordBits());
+      if (!adder_energy_known)
+      {
+        adder_energy = pat::AdderEnergy(specs_->word_bits.Get(), network_update_->WordBits());
+        adder_energy_known = true;
+      }
+      stats_.temporal_reduction_energy[pv] = stats_.temporal_reductions[pv] * adder_energy;
     }
     else
     {
@@ -740,20 +795,21 @@ void BufferLevel::ComputeAddrGenEnergy()
   // Note! Address-generation is amortized across the cluster width.
   // We compute the per-cluster energy here. When we sum across instances,
   // we need to be careful to only count each cluster once.
-  for (unsigned pvi = 0; pvi < unsigned(problem::GetShape()->NumDataSpaces); pvi++)
+
+  // We'll use an addr-gen-bits + addr-gen-bits adder, though
+  // it's probably cheaper than that. However, we can't assume
+  // a 1-bit increment.
+  double energy_per_generation =
+    specs_->addr_gen_energy.Get() < 0.0 ?
+    pat::AdderEnergy(addr_gen_bits_.Get(), addr_gen_bits_.Get()) :
+    specs_->addr_gen_energy.Get();
+
+  const unsigned num_data_spaces = unsigned(problem::GetShape()->NumDataSpaces);
+  const unsigned long* address_generations = &stats_.address_generations[0];
+  double* addr_gen_energy = &stats_.addr_gen_energy[0];
+  for (unsigned pv = 0; pv < num_data_spaces; pv++)
   {
-    // We'll use an addr-gen-bits + addr-gen-bits adder, though
-    // it's probably cheaper than that. However, we can't assume
-    // a 1-bit increment.
-    auto pv = problem::Shape::DataSpaceID(pvi);
-    if (specs_.addr_gen_energy.Get() < 0.0) { 
-      stats_.addr_gen_energy[pv] = stats_.address_generations[pv] *
-        pat::AdderEnergy(specs_.addr_gen_bits.Get(), specs_.addr_gen_bits.Get());
-    }
-    else
-    {
-       stats_.addr_gen_energy[pv] = stats_.address_generations[pv] * specs_.addr_gen_energy.Get();
-    }
+    addr_gen_energy[pv] = address_generations[pv] * energy_per_generation;
   }
 }
 
@@ -762,18 +818,27 @@ void BufferLevel::ComputeAddrGenEnergy()
 //
 void BufferLevel::ComputePerformance(const std::uint64_t compute_cycles)
 {
+  const unsigned num_data_spaces = unsigned(problem::GetShape()->NumDataSpaces);
+  const unsigned long* reads = &stats_.reads[0];
+  const unsigned long* updates = &stats_.updates[0];
+  const unsigned long* fills = &stats_.fills[0];
+  double* read_bandwidth = &stats_.read_bandwidth[0];
+  double* write_bandwidth = &stats_.write_bandwidth[0];
+
   //
-  // Step 1: Compute unconstrained bandwidth demand.
+  // Step 1: Compute unconstrained bandwidth demand. The per-data-space
+  // demands are staged in the output arrays and scaled in Step 3.
   //
-  problem::PerDataSpace<double> unconstrained_read_bandwidth;
-  problem::PerDataSpace<double> unconstrained_write_bandwidth;
-  for (unsigned pvi = 0; pvi < unsigned(problem::GetShape()->NumDataSpaces); pvi++)
+  double total_unconstrained_read_bandwidth = 0.0;
+  double total_unconstrained_write_bandwidth = 0.0;
+  for (unsigned pv = 0; pv < num_data_spaces; pv++)
   {
-    auto pv = problem::Shape::DataSpaceID(pvi);
-    auto total_read_accesses    =   stats_.reads.at(pv);
-    auto total_write_accesses   =   stats_.updates.at(pv) + stats_.fills.at(pv);
-    unconstrained_read_bandwidth[pv]  = (double(total_read_accesses)  / compute_cycles);
-    unconstrained_write_bandwidth[pv] = (double(total_write_accesses) / compute_cycles);
+    auto total_read_accesses    =   reads[pv];
+    auto total_write_accesses   =   updates[pv] + fills[pv];
+    read_bandwidth[pv]  = (double(total_read_accesses)  / compute_cycles);
+    write_bandwidth[pv] = (double(total_write_accesses) / compute_cycles);
+    total_unconstrained_read_bandwidth += read_bandwidth[pv];
+    total_unconstrained_write_bandwidth += write_bandwidth[pv];
   }
 
   //
@@ -781,23 +846,19 @@ void BufferLevel::ComputePerformance(const std::uint64_t compute_cycles)
   //
   stats_.slowdown = 1.0;
 
-  // Find slowdown.
-  auto total_unconstrained_read_bandwidth  = std::accumulate(unconstrained_read_bandwidth.begin(),  unconstrained_read_bandwidth.end(),  0.0);
-  auto total_unconstrained_write_bandwidth = std::accumulate(unconstrained_write_bandwidth.begin(), unconstrained_write_bandwidth.end(), 0.0);
-
-  if (specs_.read_bandwidth.IsSpecified() &&
-      specs_.read_bandwidth.Get() < total_unconstrained_read_bandwidth)
+  if (specs_->read_bandwidth.IsSpecified() &&
+      specs_->read_bandwidth.Get() < total_unconstrained_read_bandwidth)
   {
     stats_.slowdown =
       std::min(stats_.slowdown,
-               specs_.read_bandwidth.Get() / total_unconstrained_read_bandwidth);
+               specs_->read_bandwidth.Get() / total_unconstrained_read_bandwidth);
   }
-  if (specs_.write_bandwidth.IsSpecified() &&
-      specs_.write_bandwidth.Get() < total_unconstrained_write_bandwidth)
+  if (specs_->write_bandwidth.IsSpecified() &&
+      specs_->write_bandwidth.Get() < total_unconstrained_write_bandwidth)
   {
     stats_.slowdown =
       std::min(stats_.slowdown,
-               specs_.write_bandwidth.Get() / total_unconstrained_write_bandwidth);
+               specs_->write_bandwidth.Get() / total_unconstrained_write_bandwidth);
   }
 
   //
@@ -806,11 +867,11 @@ void BufferLevel::ComputePerformance(const std::uint64_t compute_cycles)
   // ends up effectively slowing down each datatype's bandwidth by the slowdown
   // amount, which is slightly weird but appears to be harmless.
   //
-  for (unsigned pvi = 0; pvi < unsigned(problem::GetShape()->NumDataSpaces); pvi++)
+  const double slowdown = stats_.slowdown;
+  for (unsigned pv = 0; pv < num_data_spaces; pv++)
   {
-    auto pv = problem::Shape::DataSpaceID(pvi);
-    stats_.read_bandwidth[pv]  = stats_.slowdown * unconstrained_read_bandwidth.at(pv);
-    stats_.write_bandwidth[pv] = stats_.slowdown * unconstrained_write_bandwidth.at(pv);
+    read_bandwidth[pv]  = slowdown * read_bandwidth[pv];
+    write_bandwidth[pv] = slowdown * write_bandwidth[pv];
   }
 
   //
@@ -822,10 +883,10 @@ void BufferLevel::ComputePerformance(const std::uint64_t compute_cycles)
   // Step 5: Update arch specs.
   //
 #ifdef UPDATE_UNSPECIFIED_SPECS
-  if (!specs_.read_bandwidth.IsSpecified())
-    specs_.read_bandwidth = std::accumulate(stats_.read_bandwidth.begin(), stats_.read_bandwidth.end(), 0.0);
-  if (!specs_.write_bandwidth.IsSpecified())
-    specs_.write_bandwidth = std::accumulate(stats_.write_bandwidth.begin(), stats_.write_bandwidth.end(), 0.0);
+  if (!specs_->read_bandwidth.IsSpecified())
+    MutableSpecs().read_bandwidth = std::accumulate(stats_.read_bandwidth.begin(), stats_.read_bandwidth.end(), 0.0);
+  if (!specs_->write_bandwidth.IsSpecified())
+    MutableSpecs().write_bandwidth = std::accumulate(stats_.write_bandwidth.begin(), stats_.write_bandwidth.end(), 0.0);
 #endif
 }
 
@@ -836,31 +897,77 @@ void BufferLevel::ComputePerformance(const std::uint64_t compute_cycles)
 STAT_ACCESSOR(double, BufferLevel, StorageEnergy, stats_.energy.at(pv) * stats_.utilized_instances.at(pv))
 STAT_ACCESSOR(double, BufferLevel, TemporalReductionEnergy, stats_.temporal_reduction_energy.at(pv) * stats_.utilized_instances.at(pv))
 STAT_ACCESSOR(double, BufferLevel, AddrGenEnergy, stats_.addr_gen_energy.at(pv) * stats_.utilized_clusters.at(pv)) // Note!!! clusters, not instances.
-STAT_ACCESSOR(double, BufferLevel, Energy,
-              StorageEnergy(pv) +
-              TemporalReductionEnergy(pv) +
-              AddrGenEnergy(pv))
+
+// Energy() is summed over all data spaces (and levels) on every evaluation,
+// so the all-data-space case is a single pass over the stats arrays rather
+// than three virtual-free but bounds-checked accessor calls per data space.
+double BufferLevel::Energy(problem::Shape::DataSpaceID pv) const
+{
+  const unsigned num_data_spaces = unsigned(problem::GetShape()->NumDataSpaces);
+  if (pv != num_data_spaces)
+  {
+    return StorageEnergy(pv) + TemporalReductionEnergy(pv) + AddrGenEnergy(pv);
+  }
+
+  const double* energy = &stats_.energy[0];
+  const double* temporal_reduction_energy = &stats_.temporal_reduction_energy[0];
+  const double* addr_gen_energy = &stats_.addr_gen_energy[0];
+  const std::uint64_t* utilized_instances = &stats_.utilized_instances[0];
+  const std::uint64_t* utilized_clusters = &stats_.utilized_clusters[0];
+
+  double total = 0;
+  for (unsigned pvi = 0; pvi < num_data_spaces; pvi++)
+  {
+    total += energy[pvi] * utilized_instances[pvi] +
+      temporal_reduction_energy[pvi] * utilized_instances[pvi] +
+      addr_gen_energy[pvi] * utilized_clusters[pvi]; // Note!!! clusters, not instances.
+  }
+  return total;
+}
 
 STAT_ACCESSOR(std::uint64_t, BufferLevel, Accesses, stats_.utilized_instances.at(pv) * (stats_.reads.at(pv) + stats_.updates.at(pv) + stats_.fills.at(pv)))
 STAT_ACCESSOR(std::uint64_t, BufferLevel, UtilizedCapacity, stats_.utilized_capacity.at(pv))
 STAT_ACCESSOR(std::uint64_t, BufferLevel, UtilizedInstances, stats_.utilized_instances.at(pv))
 
+double BufferLevel::ActionCount() const
+{
+  // Mirrors ComputeBufferEnergy(): the per-instance share of a cluster's
+  // access energy, multiplied back out by the utilized instances.
+  double actions = 0;
+  for (unsigned pvi = 0; pvi < unsigned(problem::GetShape()->NumDataSpaces); pvi++)
+  {
+    auto pv = problem::Shape::DataSpaceID(pvi);
+    if (stats_.utilized_instances.at(pv) == 0)
+      continue;
+
+    auto instance_accesses = stats_.reads.at(pv) + stats_.updates.at(pv) + stats_.fills.at(pv);
+    auto block_size = specs_->block_size.Get();
+    double vector_accesses =
+      (instance_accesses % block_size == 0) ?
+      (instance_accesses / block_size)      :
+      (instance_accesses / block_size) + 1;
+
+    actions += vector_accesses * stats_.utilized_clusters.at(pv);
+  }
+  return actions;
+}
+
 std::string BufferLevel::Name() const
 {
-  return specs_.name.Get();
+  return specs_->name.Get();
 }
 
 double BufferLevel::Area() const
 {
   double area = 0;
-  area += specs_.storage_area.Get() * specs_.instances.Get();
+  area += specs_->storage_area.Get() * specs_->instances.Get();
   return area;
 }
 
 double BufferLevel::AreaPerInstance() const
 {
   double area = 0;
-  area += specs_.storage_area.Get();
+  area += specs_->storage_area.Get();
   return area;
 }
 
@@ -869,7 +976,7 @@ double BufferLevel::Size() const
   // FIXME: this is per-instance. This is inconsistent with the naming
   // convention of some of the other methods, which are summed across instances.
   double size = 0;
-  size += specs_.size.Get();
+  size += specs_->size.Get();
   return size;
 }
 
@@ -883,7 +990,7 @@ double BufferLevel::CapacityUtilization() const
       stats_.utilized_instances.at(pv);
   }
 
-  double total_capacity = Size() * specs_.instances.Get();
+  double total_capacity = Size() * specs_->instances.Get();
 
   return utilized_capacity / total_capacity;
 }
@@ -917,7 +1024,7 @@ void BufferLevel::Print(std::ostream& out) const
 {
   std::string indent = "    ";
 
-  auto& specs = specs_;
+  auto& specs = *specs_;
   auto& stats = stats_;
 
   // Print level name.
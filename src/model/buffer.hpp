@@ -29,6 +29,7 @@
 
 #include <iostream>
 #include <boost/serialization/export.hpp>
+#include <boost/serialization/split_member.hpp>
 
 #include "model/model-base.hpp"
 #include "model/level.hpp"
@@ -45,7 +46,7 @@ namespace model
 //                 BufferLevel                //
 //--------------------------------------------//
 
-class BufferLevel : public Level
+class BufferLevel final : public Level
 {
 
   //
@@ -199,7 +200,12 @@ class BufferLevel : public Level
 
   std::vector<loop::Descriptor> subnest_;
   Stats stats_;
-  Specs specs_;
+
+  // Specs are immutable and shared with the Topology::Specs this level was
+  // created from (and with every other engine created from it). The only
+  // spec attribute that evaluation derives is kept per-level below.
+  std::shared_ptr<const Specs> specs_;
+  Attribute<std::uint64_t> addr_gen_bits_;
 
   // Network endpoints.
   std::shared_ptr<Network> network_read_;
@@ -210,17 +216,38 @@ class BufferLevel : public Level
   // Serialization
   friend class boost::serialization::access;
   template <class Archive>
-  void serialize(Archive& ar, const unsigned int version = 0)
+  void save(Archive& ar, const unsigned int version) const
   {
     ar& BOOST_SERIALIZATION_BASE_OBJECT_NVP(Level);
     if (version == 0)
     {
+      // Specs are serialized by value, including derived attributes.
+      Specs specs = *specs_;
+      specs.addr_gen_bits = addr_gen_bits_;
+      const Specs& specs_ref = specs;
       ar& BOOST_SERIALIZATION_NVP(subnest_);
-      ar& BOOST_SERIALIZATION_NVP(specs_);
+      ar& boost::serialization::make_nvp("specs_", specs_ref);
       ar& BOOST_SERIALIZATION_NVP(stats_);
     }
   }
 
+  template <class Archive>
+  void load(Archive& ar, const unsigned int version)
+  {
+    ar& BOOST_SERIALIZATION_BASE_OBJECT_NVP(Level);
+    if (version == 0)
+    {
+      Specs specs;
+      ar& BOOST_SERIALIZATION_NVP(subnest_);
+      ar& boost::serialization::make_nvp("specs_", specs);
+      ar& BOOST_SERIALIZATION_NVP(stats_);
+      addr_gen_bits_ = specs.addr_gen_bits;
+      specs_ = std::make_shared<const Specs>(specs);
+    }
+  }
+
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
+
   //
   // Private helpers.
   //
@@ -232,6 +259,10 @@ class BufferLevel : public Level
   void ComputeBufferEnergy();
   void ComputeReductionEnergy();
   void ComputeAddrGenEnergy();
+  std::uint64_t AddrGenBits(const std::uint64_t capacity) const;
+#ifdef UPDATE_UNSPECIFIED_SPECS
+  Specs& MutableSpecs();
+#endif
 
   double StorageEnergy(problem::Shape::DataSpaceID pv = problem::GetShape()->NumDataSpaces) const;
   double TemporalReductionEnergy(problem::Shape::DataSpaceID pv = problem::GetShape()->NumDataSpaces) const;
@@ -244,6 +275,7 @@ class BufferLevel : public Level
  public:
   BufferLevel();
   BufferLevel(const Specs & specs);
+  BufferLevel(std::shared_ptr<const Specs> specs);
   ~BufferLevel();
 
   std::shared_ptr<Level> Clone() const override
@@ -259,7 +291,8 @@ class BufferLevel : public Level
                                problem::Shape::DataSpaceID pv, Specs& specs);
   static void ValidateTopology(BufferLevel::Specs& specs);
 
-  Specs& GetSpecs() { return specs_; }
+  const Specs& GetSpecs() const { return *specs_; }
+  const Stats& GetStats() const { return stats_; }
   
   bool HardwareReductionSupported() override;
 
@@ -268,6 +301,10 @@ class BufferLevel : public Level
   void ConnectFill(std::shared_ptr<Network> network);
   void ConnectUpdate(std::shared_ptr<Network> network);
   void ConnectDrain(std::shared_ptr<Network> network);
+  // Number of vector accesses that StorageEnergy() charges
+  // vector_access_energy for, summed over all data-spaces and instances.
+  double ActionCount() const;
+
   std::shared_ptr<Network> GetReadNetwork() { return network_read_; }
   std::shared_ptr<Network> GetUpdateNetwork() { return network_update_; }
  
@@ -37,6 +37,7 @@
 #include "mapping/mapping.hpp"
 #include "loop-analysis/nest-analysis.hpp"
 #include "compound-config/compound-config.hpp"
+#include "util/alloc-tracker.hpp"
 
 namespace model
 {
@@ -48,6 +49,59 @@ class Engine : public Module
   {
     Topology::Specs topology;
   };
+
+  // Columnar (structure-of-arrays) stats of a batch of evaluations, laid out
+  // for bulk comparison and export rather than per-mapping object access.
+  // Scalar columns are indexed by mapping; per-level columns are level-major,
+  // i.e., the value for level l and mapping m is at [l * size + m]. Columns
+  // of failed mappings are zero. eval_status holds each mapping's per-level
+  // status, from the pre-evaluation check if that failed.
+  struct BatchStats
+  {
+    std::size_t size = 0;
+    unsigned num_levels = 0;
+
+    std::vector<std::uint8_t> success;
+    std::vector<std::vector<EvalStatus>> eval_status;
+    std::vector<double> energy;
+    std::vector<double> area;
+    std::vector<std::uint64_t> cycles;
+    std::vector<double> utilization;
+    std::vector<std::uint64_t> maccs;
+    std::vector<std::uint64_t> last_level_accesses;
+
+    std::vector<double> level_energy;
+    std::vector<std::uint64_t> level_accesses;
+
+    // Resizes and zeroes all columns, re-using their storage.
+    void Reset(std::size_t batch_size, unsigned levels)
+    {
+      size = batch_size;
+      num_levels = levels;
+      success.assign(size, 0);
+      eval_status.resize(size);
+      energy.assign(size, 0);
+      area.assign(size, 0);
+      cycles.assign(size, 0);
+      utilization.assign(size, 0);
+      maccs.assign(size, 0);
+      last_level_accesses.assign(size, 0);
+      level_energy.assign(size * num_levels, 0);
+      level_accesses.assign(size * num_levels, 0);
+    }
+
+    double LevelEnergy(unsigned level_id, std::size_t i) const { return level_energy[level_id * size + i]; }
+    std::uint64_t LevelAccesses(unsigned level_id, std::size_t i) const { return level_accesses[level_id * size + i]; }
+  };
+
+  // Outcome of evaluating a mapping on one architecture variant.
+  struct VariantResult
+  {
+    bool success;
+    std::string fail_reason; // Set when the variant could not be evaluated at all.
+    std::vector<EvalStatus> eval_status;
+    Topology::Stats stats;
+  };
   
  private:
   // Specs.
@@ -58,6 +112,10 @@ class Engine : public Module
 
   // Utilities.
   analysis::NestAnalysis nest_analysis_;
+
+  // Heap allocations made by the last Evaluate() call (see
+  // util/alloc-tracker.hpp).
+  alloc::Counts last_evaluate_allocations_;
   
   // Serialization.
   friend class boost::serialization::access;
@@ -102,6 +160,7 @@ class Engine : public Module
     is_specced_ = true;
   }
 
+  const Specs& GetSpecs() const { return specs_; }
   const Topology& GetTopology() const { return topology_; }
 
   std::vector<EvalStatus> PreEvaluationCheck(const Mapping& mapping, problem::Workload& workload, bool break_on_failure = true)
@@ -112,6 +171,10 @@ class Engine : public Module
 
   std::vector<EvalStatus> Evaluate(Mapping& mapping, problem::Workload& workload, bool break_on_failure = true)
   {
+    alloc::Counts alloc_start;
+    if (alloc::kEnabled)
+      alloc_start = alloc::ThreadCounts();
+
     nest_analysis_.Init(&workload, &mapping.loop_nest);
     
     auto eval_status = topology_.Evaluate(mapping, &nest_analysis_, workload, break_on_failure);
@@ -120,9 +183,134 @@ class Engine : public Module
                                     [](bool cur, const EvalStatus& status)
                                     { return cur && status.success; });
 
+    if (alloc::kEnabled)
+      last_evaluate_allocations_ = alloc::ThreadCounts() - alloc_start;
+
     return eval_status;
   }
+
+  // Heap allocations made by the last Evaluate() call on this thread,
+  // including those of the returned status vector. Always zero in builds
+  // without allocation tracking.
+  const alloc::Counts& LastEvaluateAllocations() const
+  {
+    return last_evaluate_allocations_;
+  }
   
+  // Evaluate a batch of mappings on this engine, filling columnar stats. Each
+  // mapping goes through PreEvaluationCheck() first and is only evaluated if
+  // that passes. The engine's topology and nest analysis (and their scratch
+  // state) are re-used across the batch, and each evaluation's stats are
+  // scattered into the columns directly instead of being copied out as a
+  // Topology::Stats. On return, the engine holds the state of the last
+  // mapping it evaluated.
+  void EvaluateBatch(const std::vector<Mapping>& mappings, problem::Workload& workload,
+                     BatchStats& batch_stats, bool break_on_failure = true)
+  {
+    assert(is_specced_);
+
+    unsigned num_levels = specs_.topology.NumLevels();
+    batch_stats.Reset(mappings.size(), num_levels);
+
+    for (std::size_t i = 0; i < mappings.size(); i++)
+    {
+      auto& mapping = mappings[i];
+      auto& eval_status = batch_stats.eval_status[i];
+      auto succeeded = [&eval_status]()
+        {
+          return std::accumulate(eval_status.begin(), eval_status.end(), true,
+                                 [](bool cur, const EvalStatus& status)
+                                 { return cur && status.success; });
+        };
+
+      nest_analysis_.Init(&workload, &mapping.loop_nest);
+      eval_status = topology_.PreEvaluationCheck(mapping, &nest_analysis_, break_on_failure);
+      if (!succeeded())
+        continue;
+
+      auto tiled_mapping = topology_.TileMapping(mapping, &nest_analysis_);
+      eval_status = topology_.Evaluate(tiled_mapping, &nest_analysis_, workload, break_on_failure);
+      is_evaluated_ = succeeded();
+      if (!is_evaluated_)
+        continue;
+
+      auto& stats = topology_.GetStats();
+      batch_stats.success[i] = 1;
+      batch_stats.energy[i] = stats.energy;
+      batch_stats.area[i] = stats.area;
+      batch_stats.cycles[i] = stats.cycles;
+      batch_stats.utilization[i] = stats.utilization;
+      batch_stats.maccs[i] = stats.maccs;
+      batch_stats.last_level_accesses[i] = stats.last_level_accesses;
+      for (unsigned level_id = 0; level_id < num_levels; level_id++)
+      {
+        batch_stats.level_energy[level_id * mappings.size() + i] = topology_.LevelEnergy(level_id);
+        batch_stats.level_accesses[level_id * mappings.size() + i] = topology_.LevelAccesses(level_id);
+      }
+    }
+  }
+
+  // Evaluate one mapping on a batch of architecture variants. The nest
+  // analysis and the tiling of the mapping onto the storage hierarchy do not
+  // depend on the variants' sizes, bandwidths or energies, so they are
+  // computed once and re-used for every variant with the same structure.
+  // Each variant is evaluated on a scratch topology; this engine's own
+  // topology is left untouched. A variant whose storage hierarchy the
+  // mapping does not tile onto fails with a fail_reason.
+  std::vector<VariantResult> EvaluateVariants(const std::vector<Specs>& variants,
+                                              Mapping& mapping, problem::Workload& workload,
+                                              bool break_on_failure = true)
+  {
+    nest_analysis_.Init(&workload, &mapping.loop_nest);
+
+    std::vector<VariantResult> results;
+    results.reserve(variants.size());
+
+    bool tiled = false;
+    Topology::TiledMapping tiled_mapping;
+    for (auto& variant : variants)
+    {
+      VariantResult result = {};
+
+      auto num_storage_levels = variant.topology.NumStorageLevels();
+      if (num_storage_levels != mapping.loop_nest.storage_tiling_boundaries.size())
+      {
+        result.success = false;
+        result.fail_reason = "mapping has " + std::to_string(mapping.loop_nest.storage_tiling_boundaries.size()) +
+          " storage levels, architecture has " + std::to_string(num_storage_levels);
+        results.push_back(result);
+        continue;
+      }
+
+      Topology topology;
+      topology.Spec(variant.topology);
+
+      if (!tiled || !topology.IsCompatible(tiled_mapping))
+      {
+        tiled_mapping = topology.TileMapping(mapping, &nest_analysis_);
+        tiled = true;
+      }
+
+      if (!tiled_mapping.success)
+      {
+        result.success = false;
+        result.fail_reason = "mapping could not be tiled onto the architecture";
+        results.push_back(result);
+        continue;
+      }
+
+      result.eval_status = topology.Evaluate(tiled_mapping, &nest_analysis_, workload, break_on_failure);
+      result.success = std::accumulate(result.eval_status.begin(), result.eval_status.end(), true,
+                                       [](bool cur, const EvalStatus& status)
+                                       { return cur && status.success; });
+      if (result.success)
+        result.stats = topology.GetStats();
+      results.push_back(result);
+    }
+
+    return results;
+  }
+
   double Energy() const
   {
     return topology_.Energy();
@@ -0,0 +1,121 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <fstream>
+#include <cstring>
+
+#include "model/ert.hpp"
+#include "util/cache-file.hpp"
+
+namespace model
+{
+
+// Binary layout (see util/cache-file.hpp):
+//   magic[8] version:u32
+//   num_levels:u32 { specified:u8 energy:f64 }*
+//   wire_specified:u8 wire_energy:f64
+//   num_networks:u32 { length:u32 yaml:char[length] }*
+static const char kERTMagic[8] = { 'T', 'L', 'E', 'R', 'T', 'B', 'I', 'N' };
+static const std::uint32_t kERTVersion = 1;
+
+bool CompiledERT::Save(const std::string& path) const
+{
+  return cache::SaveAtomically(path, [this](std::ostream& out) { Write(out); });
+}
+
+bool CompiledERT::Load(const std::string& path)
+{
+  std::ifstream in(path, std::ios::binary);
+  return in && Read(in);
+}
+
+void CompiledERT::Write(std::ostream& out) const
+{
+  out.write(kERTMagic, sizeof(kERTMagic));
+  cache::Write(out, kERTVersion);
+
+  cache::Write(out, std::uint32_t(level_energy.size()));
+  for (unsigned i = 0; i < level_energy.size(); i++)
+  {
+    cache::Write(out, level_specified.at(i));
+    cache::Write(out, level_energy.at(i));
+  }
+
+  cache::Write(out, std::uint8_t(wire_specified));
+  cache::Write(out, wire_energy);
+
+  cache::Write(out, std::uint32_t(network_ert.size()));
+  for (auto& table : network_ert)
+    cache::Write(out, table);
+}
+
+bool CompiledERT::Read(std::istream& in)
+{
+  char magic[sizeof(kERTMagic)];
+  std::uint32_t version;
+  in.read(magic, sizeof(magic));
+  if (!in || std::memcmp(magic, kERTMagic, sizeof(kERTMagic)) != 0 ||
+      !cache::Read(in, version) || version != kERTVersion)
+    return false;
+
+  std::uint32_t num_levels;
+  if (!cache::Read(in, num_levels))
+    return false;
+  level_specified.clear();
+  level_energy.clear();
+  for (unsigned i = 0; i < num_levels; i++)
+  {
+    std::uint8_t specified;
+    double energy;
+    if (!cache::Read(in, specified) || !cache::Read(in, energy))
+      return false;
+    level_specified.push_back(specified);
+    level_energy.push_back(energy);
+  }
+
+  std::uint8_t wire;
+  if (!cache::Read(in, wire) || !cache::Read(in, wire_energy))
+    return false;
+  wire_specified = wire;
+
+  std::uint32_t num_networks;
+  if (!cache::Read(in, num_networks))
+    return false;
+  network_ert.clear();
+  for (unsigned i = 0; i < num_networks; i++)
+  {
+    std::string table;
+    if (!cache::Read(in, table))
+      return false;
+    network_ert.push_back(table);
+  }
+
+  return true;
+}
+
+} // namespace model
@@ -0,0 +1,72 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace model
+{
+
+//--------------------------------------------//
+//              Compiled Accelergy ERT        //
+//--------------------------------------------//
+
+// An Accelergy energy reference table, compiled against a specific
+// architecture: every ERT entry has been resolved to the level or network it
+// updates, and the unit energy of each level has been extracted. Applying a
+// compiled ERT to the architecture's specs is therefore a flat,
+// index-addressed update with no YAML traversal or string matching, and the
+// table can be saved to and loaded from a compact binary file.
+struct CompiledERT
+{
+  // Per-level unit energy (per-vector-access for storage levels, per-op for
+  // the arithmetic level), indexed by level id.
+  std::vector<std::uint8_t> level_specified;
+  std::vector<double> level_energy;
+
+  // Wire transfer energy.
+  bool wire_specified = false;
+  double wire_energy = 0;
+
+  // Raw action tables (YAML text) of SimpleMulticast networks, indexed by
+  // user-defined network id. Empty if the ERT does not describe a network.
+  std::vector<std::string> network_ert;
+
+  bool Save(const std::string& path) const;
+  bool Load(const std::string& path);
+
+  // The same binary image, on a stream (e.g., embedded in another file).
+  void Write(std::ostream& out) const;
+  bool Read(std::istream& in);
+};
+
+} // namespace model
@@ -84,25 +84,25 @@ class NetworkFactory
   }
 
   // Instantiate a network object based on a given spec.
-  static std::shared_ptr<Network> Construct(std::shared_ptr<NetworkSpecs> specs)
+  static std::shared_ptr<Network> Construct(std::shared_ptr<const NetworkSpecs> specs)
   {
     std::shared_ptr<Network> network;
 
     if (specs->Type() == "Legacy")
     {
-      auto legacy_specs = *std::static_pointer_cast<LegacyNetwork::Specs>(specs);
+      auto legacy_specs = *std::static_pointer_cast<const LegacyNetwork::Specs>(specs);
       auto legacy_network = std::make_shared<LegacyNetwork>(legacy_specs);
       network = std::static_pointer_cast<Network>(legacy_network);
     }
     else if (specs->Type() == "ReductionTree")
     {
-      auto reduction_tree_specs = *std::static_pointer_cast<ReductionTreeNetwork::Specs>(specs);
+      auto reduction_tree_specs = *std::static_pointer_cast<const ReductionTreeNetwork::Specs>(specs);
       auto reduction_tree_network = std::make_shared<ReductionTreeNetwork>(reduction_tree_specs);
       network = std::static_pointer_cast<Network>(reduction_tree_network);
     }
     else if (specs->Type() == "SimpleMulticast")
     {
-      auto simple_multicast_specs = *std::static_pointer_cast<SimpleMulticastNetwork::Specs>(specs);
+      auto simple_multicast_specs = *std::static_pointer_cast<const SimpleMulticastNetwork::Specs>(specs);
       auto simple_multicast_network = std::make_shared<SimpleMulticastNetwork>(simple_multicast_specs);
       network = std::static_pointer_cast<Network>(simple_multicast_network);
     }
@@ -35,6 +35,7 @@
 #include <boost/archive/xml_oarchive.hpp>
 
 #include "model/network-legacy.hpp"
+#include "util/trace.hpp"
 BOOST_CLASS_EXPORT(model::LegacyNetwork)
 
 namespace model
@@ -155,6 +156,12 @@ void LegacyNetwork::ResetConnectionType()
   specs_.cType = Unused;
 }
 
+void LegacyNetwork::Reset()
+{
+  stats_ = Stats();
+  is_evaluated_ = false;
+}
+
 bool LegacyNetwork::DistributedMulticastSupported() const
 {
   bool retval = true;
@@ -175,6 +182,7 @@ void LegacyNetwork::SetTileWidth(double width_um)
 EvalStatus LegacyNetwork::Evaluate(const tiling::CompoundTile& tile,
                                  const bool break_on_failure)
 {
+  TRACE_SCOPE("network/legacy");
 
   auto eval_status = ComputeAccesses(tile, break_on_failure);
   if (!break_on_failure || eval_status.success)
@@ -404,6 +412,7 @@ void LegacyNetwork::ComputeNetworkEnergy()
     }
 
     stats_.energy_per_hop[pv] = energy_per_hop;
+    stats_.wire_hops[pv] = total_wire_hops;
     stats_.num_hops[pv] = total_ingresses > 0 ? total_wire_hops / total_ingresses : 0;
     stats_.energy[pv] =
       total_wire_hops * energy_per_hop + // wire energy
@@ -574,6 +583,27 @@ double LegacyNetwork::NumHops(std::uint32_t multicast_factor, std::uint32_t fano
 // Accessors.
 //
 
+bool LegacyNetwork::LinearWireEnergy(const Specs& specs)
+{
+  return !specs.energy_per_hop.IsSpecified() &&
+    specs.wire_energy.IsSpecified() && specs.wire_energy.Get() != 0.0;
+}
+
+double LegacyNetwork::WireActionCount() const
+{
+  // Mirrors ComputeNetworkEnergy(): every wire hop and every link transfer
+  // costs one energy_per_hop, i.e., word_bits * hop distance in mm * wire_energy.
+  double bit_mm_per_hop = specs_.word_bits.Get() * specs_.tile_width.Get() / 1000;
+  double actions = 0;
+  for (unsigned pvi = 0; pvi < unsigned(problem::GetShape()->NumDataSpaces); pvi++)
+  {
+    auto pv = problem::Shape::DataSpaceID(pvi);
+    actions += (stats_.wire_hops.at(pv) + stats_.link_transfers.at(pv)) * bit_mm_per_hop *
+      stats_.utilized_instances.at(pv);
+  }
+  return actions;
+}
+
 STAT_ACCESSOR(double, LegacyNetwork, NetworkEnergy,
               (stats_.link_transfer_energy.at(pv) + stats_.energy.at(pv)) * stats_.utilized_instances.at(pv))
 STAT_ACCESSOR(double, LegacyNetwork, SpatialReductionEnergy,
@@ -101,6 +101,7 @@ class LegacyNetwork : public Network
     problem::PerDataSpace<unsigned long> spatial_reductions;
     problem::PerDataSpace<double> link_transfer_energy;
     problem::PerDataSpace<double> num_hops;
+    problem::PerDataSpace<double> wire_hops;
     problem::PerDataSpace<std::vector<double>> avg_hops;
     problem::PerDataSpace<double> energy_per_hop;
     problem::PerDataSpace<double> energy;
@@ -182,6 +183,7 @@ class LegacyNetwork : public Network
   std::string Name() const;
   void AddConnectionType(ConnectionType ct);
   void ResetConnectionType();
+  void Reset();
 
   bool DistributedMulticastSupported() const;
 
@@ -204,6 +206,14 @@ class LegacyNetwork : public Network
   static double WireEnergyPerHop(std::uint64_t word_bits, const double hop_distance, double wire_energy_override);
   static double NumHops(std::uint32_t multicast_factor, std::uint32_t fanout);
 
+  // Whether the wire energy of a network with these specs is priced by the
+  // linear wire model, i.e., proportional to specs.wire_energy.
+  static bool LinearWireEnergy(const Specs& specs);
+
+  // Bit-mm moved over wires by the last evaluation: the energy the linear
+  // wire model charges per unit of wire_energy.
+  double WireActionCount() const;
+
   STAT_ACCESSOR_HEADER(double, NetworkEnergy);
   STAT_ACCESSOR_HEADER(double, SpatialReductionEnergy);
   STAT_ACCESSOR_HEADER(double, Energy);
@@ -0,0 +1,267 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace model
+{
+
+//
+// Network evaluation memo.
+//
+// A network's stats are a function of its specs and of the data-movement
+// fields of the tile it is evaluated on, and these repeat across the mappings
+// a mapper thread evaluates. SimpleMulticast networks, whose evaluation looks
+// up an ERT energy for every multicast factor, keep an LRU of recent stats
+// keyed by a compact byte signature of those inputs, which Evaluate() builds
+// and looks up before running the model. The other networks are cheaper to
+// evaluate than to look up and do not memoize. The signature is hashed as it
+// is built and entries are indexed by the hash, with the full signature
+// compared on a match.
+//
+// Entries are the network's Entry type, which saves and restores its stats.
+// The per-data-space vectors of stats (one element per multicast factor)
+// are mostly zeros and can be as long as the fanout, so entries keep them as
+// SparseVectors: a hit then reads a small entry and writes into the vectors
+// the network already has, instead of copying them whole.
+//
+// Copies of a network start with an empty memo. The number of entries per
+// network is read from $TIMELOOP_NETWORK_MEMO (0 disables the memo).
+//
+
+struct NetworkMemoCounters
+{
+  std::uint64_t hits = 0;
+  std::uint64_t misses = 0;
+
+  NetworkMemoCounters& operator+=(const NetworkMemoCounters& other)
+  {
+    hits += other.hits;
+    misses += other.misses;
+    return *this;
+  }
+
+  double HitRate() const
+  {
+    auto lookups = hits + misses;
+    return lookups > 0 ? double(hits) / lookups : 0;
+  }
+};
+
+// Per-data-space vectors, stored as their sizes and non-zero elements.
+template<class T>
+class SparseVectors
+{
+ private:
+  std::vector<std::size_t> sizes_;
+  std::vector<std::size_t> counts_; // non-zero elements of each vector.
+  std::vector<std::pair<std::size_t, T>> elements_;
+
+ public:
+  template<class PerDataSpaceVectors>
+  void Save(const PerDataSpaceVectors& vectors)
+  {
+    sizes_.clear();
+    counts_.clear();
+    elements_.clear();
+    for (auto& vector : vectors)
+    {
+      sizes_.push_back(vector.size());
+      std::size_t count = 0;
+      for (std::size_t i = 0; i < vector.size(); i++)
+      {
+        if (vector[i] != T(0))
+        {
+          elements_.emplace_back(i, vector[i]);
+          count++;
+        }
+      }
+      counts_.push_back(count);
+    }
+  }
+
+  template<class PerDataSpaceVectors>
+  void Restore(PerDataSpaceVectors& vectors) const
+  {
+    auto element = elements_.begin();
+    for (unsigned pvi = 0; pvi < sizes_.size(); pvi++)
+    {
+      auto& vector = vectors[pvi];
+      vector.assign(sizes_[pvi], T(0));
+      for (std::size_t n = 0; n < counts_[pvi]; n++, element++)
+      {
+        vector[element->first] = element->second;
+      }
+    }
+  }
+};
+
+template<class Entry>
+class NetworkMemo
+{
+ public:
+  static const std::size_t kDefaultCapacity = 256;
+
+ private:
+  struct Slot
+  {
+    std::uint64_t hash;
+    std::string key;
+    Entry entry;
+  };
+  typedef std::list<Slot> Entries;
+
+  std::size_t capacity_;
+  bool enabled_;
+  bool first_ = true;
+  Entries entries_; // most-recently used first.
+  std::unordered_map<std::uint64_t, typename Entries::iterator> index_;
+
+  std::string key_; // signature of the current lookup.
+  std::uint64_t hash_;
+  NetworkMemoCounters counters_;
+
+  static std::size_t DefaultCapacity()
+  {
+    static const std::size_t capacity = []()
+      {
+        const char* env = std::getenv("TIMELOOP_NETWORK_MEMO");
+        return env ? std::size_t(std::strtoull(env, nullptr, 10)) : kDefaultCapacity;
+      }();
+    return capacity;
+  }
+
+ public:
+  NetworkMemo() :
+      capacity_(DefaultCapacity()),
+      enabled_(capacity_ > 0)
+  { }
+
+  NetworkMemo(const NetworkMemo& other) :
+      capacity_(other.capacity_),
+      enabled_(capacity_ > 0)
+  { }
+
+  NetworkMemo& operator=(const NetworkMemo& other)
+  {
+    capacity_ = other.capacity_;
+    enabled_ = capacity_ > 0;
+    first_ = true;
+    entries_.clear();
+    index_.clear();
+    counters_ = NetworkMemoCounters();
+    return *this;
+  }
+
+  // Whether to memoize an evaluation. A network's first evaluation cannot
+  // hit, and a network that is evaluated only once (e.g., on a scratch
+  // topology) would pay for recording it, so the memo starts with the second.
+  bool Use()
+  {
+    if (!enabled_ || first_)
+    {
+      first_ = false;
+      return false;
+    }
+    return true;
+  }
+
+  const NetworkMemoCounters& Counters() const { return counters_; }
+
+  //
+  // Signature.
+  //
+  void Begin()
+  {
+    key_.clear();
+    hash_ = 0;
+  }
+
+  template<class T>
+  void Append(const T& t)
+  {
+    static_assert(sizeof(T) <= sizeof(std::uint64_t), "signature fields are at most 64 bits");
+    std::uint64_t word = 0;
+    std::memcpy(&word, &t, sizeof(T));
+    key_.append(reinterpret_cast<const char*>(&word), sizeof(T));
+    hash_ = (hash_ ^ word) * 0x9e3779b97f4a7c15ULL;
+    hash_ ^= hash_ >> 29;
+  }
+
+  //
+  // Lookup: restores the memoized stats of the signature into stats, if any.
+  //
+  template<class Stats>
+  bool Lookup(Stats& stats)
+  {
+    auto it = index_.find(hash_);
+    if (it != index_.end() && it->second->key == key_)
+    {
+      entries_.splice(entries_.begin(), entries_, it->second);
+      it->second->entry.Restore(stats);
+      counters_.hits++;
+      return true;
+    }
+    return false;
+  }
+
+  // Record the stats evaluated after a failed lookup.
+  template<class Stats>
+  void Insert(const Stats& stats)
+  {
+    counters_.misses++;
+
+    // An entry whose signature has the same hash is replaced.
+    auto it = index_.find(hash_);
+    if (it != index_.end())
+    {
+      entries_.erase(it->second);
+      index_.erase(it);
+    }
+    else if (entries_.size() >= capacity_)
+    {
+      index_.erase(entries_.back().hash);
+      entries_.pop_back();
+    }
+    entries_.emplace_front();
+    entries_.front().hash = hash_;
+    entries_.front().key = key_;
+    entries_.front().entry.Save(stats);
+    index_[hash_] = entries_.begin();
+  }
+};
+
+} // namespace model
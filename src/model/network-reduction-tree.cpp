@@ -35,6 +35,7 @@
 #include <boost/archive/xml_oarchive.hpp>
 
 #include "model/network-reduction-tree.hpp"
+#include "util/trace.hpp"
 BOOST_CLASS_EXPORT(model::ReductionTreeNetwork)
 
 namespace model
@@ -132,6 +133,12 @@ void ReductionTreeNetwork::ResetConnectionType()
   specs_.cType = Unused;
 }
 
+void ReductionTreeNetwork::Reset()
+{
+  stats_ = Stats();
+  is_evaluated_ = false;
+}
+
 
 bool ReductionTreeNetwork::DistributedMulticastSupported() const
 {
@@ -152,6 +159,7 @@ EvalStatus ReductionTreeNetwork::Evaluate(const tiling::CompoundTile& tile,
                               const bool break_on_failure)
 {
   (void) break_on_failure;
+  TRACE_SCOPE("network/reduction-tree");
   assert(specs_.cType == UpdateDrain); // ReductionTreeNetwork can only be used in update-drain connection
 
   // Get stats from the CompoundTile
@@ -163,6 +163,7 @@ class ReductionTreeNetwork : public Network
   std::string Name() const;
   void AddConnectionType(ConnectionType ct);
   void ResetConnectionType();
+  void Reset();
 
   bool DistributedMulticastSupported() const;
 
@@ -25,6 +25,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <iostream>
 
 #include "model/util.hpp"
@@ -35,6 +36,7 @@
 #include <boost/archive/xml_oarchive.hpp>
 
 #include "model/network-simple-multicast.hpp"
+#include "util/trace.hpp"
 BOOST_CLASS_EXPORT(model::SimpleMulticastNetwork)
 
 namespace model
@@ -147,6 +149,23 @@ void SimpleMulticastNetwork::ResetConnectionType()
   specs_.cType = Unused;
 }
 
+void SimpleMulticastNetwork::Reset()
+{
+  // The per-data-space vectors keep their storage, for the next evaluation
+  // or memo hit to fill without allocating.
+  auto ingresses = std::move(stats_.ingresses);
+  stats_ = Stats();
+  if (ingresses.size() == stats_.ingresses.size())
+  {
+    for (unsigned pvi = 0; pvi < ingresses.size(); pvi++)
+    {
+      ingresses[pvi].clear();
+    }
+    stats_.ingresses = std::move(ingresses);
+  }
+  is_evaluated_ = false;
+}
+
 
 bool SimpleMulticastNetwork::DistributedMulticastSupported() const
 {
@@ -203,11 +222,62 @@ double SimpleMulticastNetwork::GetMulticastEnergyByDataType(std::uint64_t multic
     return opEnergy;
 }
 
+std::vector<std::pair<std::string, double>> SimpleMulticastNetwork::ERTEnergies(const Specs& specs)
+{
+  // Read through const nodes: yaml-cpp's non-const lookups may modify the
+  // ERT, which is shared with other copies of these specs.
+  std::vector<std::pair<std::string, double>> energies;
+  auto ert_node = specs.accelergyERT;
+  const YAML::Node ert = ert_node.getYNode();
+  if (!ert.IsMap())
+    return energies;
+
+  for (auto action : ert)
+  {
+    auto name = action.first.as<std::string>();
+    const YAML::Node entries = action.second;
+    if (entries.IsSequence())
+    {
+      for (auto entry : entries)
+      {
+        const YAML::Node arguments = entry["arguments"];
+        std::string factor;
+        if (arguments.IsMap() && arguments[specs.multicast_factor_argument])
+          factor = arguments[specs.multicast_factor_argument].as<std::string>();
+        energies.emplace_back(name + "[" + factor + "]", entry["energy"].as<double>(0));
+      }
+    }
+    else
+    {
+      energies.emplace_back(name, entries["energy"].as<double>(0));
+    }
+  }
+
+  std::sort(energies.begin(), energies.end());
+  return energies;
+}
+
 EvalStatus SimpleMulticastNetwork::Evaluate(const tiling::CompoundTile& tile,
                               const bool break_on_failure)
 {
   (void) tile;
   (void) break_on_failure;
+  TRACE_SCOPE("network/simple-multicast");
+
+  // Energies are looked up in the ERT for every non-zero multicast factor,
+  // which is what the memo saves. It is only used on stats that were reset,
+  // since a full evaluation leaves some of them as they were.
+  bool memoize = !is_evaluated_ && memo_.Use();
+  if (memoize)
+  {
+    memo_.Begin();
+    AppendSignature(tile);
+    if (memo_.Lookup(stats_))
+    {
+      is_evaluated_ = true;
+      return EvalStatus{true, std::string("")};
+    }
+  }
 
   // Get stats from the CompoundTile
   for (unsigned pvi = 0; pvi < unsigned(problem::GetShape()->NumDataSpaces); pvi++)
@@ -244,9 +314,50 @@ EvalStatus SimpleMulticastNetwork::Evaluate(const tiling::CompoundTile& tile,
   auto eval_status = EvalStatus{true, std::string("")};
   is_evaluated_ = true;
 
+  if (memoize)
+  {
+    memo_.Insert(stats_);
+  }
   return eval_status;
 }
 
+void SimpleMulticastNetwork::MemoEntry::Save(const Stats& evaluated)
+{
+  stats = evaluated;
+  stats.ingresses = problem::PerDataSpace<std::vector<unsigned long>>();
+  ingresses.Save(evaluated.ingresses);
+}
+
+void SimpleMulticastNetwork::MemoEntry::Restore(Stats& restored) const
+{
+  // The saved stats' vectors are empty, so assigning them leaves the
+  // storage of the restored ones in place.
+  restored = stats;
+  ingresses.Restore(restored.ingresses);
+}
+
+// Everything Evaluate() reads besides the specs, which are fixed at
+// construction: the replication factor, fanout and non-zero multicast
+// factors of each data space's accesses.
+void SimpleMulticastNetwork::AppendSignature(const tiling::CompoundTile& tile)
+{
+  for (unsigned pvi = 0; pvi < unsigned(problem::GetShape()->NumDataSpaces); pvi++)
+  {
+    auto& t = tile[pvi];
+    memo_.Append(t.replication_factor);
+    memo_.Append(t.fanout);
+    memo_.Append(t.accesses.size());
+    for (std::size_t i = 0; i < t.accesses.size(); i++)
+    {
+      if (t.accesses[i] > 0)
+      {
+        memo_.Append(i);
+        memo_.Append(t.accesses[i]);
+      }
+    }
+  }
+}
+
 void SimpleMulticastNetwork::Print(std::ostream& out) const
 {
   // Print network name.
@@ -295,6 +406,11 @@ std::uint64_t SimpleMulticastNetwork::WordBits() const
   return 0;
 }
 
+const NetworkMemoCounters& SimpleMulticastNetwork::MemoCounters() const
+{
+  return memo_.Counters();
+}
+
 STAT_ACCESSOR(double, SimpleMulticastNetwork, Energy, stats_.energy.at(pv))
 
 } // namespace model
@@ -35,6 +35,7 @@
 #include "pat/pat.hpp"
 
 #include "model/network.hpp"
+#include "model/network-memo.hpp"
 
 namespace model
 {
@@ -122,6 +123,19 @@ class SimpleMulticastNetwork : public Network
   std::weak_ptr<Level> source_;
   std::weak_ptr<Level> sink_;
 
+  // An evaluation memo entry: the stats, with their per-multicast-factor
+  // vectors kept sparse (see network-memo.hpp).
+  struct MemoEntry
+  {
+    Stats stats;
+    SparseVectors<unsigned long> ingresses;
+
+    void Save(const Stats& evaluated);
+    void Restore(Stats& restored) const;
+  };
+
+  NetworkMemo<MemoEntry> memo_;
+
  public:
   Stats stats_; // temporarily public.
 
@@ -161,6 +175,7 @@ class SimpleMulticastNetwork : public Network
   std::string Name() const;
   void AddConnectionType(ConnectionType ct);
   void ResetConnectionType();
+  void Reset();
 
   bool DistributedMulticastSupported() const;
 
@@ -171,17 +186,26 @@ class SimpleMulticastNetwork : public Network
   double GetOpEnergyFromERT(std::uint64_t multicast_factor, std::string operation_name);
   double GetMulticastEnergy(std::uint64_t multicast_factor);
   double GetMulticastEnergyByDataType(std::uint64_t multicast_factor, std::string data_space_name);
+
+  // The energy of every action in the ERT, sorted by action. Actions that
+  // take a multicast factor have one entry per factor, as "<action>[<factor>]".
+  static std::vector<std::pair<std::string, double>> ERTEnergies(const Specs& specs);
  
   EvalStatus Evaluate(const tiling::CompoundTile& tile,
                               const bool break_on_failure);
 
   void Print(std::ostream& out) const;
 
+  const NetworkMemoCounters& MemoCounters() const;
+
   // Ugly abstraction-breaking probes that should be removed.
   std::uint64_t WordBits() const;
 
   STAT_ACCESSOR_HEADER(double, Energy);
 
+ private:
+  void AppendSignature(const tiling::CompoundTile& tile);
+
 }; // class SimpleMulticastNetwork
 
 } // namespace model
@@ -90,6 +90,10 @@ class Network : public Module
   virtual void AddConnectionType(ConnectionType ct) = 0;
   virtual void ResetConnectionType() = 0;
 
+  // Discard the stats of the last evaluation, leaving the network as
+  // freshly specced.
+  virtual void Reset() = 0;
+
   // STAT_ACCESSOR_HEADER(virtual double, Energy) = 0;
   virtual double Energy(problem::Shape::DataSpaceID pv = problem::GetShape()->NumDataSpaces) const = 0;
 
@@ -0,0 +1,552 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include <cstring>
+#include <dlfcn.h>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <sys/stat.h>
+
+#include "model/spec-cache.hpp"
+#include "model/buffer.hpp"
+#include "model/arithmetic.hpp"
+#include "model/network-legacy.hpp"
+#include "model/network-reduction-tree.hpp"
+#include "model/network-simple-multicast.hpp"
+#include "util/cache-file.hpp"
+
+namespace model
+{
+
+using cache::Write;
+using cache::Read;
+
+// Binary layout (see util/cache-file.hpp). Strings are length:u32
+// bytes:char[length], attributes specified:u8 followed by their value if
+// specified:
+//   magic[8] version:u32
+//   num_levels:u32 { kind:u8 level-specs }*
+//   num_inferred_networks:u32 { legacy-network-specs }*
+//   num_networks:u32 { kind:u8 network-specs }*
+// with the specs' fields in declaration order.
+static const char kSpecsMagic[8] = { 'T', 'L', 'S', 'P', 'E', 'C', 'B', 'N' };
+static const std::uint32_t kSpecsVersion = 1;
+
+enum class LevelKind : std::uint8_t { Arithmetic, Buffer };
+enum class NetworkKind : std::uint8_t { Legacy, ReductionTree, SimpleMulticast };
+
+//
+// Writers.
+//
+
+static void Write(std::ostream& out, const BufferLevel::Technology& value)
+{
+  Write(out, std::uint8_t(value));
+}
+
+template<class T>
+static void Write(std::ostream& out, const Attribute<T>& attribute)
+{
+  Write(out, std::uint8_t(attribute.IsSpecified()));
+  if (attribute.IsSpecified())
+    Write(out, attribute.Get());
+}
+
+static void WriteLevel(std::ostream& out, const ArithmeticUnits::Specs& specs)
+{
+  Write(out, LevelKind::Arithmetic);
+  Write(out, specs.level_name);
+  Write(out, specs.name);
+  Write(out, specs.instances);
+  Write(out, specs.meshX);
+  Write(out, specs.meshY);
+  Write(out, specs.word_bits);
+  Write(out, specs.energy_per_op);
+  Write(out, specs.area);
+  Write(out, specs.operand_network_name);
+  Write(out, specs.result_network_name);
+}
+
+static void WriteLevel(std::ostream& out, const BufferLevel::Specs& specs)
+{
+  Write(out, LevelKind::Buffer);
+  Write(out, specs.level_name);
+  Write(out, specs.name);
+  Write(out, specs.technology);
+  Write(out, specs.size);
+  Write(out, specs.word_bits);
+  Write(out, specs.addr_gen_bits);
+  Write(out, specs.block_size);
+  Write(out, specs.cluster_size);
+  Write(out, specs.instances);
+  Write(out, specs.meshX);
+  Write(out, specs.meshY);
+  Write(out, specs.read_bandwidth);
+  Write(out, specs.write_bandwidth);
+  Write(out, specs.multiple_buffering);
+  Write(out, specs.effective_size);
+  Write(out, specs.min_utilization);
+  Write(out, specs.num_ports);
+  Write(out, specs.num_banks);
+  Write(out, specs.read_network_name);
+  Write(out, specs.fill_network_name);
+  Write(out, specs.drain_network_name);
+  Write(out, specs.update_network_name);
+  Write(out, specs.vector_access_energy);
+  Write(out, specs.storage_area);
+  Write(out, specs.addr_gen_energy);
+}
+
+static void WriteNetworkBase(std::ostream& out, const NetworkSpecs& specs)
+{
+  Write(out, specs.name);
+  Write(out, std::int32_t(specs.cType));
+}
+
+static void WriteNetwork(std::ostream& out, const LegacyNetwork::Specs& specs)
+{
+  WriteNetworkBase(out, specs);
+  Write(out, specs.type);
+  Write(out, specs.legacy_subtype);
+  Write(out, specs.word_bits);
+  Write(out, specs.router_energy);
+  Write(out, specs.wire_energy);
+  Write(out, specs.tile_width);
+  Write(out, specs.energy_per_hop);
+}
+
+static void WriteNetwork(std::ostream& out, const ReductionTreeNetwork::Specs& specs)
+{
+  WriteNetworkBase(out, specs);
+  Write(out, specs.type);
+  Write(out, specs.word_bits);
+  Write(out, specs.adder_energy);
+  Write(out, specs.wire_energy);
+  Write(out, specs.tile_width);
+}
+
+static void WriteNetwork(std::ostream& out, const SimpleMulticastNetwork::Specs& specs)
+{
+  WriteNetworkBase(out, specs);
+  Write(out, specs.type);
+  Write(out, specs.word_bits);
+  Write(out, specs.tile_width);
+  auto ert = specs.accelergyERT;
+  auto ert_yaml = ert.getYNode();
+  Write(out, (ert_yaml && !ert_yaml.IsNull()) ? YAML::Dump(ert_yaml) : std::string());
+  Write(out, specs.action_name);
+  Write(out, specs.multicast_factor_argument);
+  Write(out, std::uint8_t(specs.per_datatype_ERT));
+}
+
+//
+// Readers.
+//
+
+static bool Read(std::istream& in, BufferLevel::Technology& value)
+{
+  std::uint8_t technology;
+  if (!Read(in, technology) || technology > std::uint8_t(BufferLevel::Technology::DRAM))
+    return false;
+  value = BufferLevel::Technology(technology);
+  return true;
+}
+
+template<class T>
+static bool Read(std::istream& in, Attribute<T>& attribute)
+{
+  std::uint8_t specified;
+  if (!Read(in, specified))
+    return false;
+  attribute = Attribute<T>();
+  if (specified)
+  {
+    T value;
+    if (!Read(in, value))
+      return false;
+    attribute = value;
+  }
+  return true;
+}
+
+static bool ReadLevel(std::istream& in, ArithmeticUnits::Specs& specs)
+{
+  return Read(in, specs.level_name) &&
+    Read(in, specs.name) &&
+    Read(in, specs.instances) &&
+    Read(in, specs.meshX) &&
+    Read(in, specs.meshY) &&
+    Read(in, specs.word_bits) &&
+    Read(in, specs.energy_per_op) &&
+    Read(in, specs.area) &&
+    Read(in, specs.operand_network_name) &&
+    Read(in, specs.result_network_name);
+}
+
+static bool ReadLevel(std::istream& in, BufferLevel::Specs& specs)
+{
+  return Read(in, specs.level_name) &&
+    Read(in, specs.name) &&
+    Read(in, specs.technology) &&
+    Read(in, specs.size) &&
+    Read(in, specs.word_bits) &&
+    Read(in, specs.addr_gen_bits) &&
+    Read(in, specs.block_size) &&
+    Read(in, specs.cluster_size) &&
+    Read(in, specs.instances) &&
+    Read(in, specs.meshX) &&
+    Read(in, specs.meshY) &&
+    Read(in, specs.read_bandwidth) &&
+    Read(in, specs.write_bandwidth) &&
+    Read(in, specs.multiple_buffering) &&
+    Read(in, specs.effective_size) &&
+    Read(in, specs.min_utilization) &&
+    Read(in, specs.num_ports) &&
+    Read(in, specs.num_banks) &&
+    Read(in, specs.read_network_name) &&
+    Read(in, specs.fill_network_name) &&
+    Read(in, specs.drain_network_name) &&
+    Read(in, specs.update_network_name) &&
+    Read(in, specs.vector_access_energy) &&
+    Read(in, specs.storage_area) &&
+    Read(in, specs.addr_gen_energy);
+}
+
+static bool ReadNetworkBase(std::istream& in, NetworkSpecs& specs)
+{
+  std::int32_t connection_type;
+  if (!Read(in, specs.name) || !Read(in, connection_type) ||
+      connection_type < Unused || connection_type > ReadFillUpdateDrain)
+    return false;
+  specs.cType = ConnectionType(connection_type);
+  return true;
+}
+
+static bool ReadNetwork(std::istream& in, LegacyNetwork::Specs& specs)
+{
+  return ReadNetworkBase(in, specs) &&
+    Read(in, specs.type) &&
+    Read(in, specs.legacy_subtype) &&
+    Read(in, specs.word_bits) &&
+    Read(in, specs.router_energy) &&
+    Read(in, specs.wire_energy) &&
+    Read(in, specs.tile_width) &&
+    Read(in, specs.energy_per_hop);
+}
+
+static bool ReadNetwork(std::istream& in, ReductionTreeNetwork::Specs& specs)
+{
+  return ReadNetworkBase(in, specs) &&
+    Read(in, specs.type) &&
+    Read(in, specs.word_bits) &&
+    Read(in, specs.adder_energy) &&
+    Read(in, specs.wire_energy) &&
+    Read(in, specs.tile_width);
+}
+
+static bool ReadNetwork(std::istream& in, SimpleMulticastNetwork::Specs& specs)
+{
+  std::string ert;
+  std::uint8_t per_datatype_ERT;
+  if (!ReadNetworkBase(in, specs) ||
+      !Read(in, specs.type) ||
+      !Read(in, specs.word_bits) ||
+      !Read(in, specs.tile_width) ||
+      !Read(in, ert) ||
+      !Read(in, specs.action_name) ||
+      !Read(in, specs.multicast_factor_argument) ||
+      !Read(in, per_datatype_ERT))
+    return false;
+  if (!ert.empty())
+    specs.accelergyERT = config::CompoundConfigNode(nullptr, YAML::Load(ert));
+  specs.per_datatype_ERT = per_datatype_ERT;
+  return true;
+}
+
+//
+// Snapshot files.
+//
+
+bool SpecCache::Save(const Engine::Specs& specs, const std::string& path)
+{
+  auto& topology = specs.topology;
+
+  return cache::SaveAtomically(path, [&topology](std::ostream& out)
+  {
+    out.write(kSpecsMagic, sizeof(kSpecsMagic));
+    Write(out, kSpecsVersion);
+
+    Write(out, std::uint32_t(topology.NumLevels()));
+    for (unsigned i = 0; i < topology.NumLevels(); i++)
+    {
+      auto level = topology.GetLevel(i);
+      if (auto arithmetic = std::dynamic_pointer_cast<const ArithmeticUnits::Specs>(level))
+        WriteLevel(out, *arithmetic);
+      else
+        WriteLevel(out, *std::dynamic_pointer_cast<const BufferLevel::Specs>(level));
+    }
+
+    Write(out, std::uint32_t(topology.NumStorageLevels()));
+    for (unsigned i = 0; i < topology.NumStorageLevels(); i++)
+      WriteNetwork(out, *topology.GetInferredNetwork(i));
+
+    Write(out, std::uint32_t(topology.NumNetworks()));
+    for (unsigned i = 0; i < topology.NumNetworks(); i++)
+    {
+      auto network = topology.GetNetwork(i);
+      if (auto legacy = std::dynamic_pointer_cast<const LegacyNetwork::Specs>(network))
+      {
+        Write(out, NetworkKind::Legacy);
+        WriteNetwork(out, *legacy);
+      }
+      else if (auto reduction_tree = std::dynamic_pointer_cast<const ReductionTreeNetwork::Specs>(network))
+      {
+        Write(out, NetworkKind::ReductionTree);
+        WriteNetwork(out, *reduction_tree);
+      }
+      else
+      {
+        Write(out, NetworkKind::SimpleMulticast);
+        WriteNetwork(out, *std::dynamic_pointer_cast<const SimpleMulticastNetwork::Specs>(network));
+      }
+    }
+  });
+}
+
+bool SpecCache::Load(const std::string& path, Engine::Specs& specs)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    return false;
+
+  char magic[sizeof(kSpecsMagic)];
+  std::uint32_t version;
+  in.read(magic, sizeof(magic));
+  if (!in || std::memcmp(magic, kSpecsMagic, sizeof(kSpecsMagic)) != 0 ||
+      !Read(in, version) || version != kSpecsVersion)
+    return false;
+
+  Topology::Specs topology;
+
+  std::uint32_t num_levels;
+  if (!Read(in, num_levels))
+    return false;
+  unsigned num_arithmetic = 0, num_storage = 0;
+  for (unsigned i = 0; i < num_levels; i++)
+  {
+    LevelKind kind;
+    if (!Read(in, kind))
+      return false;
+    if (kind == LevelKind::Arithmetic)
+    {
+      auto level = std::make_shared<ArithmeticUnits::Specs>();
+      if (!ReadLevel(in, *level))
+        return false;
+      topology.AddLevel(0, level);
+      num_arithmetic++;
+    }
+    else if (kind == LevelKind::Buffer)
+    {
+      auto level = std::make_shared<BufferLevel::Specs>();
+      if (!ReadLevel(in, *level))
+        return false;
+      topology.AddLevel(num_storage++, level);
+    }
+    else
+    {
+      return false;
+    }
+  }
+  if (num_arithmetic != 1)
+    return false;
+
+  std::uint32_t num_inferred_networks;
+  if (!Read(in, num_inferred_networks) || num_inferred_networks != num_storage)
+    return false;
+  for (unsigned i = 0; i < num_inferred_networks; i++)
+  {
+    auto network = std::make_shared<LegacyNetwork::Specs>();
+    if (!ReadNetwork(in, *network))
+      return false;
+    topology.AddInferredNetwork(network);
+  }
+
+  std::uint32_t num_networks;
+  if (!Read(in, num_networks))
+    return false;
+  for (unsigned i = 0; i < num_networks; i++)
+  {
+    NetworkKind kind;
+    if (!Read(in, kind))
+      return false;
+    std::shared_ptr<NetworkSpecs> network;
+    if (kind == NetworkKind::Legacy)
+    {
+      auto legacy = std::make_shared<LegacyNetwork::Specs>();
+      if (!ReadNetwork(in, *legacy))
+        return false;
+      network = legacy;
+    }
+    else if (kind == NetworkKind::ReductionTree)
+    {
+      auto reduction_tree = std::make_shared<ReductionTreeNetwork::Specs>();
+      if (!ReadNetwork(in, *reduction_tree))
+        return false;
+      network = reduction_tree;
+    }
+    else if (kind == NetworkKind::SimpleMulticast)
+    {
+      auto simple_multicast = std::make_shared<SimpleMulticastNetwork::Specs>();
+      if (!ReadNetwork(in, *simple_multicast))
+        return false;
+      network = simple_multicast;
+    }
+    else
+    {
+      return false;
+    }
+    topology.AddNetwork(network);
+  }
+
+  specs.topology = topology;
+  return true;
+}
+
+//
+// Cache.
+//
+
+// Keys whose parse prints a deprecation warning (see BufferLevel::ParseSpecs).
+// A section that uses one is parsed every time, so that a cache hit does not
+// hide the warning.
+static const char* const kDeprecatedKeys[] = { "bandwidth" };
+
+// Structural hash of a YAML tree. Sets deprecated if a map in the tree has
+// one of kDeprecatedKeys.
+static std::uint64_t HashNode(const YAML::Node& node, std::uint64_t hash, bool& deprecated)
+{
+  char type = static_cast<char>(node.Type());
+  hash = cache::HashBytes(&type, 1, hash);
+  if (node.IsScalar())
+  {
+    hash = cache::HashBytes(node.Scalar().data(), node.Scalar().size() + 1, hash);
+  }
+  else if (node.IsSequence())
+  {
+    for (auto it = node.begin(); it != node.end(); it++)
+      hash = HashNode(*it, hash, deprecated);
+  }
+  else if (node.IsMap())
+  {
+    for (auto it = node.begin(); it != node.end(); it++)
+    {
+      if (it->first.IsScalar())
+        for (auto key : kDeprecatedKeys)
+          deprecated |= it->first.Scalar() == key;
+      hash = HashNode(it->first, hash, deprecated);
+      hash = HashNode(it->second, hash, deprecated);
+    }
+  }
+  return cache::HashBytes(&type, 1, hash);
+}
+
+// Identifies the build that writes a snapshot, since the snapshot holds the
+// result of this build's ParseSpecs functions: the size, modification time
+// and inode of the binary or library containing them, else the time this
+// file was compiled.
+static std::uint64_t BuildStamp()
+{
+  static const std::uint64_t stamp = []()
+  {
+    Dl_info info;
+    struct stat file;
+    if (dladdr(reinterpret_cast<void*>(&BuildStamp), &info) && info.dli_fname &&
+        stat(info.dli_fname, &file) == 0)
+    {
+      std::uint64_t fields[] = { std::uint64_t(file.st_size), std::uint64_t(file.st_mtim.tv_sec),
+                                 std::uint64_t(file.st_mtim.tv_nsec), std::uint64_t(file.st_ino) };
+      return cache::HashBytes(reinterpret_cast<const char*>(fields), sizeof(fields));
+    }
+    return cache::HashBytes(__DATE__ " " __TIME__);
+  }();
+  return stamp;
+}
+
+Engine::Specs SpecCache::ParseSpecs(config::CompoundConfig* config, const std::string& key)
+{
+  if (config->hasLConfig() || !config->getYConfig().IsMap())
+    return Engine::ParseSpecs(config->getRoot().lookup(key));
+
+  const YAML::Node& root = config->getYConfig();
+  bool deprecated = false;
+  if (!root[key])
+    return Engine::ParseSpecs(config->getRoot().lookup(key));
+  std::uint64_t hash = HashNode(root[key], cache::kHashSeed, deprecated);
+  if (deprecated)
+    return Engine::ParseSpecs(config->getRoot().lookup(key));
+  // The section may refer to the config's variables.
+  if (root["variables"])
+    hash = HashNode(root["variables"], hash, deprecated);
+
+  static std::mutex mutex;
+  static std::map<std::uint64_t, Engine::Specs> parsed;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto cached = parsed.find(hash);
+    if (cached != parsed.end())
+      return cached->second;
+  }
+
+  Engine::Specs specs;
+  std::string path;
+  std::string dir = cache::CacheDir("TIMELOOP_SPEC_CACHE", "specs");
+  if (!dir.empty())
+  {
+    std::uint64_t stamped_hash = cache::HashBytes(reinterpret_cast<const char*>(&hash), sizeof(hash), BuildStamp());
+    std::stringstream ss;
+    ss << dir << "/" << std::hex << std::setw(16) << std::setfill('0') << stamped_hash << ".specs";
+    path = ss.str();
+  }
+
+  if (path.empty() || !Load(path, specs))
+  {
+    specs = Engine::ParseSpecs(config->getRoot().lookup(key));
+    if (!path.empty() && !Save(specs, path))
+      std::cerr << "WARNING: could not write spec cache " << path << std::endl;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  parsed.emplace(hash, specs);
+  return specs;
+}
+
+} // namespace model
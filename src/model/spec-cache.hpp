@@ -0,0 +1,70 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <string>
+
+#include "model/engine.hpp"
+#include "compound-config/compound-config.hpp"
+
+namespace model
+{
+
+//--------------------------------------------//
+//          Architecture Spec Cache           //
+//--------------------------------------------//
+
+// Typed architecture specs, cached by the content of the config section they
+// were parsed from. Engine::ParseSpecs walks the section with thousands of
+// string-keyed lookups, and DSE points that share an architecture, as well
+// as re-runs with an unchanged one, repeat the walk. The cache keeps the
+// specs of every architecture parsed in this process and, if enabled, a
+// binary snapshot of each on disk.
+//
+// Specs are cached before any ERT is applied; compiled ERTs have a cache of
+// their own (see util/accelergy_interface.hpp). The key is a structural hash
+// of the section and of the config's variables, which the section may refer
+// to; snapshot keys also cover the build that wrote them. Sections that use
+// a deprecated attribute are parsed every time, so that its warning is
+// printed. Configs read from libconfig files are not cached.
+//
+// Snapshots are opt-in (see cache::CacheDir): TIMELOOP_SPEC_CACHE names
+// their directory, "on" selecting $HOME/.cache/timeloop/specs.
+class SpecCache
+{
+ public:
+  // Engine::ParseSpecs of the config's top-level section named key.
+  static Engine::Specs ParseSpecs(config::CompoundConfig* config, const std::string& key);
+
+  // Lossless binary snapshot of a set of specs.
+  static bool Save(const Engine::Specs& specs, const std::string& path);
+  static bool Load(const std::string& path, Engine::Specs& specs);
+};
+
+} // namespace model
@@ -26,12 +26,15 @@
  */
 
 #include <cassert>
+#include <iomanip>
+#include <sstream>
 #include <string>
 #include <stdexcept>
 
 #include "model/topology.hpp"
 #include "model/network-legacy.hpp"
 #include "model/network-factory.hpp"
+#include "util/trace.hpp"
 
 namespace model
 {
@@ -41,6 +44,11 @@ namespace model
 //--------------------------------------------//
 
 void Topology::Specs::ParseAccelergyERT(config::CompoundConfigNode ert)
+{
+  ApplyAccelergyERT(CompileAccelergyERT(ert));
+}
+
+CompiledERT Topology::Specs::CompileAccelergyERT(config::CompoundConfigNode ert) const
 {
   // std::cout << "Replacing energy numbers..." << std::endl;
   assert(ert.exists("tables"));
@@ -75,6 +83,11 @@ void Topology::Specs::ParseAccelergyERT(config::CompoundConfigNode ert)
     std::cout << "Invalid Accelergy ERT version: " << ertVersion << std::endl;
     assert(false);
   }
+  CompiledERT compiled;
+  compiled.level_specified.resize(NumLevels(), 0);
+  compiled.level_energy.resize(NumLevels(), 0);
+  compiled.network_ert.resize(NumNetworks());
+
   // parsing 
   std::vector<std::string> keys;
   auto table = formattedErt.lookup("tables");
@@ -99,11 +112,8 @@ void Topology::Specs::ParseAccelergyERT(config::CompoundConfigNode ert)
       float transferEnergy;
       auto actionERT = componentERT.lookup("transfer_random");
       if (actionERT.lookupValue("energy", transferEnergy)) {
-        for (unsigned i = 0; i < NumStorageLevels(); i++) { // update wire energy for all storage levels
-          auto bufferSpec = GetStorageLevel(i);
-          auto networkSpec = GetNetwork(i); // FIXME.
-          std::static_pointer_cast<LegacyNetwork::Specs>(networkSpec)->wire_energy = transferEnergy; // FIXME.
-        }
+        compiled.wire_specified = true;
+        compiled.wire_energy = transferEnergy;
       }
     } else {
       // Check if the ERT describes any network associated with a storage component
@@ -112,16 +122,19 @@ void Topology::Specs::ParseAccelergyERT(config::CompoundConfigNode ert)
           auto networkSpec = GetNetwork(i);
           if (networkSpec->Type() == "SimpleMulticast" && networkSpec->name == componentName){
             // std::cout << "simple multicast component identified: " << componentName << std::endl;
-            std::static_pointer_cast<SimpleMulticastNetwork::Specs>(networkSpec)->accelergyERT = componentERT;
+            YAML::Emitter emitter;
+            emitter << componentERT.getYNode();
+            compiled.network_ert.at(i) = emitter.c_str();
            }
       }
       // Find the level that matches this name and see what type it is
       bool isArithmeticUnit = false;
       bool isBuffer = false;
-      std::shared_ptr<LevelSpecs> specToUpdate;
-      for (auto level : levels) {
+      unsigned levelToUpdate = 0;
+      for (unsigned i = 0; i < NumLevels(); i++) {
+        auto& level = levels.at(i);
         if (level->level_name == componentName) {
-          specToUpdate = level;
+          levelToUpdate = i;
           if (level->Type() == "BufferLevel") isBuffer = true;
           if (level->Type() == "ArithmeticUnits") isArithmeticUnit = true;
         }
@@ -148,19 +161,106 @@ void Topology::Specs::ParseAccelergyERT(config::CompoundConfigNode ert)
       // Replace the energy per action
       if (isArithmeticUnit) {
         // std::cout << "  Replace " << componentName << " energy with energy " << opEnergy << std::endl;
-        auto arithmeticSpec = GetArithmeticLevel();
-        arithmeticSpec->energy_per_op = opEnergy;
+        compiled.level_specified.at(arithmetic_map) = 1;
+        compiled.level_energy.at(arithmetic_map) = opEnergy;
       } else if (isBuffer) {
-        auto bufferSpec = std::static_pointer_cast<BufferLevel::Specs>(specToUpdate);
+        auto bufferSpec = std::static_pointer_cast<const BufferLevel::Specs>(levels.at(levelToUpdate));
         // std::cout << "  Replace " << componentName << " VectorAccess energy with energy " << opEnergy << std::endl;
-        bufferSpec->vector_access_energy = opEnergy/bufferSpec->cluster_size.Get();
+        compiled.level_specified.at(levelToUpdate) = 1;
+        compiled.level_energy.at(levelToUpdate) = opEnergy/bufferSpec->cluster_size.Get();
       } else {
         // std::cout << "  Unused component ERT: "  << key << std::endl;
       }
     }
   }
 
-  return;
+  return compiled;
+}
+
+void Topology::Specs::ApplyAccelergyERT(const CompiledERT& compiled)
+{
+  if (compiled.level_energy.size() != NumLevels() || compiled.network_ert.size() != NumNetworks())
+  {
+    throw SpecsMismatch("compiled ERT does not match the architecture (" +
+                        std::to_string(compiled.level_energy.size()) + " levels, " +
+                        std::to_string(compiled.network_ert.size()) + " networks)");
+  }
+
+  if (compiled.wire_specified) {
+    for (unsigned i = 0; i < NumStorageLevels(); i++) { // update wire energy for all storage levels
+      auto networkSpec = MutableNetwork(i); // FIXME.
+      std::static_pointer_cast<LegacyNetwork::Specs>(networkSpec)->wire_energy = compiled.wire_energy; // FIXME.
+    }
+  }
+
+  for (unsigned i = 0; i < NumNetworks(); i++) {
+    if (!compiled.network_ert.at(i).empty()) {
+      auto networkSpec = std::static_pointer_cast<SimpleMulticastNetwork::Specs>(MutableNetwork(i));
+      networkSpec->accelergyERT = config::CompoundConfigNode(nullptr, YAML::Load(compiled.network_ert.at(i)));
+    }
+  }
+
+  for (unsigned i = 0; i < NumLevels(); i++) {
+    if (!compiled.level_specified.at(i))
+      continue;
+    auto levelSpec = MutableLevel(i);
+    if (levelSpec->Type() == "ArithmeticUnits")
+      std::static_pointer_cast<ArithmeticUnits::Specs>(levelSpec)->energy_per_op = compiled.level_energy.at(i);
+    else
+      std::static_pointer_cast<BufferLevel::Specs>(levelSpec)->vector_access_energy = compiled.level_energy.at(i);
+  }
+}
+
+CompiledERT Topology::Specs::AppliedERT() const
+{
+  CompiledERT compiled;
+  compiled.level_specified.resize(NumLevels(), 0);
+  compiled.level_energy.resize(NumLevels(), 0);
+  compiled.network_ert.resize(NumNetworks());
+
+  for (unsigned i = 0; i < NumLevels(); i++) {
+    auto levelSpec = GetLevel(i);
+    Attribute<double> energy;
+    if (levelSpec->Type() == "ArithmeticUnits")
+      energy = std::static_pointer_cast<const ArithmeticUnits::Specs>(levelSpec)->energy_per_op;
+    else
+      energy = std::static_pointer_cast<const BufferLevel::Specs>(levelSpec)->vector_access_energy;
+    if (energy.IsSpecified()) {
+      compiled.level_specified.at(i) = 1;
+      compiled.level_energy.at(i) = energy.Get();
+    }
+  }
+
+  // ApplyAccelergyERT sets one wire energy on the first NumStorageLevels()
+  // networks, so it can only have been applied if they all have the same.
+  compiled.wire_specified = NumStorageLevels() > 0 && NumNetworks() >= NumStorageLevels();
+  for (unsigned i = 0; compiled.wire_specified && i < NumStorageLevels(); i++) {
+    auto networkSpec = GetNetwork(i);
+    if (networkSpec->Type() != "Legacy") {
+      compiled.wire_specified = false;
+      break;
+    }
+    auto& wire_energy = std::static_pointer_cast<const LegacyNetwork::Specs>(networkSpec)->wire_energy;
+    if (!wire_energy.IsSpecified() || (i > 0 && wire_energy.Get() != compiled.wire_energy))
+      compiled.wire_specified = false;
+    else
+      compiled.wire_energy = wire_energy.Get();
+  }
+
+  for (unsigned i = 0; i < NumNetworks(); i++) {
+    auto networkSpec = GetNetwork(i);
+    if (networkSpec->Type() != "SimpleMulticast")
+      continue;
+    auto ert_node = std::static_pointer_cast<const SimpleMulticastNetwork::Specs>(networkSpec)->accelergyERT;
+    const YAML::Node ert = ert_node.getYNode();
+    if (ert.IsDefined() && !ert.IsNull()) {
+      YAML::Emitter emitter;
+      emitter << ert;
+      compiled.network_ert.at(i) = emitter.c_str();
+    }
+  }
+
+  return compiled;
 }
 
 std::vector<std::string> Topology::Specs::LevelNames() const
@@ -187,7 +287,7 @@ std::vector<std::string> Topology::Specs::StorageLevelNames() const
 // Level accessors.
 //
 
-void Topology::Specs::AddLevel(unsigned typed_id, std::shared_ptr<LevelSpecs> level_specs)
+void Topology::Specs::AddLevel(unsigned typed_id, std::shared_ptr<const LevelSpecs> level_specs)
 {
   if (level_specs->Type() == "BufferLevel")
   {
@@ -206,12 +306,12 @@ void Topology::Specs::AddLevel(unsigned typed_id, std::shared_ptr<LevelSpecs> le
   levels.push_back(level_specs);
 }
 
-void Topology::Specs::AddInferredNetwork(std::shared_ptr<LegacyNetwork::Specs> specs)
+void Topology::Specs::AddInferredNetwork(std::shared_ptr<const LegacyNetwork::Specs> specs)
 {
   inferred_networks.push_back(specs);
 }
 
-void Topology::Specs::AddNetwork(std::shared_ptr<NetworkSpecs> specs)
+void Topology::Specs::AddNetwork(std::shared_ptr<const NetworkSpecs> specs)
 {
   networks.push_back(specs);
 }
@@ -231,33 +331,149 @@ unsigned Topology::Specs::NumNetworks() const
   return networks.size();
 }
 
-std::shared_ptr<LevelSpecs> Topology::Specs::GetLevel(unsigned level_id) const
+std::shared_ptr<const LevelSpecs> Topology::Specs::GetLevel(unsigned level_id) const
 {
   return levels.at(level_id);
 }
 
-std::shared_ptr<BufferLevel::Specs> Topology::Specs::GetStorageLevel(unsigned storage_level_id) const
+std::shared_ptr<const BufferLevel::Specs> Topology::Specs::GetStorageLevel(unsigned storage_level_id) const
 {
   auto level_id = storage_map.at(storage_level_id);
-  return std::static_pointer_cast<BufferLevel::Specs>(levels.at(level_id));
+  return std::static_pointer_cast<const BufferLevel::Specs>(levels.at(level_id));
 }
 
-std::shared_ptr<ArithmeticUnits::Specs> Topology::Specs::GetArithmeticLevel() const
+std::shared_ptr<const ArithmeticUnits::Specs> Topology::Specs::GetArithmeticLevel() const
 {
   auto level_id = arithmetic_map;
-  return std::static_pointer_cast<ArithmeticUnits::Specs>(levels.at(level_id));
+  return std::static_pointer_cast<const ArithmeticUnits::Specs>(levels.at(level_id));
 }
 
-std::shared_ptr<LegacyNetwork::Specs> Topology::Specs::GetInferredNetwork(unsigned network_id) const
+std::shared_ptr<const LegacyNetwork::Specs> Topology::Specs::GetInferredNetwork(unsigned network_id) const
 {
   return inferred_networks.at(network_id);
 }
 
-std::shared_ptr<NetworkSpecs> Topology::Specs::GetNetwork(unsigned network_id) const
+std::shared_ptr<const NetworkSpecs> Topology::Specs::GetNetwork(unsigned network_id) const
 {
   return networks.at(network_id);
 }
 
+std::vector<double> Topology::Specs::ActionEnergies() const
+{
+  std::vector<double> energies(NumLevels() + NumNetworks(), 0);
+  for (unsigned storage_level_id = 0; storage_level_id < NumStorageLevels(); storage_level_id++)
+  {
+    energies.at(StorageMap(storage_level_id)) =
+      GetStorageLevel(storage_level_id)->vector_access_energy.Get();
+  }
+  energies.at(ArithmeticMap()) = GetArithmeticLevel()->energy_per_op.Get();
+
+  for (unsigned network_id = 0; network_id < NumNetworks(); network_id++)
+  {
+    auto network = GetNetwork(network_id);
+    if (network->Type() != "Legacy")
+      continue;
+    auto& legacy = static_cast<const LegacyNetwork::Specs&>(*network);
+    if (LegacyNetwork::LinearWireEnergy(legacy))
+      energies.at(NumLevels() + network_id) = legacy.wire_energy.Get();
+  }
+  return energies;
+}
+
+std::vector<std::pair<std::string, std::string>> Topology::Specs::FixedEnergyInputs() const
+{
+  std::vector<std::pair<std::string, std::string>> inputs;
+  auto add = [&inputs](const std::string& name, const auto& value)
+    {
+      std::ostringstream str;
+      str << std::setprecision(17) << value;
+      inputs.emplace_back(name, str.str());
+    };
+
+  for (unsigned storage_level_id = 0; storage_level_id < NumStorageLevels(); storage_level_id++)
+  {
+    auto level = GetStorageLevel(storage_level_id);
+    auto& name = level->level_name;
+    add(name + ".word-bits", level->word_bits);
+    add(name + ".size", level->size);
+    add(name + ".addr-gen-bits", level->addr_gen_bits);
+    add(name + ".addr-gen-energy", level->addr_gen_energy);
+  }
+
+  auto add_legacy = [&](const std::string& name, const LegacyNetwork::Specs& network, bool recosted)
+    {
+      add(name + ".word-bits", network.word_bits);
+      add(name + ".router-energy", network.router_energy);
+      add(name + ".energy-per-hop", network.energy_per_hop);
+      add(name + ".tile-width", network.tile_width);
+      // A linear wire energy is re-costed on user-defined networks; any
+      // other is not.
+      if (recosted && LegacyNetwork::LinearWireEnergy(network))
+        add(name + ".wire-model", "linear");
+      else
+        add(name + ".wire-energy", network.wire_energy);
+    };
+
+  for (unsigned network_id = 0; network_id < inferred_networks.size(); network_id++)
+  {
+    add_legacy("inferred-network-" + std::to_string(network_id), *GetInferredNetwork(network_id), false);
+  }
+
+  for (unsigned network_id = 0; network_id < NumNetworks(); network_id++)
+  {
+    auto network = GetNetwork(network_id);
+    auto& name = network->name;
+    if (network->Type() == "Legacy")
+    {
+      add_legacy(name, static_cast<const LegacyNetwork::Specs&>(*network), true);
+    }
+    else if (network->Type() == "ReductionTree")
+    {
+      auto& tree = static_cast<const ReductionTreeNetwork::Specs&>(*network);
+      add(name + ".word-bits", tree.word_bits);
+      add(name + ".adder-energy", tree.adder_energy);
+      add(name + ".wire-energy", tree.wire_energy);
+      add(name + ".tile-width", tree.tile_width);
+    }
+    else if (network->Type() == "SimpleMulticast")
+    {
+      auto& multicast = static_cast<const SimpleMulticastNetwork::Specs&>(*network);
+      add(name + ".word-bits", multicast.word_bits);
+      add(name + ".tile-width", multicast.tile_width);
+      add(name + ".action-name", multicast.action_name);
+      add(name + ".multicast-factor-argument", multicast.multicast_factor_argument);
+      for (auto& action : SimpleMulticastNetwork::ERTEnergies(multicast))
+        add(name + ".ERT." + action.first, action.second);
+    }
+    else
+    {
+      add(name + ".type", network->Type());
+    }
+  }
+
+  return inputs;
+}
+
+//
+// Mutable accessors. The specs may be shared with other Specs objects (and
+// every Engine spec'ed from one), possibly on other threads, so always
+// replace them with a private copy before handing out a mutable pointer.
+//
+
+std::shared_ptr<LevelSpecs> Topology::Specs::MutableLevel(unsigned level_id)
+{
+  auto level_p = levels.at(level_id)->Clone();
+  levels.at(level_id) = level_p;
+  return level_p;
+}
+
+std::shared_ptr<NetworkSpecs> Topology::Specs::MutableNetwork(unsigned network_id)
+{
+  auto network_p = networks.at(network_id)->Clone();
+  networks.at(network_id) = network_p;
+  return network_p;
+}
+
 //--------------------------------------------//
 //                  Topology                  //
 //--------------------------------------------//
@@ -422,15 +638,15 @@ void Topology::Spec(const Topology::Specs& specs)
     // What type of level is this?
     if (level_specs->Type() == "BufferLevel")
     {
-      BufferLevel::Specs& specs = *std::static_pointer_cast<BufferLevel::Specs>(level_specs);
-      std::shared_ptr<BufferLevel> buffer_level = std::make_shared<BufferLevel>(specs);
+      auto buffer_specs = std::static_pointer_cast<const BufferLevel::Specs>(level_specs);
+      std::shared_ptr<BufferLevel> buffer_level = std::make_shared<BufferLevel>(buffer_specs);
       level = std::static_pointer_cast<Level>(buffer_level);
       levels_.push_back(level);
     }
     else if (level_specs->Type() == "ArithmeticUnits")
     {
-      ArithmeticUnits::Specs& specs = *std::static_pointer_cast<ArithmeticUnits::Specs>(level_specs);
-      std::shared_ptr<ArithmeticUnits> arithmetic_level = std::make_shared<ArithmeticUnits>(specs);
+      auto arithmetic_specs = std::static_pointer_cast<const ArithmeticUnits::Specs>(level_specs);
+      std::shared_ptr<ArithmeticUnits> arithmetic_level = std::make_shared<ArithmeticUnits>(arithmetic_specs);
       level = std::static_pointer_cast<Level>(arithmetic_level);
       levels_.push_back(level);
     }
@@ -626,6 +842,8 @@ void Topology::Spec(const Topology::Specs& specs)
 
   FloorPlan();
 
+  CompilePlan();
+
   // Compute area at spec-time (instead of at eval-time).
   // FIXME: area is being stored as a stat here, while it is stored as a spec
   // in individual modules. We need to be consistent.
@@ -678,12 +896,26 @@ Topology::Specs Topology::ParseSpecs(config::CompoundConfigNode storage,
 // arithmetic units, while other level are level 1+ with some buffer/storage units
 Topology::Specs Topology::ParseTreeSpecs(config::CompoundConfigNode designRoot)
 {
+  return ParseTreeSpecs(designRoot, Specs(), {});
+}
+
+Topology::Specs Topology::ParseTreeSpecs(config::CompoundConfigNode designRoot, const Specs& base,
+                                         const std::set<std::string>& changed_components)
+{
+  // Components parsed by base are left null here and filled in from base
+  // once the walk has placed them.
+  bool reuse = base.NumLevels() > 0;
+  auto parse = [&](const std::string& name)
+    {
+      return !reuse || changed_components.count(name) != 0;
+    };
+
   Specs specs;
   auto curNode = designRoot;
 
-  std::vector<std::shared_ptr<LevelSpecs>> storages; // serialize all storages
-  std::vector<std::shared_ptr<LegacyNetwork::Specs>> inferred_networks;
-  std::vector<std::shared_ptr<NetworkSpecs>> networks;
+  std::vector<std::shared_ptr<const LevelSpecs>> storages; // serialize all storages
+  std::vector<std::shared_ptr<const LegacyNetwork::Specs>> inferred_networks;
+  std::vector<std::shared_ptr<const NetworkSpecs>> networks;
 
   uint32_t multiplication = 1;
 
@@ -707,9 +939,9 @@ Topology::Specs Topology::ParseTreeSpecs(config::CompoundConfigNode designRoot)
       auto curLocal = curNode.lookup("local");
       assert(curLocal.isList());
 
-      std::vector<std::shared_ptr<LevelSpecs>> localStorages;
-      std::vector<std::shared_ptr<LegacyNetwork::Specs>> localInferredNetworks;
-      std::vector<std::shared_ptr<NetworkSpecs>> localNetworks;
+      std::vector<std::shared_ptr<const LevelSpecs>> localStorages;
+      std::vector<std::shared_ptr<const LegacyNetwork::Specs>> localInferredNetworks;
+      std::vector<std::shared_ptr<const NetworkSpecs>> localNetworks;
 
       for (int c = 0; c < curLocal.getLength() ; c++)
       {
@@ -721,6 +953,13 @@ Topology::Specs Topology::ParseTreeSpecs(config::CompoundConfigNode designRoot)
 
         if (isBufferClass(cClass))
         {
+          if (!parse(cName))
+          {
+            localStorages.push_back(nullptr);
+            localInferredNetworks.push_back(nullptr);
+            continue;
+          }
+
           // Create a buffer spec.
           auto level_specs_p = std::make_shared<BufferLevel::Specs>(BufferLevel::ParseSpecs(curLocal[c], nElements));
           localStorages.push_back(level_specs_p);
@@ -734,12 +973,16 @@ Topology::Specs Topology::ParseTreeSpecs(config::CompoundConfigNode designRoot)
         else if (isComputeClass(cClass))
         {
           // Create arithmetic.
-          auto level_specs_p = std::make_shared<ArithmeticUnits::Specs>(ArithmeticUnits::ParseSpecs(curLocal[c], nElements));
-          specs.AddLevel(0, std::static_pointer_cast<LevelSpecs>(level_specs_p));
+          std::shared_ptr<const LevelSpecs> level_specs_p;
+          if (parse(cName))
+            level_specs_p = std::make_shared<ArithmeticUnits::Specs>(ArithmeticUnits::ParseSpecs(curLocal[c], nElements));
+          else
+            level_specs_p = base.GetArithmeticLevel();
+          specs.AddLevel(0, level_specs_p);
         }
         else if (isNetworkClass(cClass))
         {
-          auto network_specs_p = NetworkFactory::ParseSpecs(curLocal[c], nElements);
+          auto network_specs_p = parse(cName) ? NetworkFactory::ParseSpecs(curLocal[c], nElements) : nullptr;
           localNetworks.push_back(network_specs_p);
         }
         else
@@ -755,13 +998,22 @@ Topology::Specs Topology::ParseTreeSpecs(config::CompoundConfigNode designRoot)
     }
   } // end while
 
+  if (reuse)
+  {
+    assert(storages.size() == base.NumStorageLevels() && networks.size() == base.NumNetworks());
+  }
+
   // Add storages to specs. We can do this only after walking the whole tree.
   for (uint32_t i = 0; i < storages.size(); i++)
   {
     auto storage = storages[i];
+    if (!storage)
+      storage = base.GetStorageLevel(i);
     specs.AddLevel(i, storage);
 
     auto inferred_network = inferred_networks[i];
+    if (!inferred_network)
+      inferred_network = base.GetInferredNetwork(i);
     specs.AddInferredNetwork(inferred_network);
   }
 
@@ -769,6 +1021,8 @@ Topology::Specs Topology::ParseTreeSpecs(config::CompoundConfigNode designRoot)
   for (unsigned i = 0; i < networks.size(); i++)
   {
     auto network = networks[i];
+    if (!network)
+      network = base.GetNetwork(i);
     specs.AddNetwork(network);
   }
 
@@ -827,11 +1081,11 @@ std::vector<EvalStatus> Topology::PreEvaluationCheck(const Mapping& mapping,
   auto masks = tiling::TransposeMasks(mapping.datatype_bypass_nest);
   auto working_set_sizes = analysis->GetWorkingSetSizes_LTW();
 
-  std::vector<EvalStatus> eval_status(NumLevels(), { .success = true, .fail_reason = "" });
-  for (unsigned storage_level_id = 0; storage_level_id < NumStorageLevels(); storage_level_id++)
+  std::vector<EvalStatus> eval_status(plan_.levels.size(), { .success = true, .fail_reason = "" });
+  for (unsigned storage_level_id = 0; storage_level_id < plan_.storage_levels.size(); storage_level_id++)
   {
-    auto level_id = specs_.StorageMap(storage_level_id);
-    auto s = GetStorageLevel(storage_level_id)->PreEvaluationCheck(
+    auto level_id = plan_.storage_level_ids[storage_level_id];
+    auto s = plan_.storage_levels[storage_level_id]->PreEvaluationCheck(
       working_set_sizes.at(storage_level_id), masks.at(storage_level_id),
       break_on_failure);
     eval_status.at(level_id) = s;
@@ -847,23 +1101,18 @@ std::vector<EvalStatus> Topology::Evaluate(Mapping& mapping,
                                            const problem::Workload& workload,
                                            bool break_on_failure)
 {
-  assert(is_specced_);
+  auto tiled_mapping = TileMapping(mapping, analysis);
+  return Evaluate(tiled_mapping, analysis, workload, break_on_failure);
+}
 
-  // ==================================================================
-  // TODO: connect buffers to networks based on bypass mask in mapping.
-  // ==================================================================
-  // for (unsigned storage_level_id = 0; storage_level_id < NumStorageLevels(); storage_level_id++)
-  // {
-  //   auto storage_level = GetStorageLevel(storage_level_id);
-  //   auto network = GetNetwork(storage_level_id);
+Topology::TiledMapping Topology::TileMapping(const Mapping& mapping,
+                                             analysis::NestAnalysis* analysis) const
+{
+  assert(is_specced_);
 
-  //   storage_level->ConnectNetwork(network);
-  //   network->ConnectBuffer(storage_level);
-  // }  
+  TiledMapping tiled_mapping;
+  tiled_mapping.distribution_supported = plan_.distribution_supported;
 
-  std::vector<EvalStatus> eval_status(NumLevels(), { .success = true, .fail_reason = "" });
-  bool success_accum = true;
-  
   // Compute working-set tile hierarchy for the nest.
   problem::PerDataSpace<std::vector<tiling::TileInfo>> ws_tiles;
   try
@@ -872,52 +1121,96 @@ std::vector<EvalStatus> Topology::Evaluate(Mapping& mapping,
   }
   catch (std::runtime_error& e)
   {
-    std::fill(eval_status.begin(), eval_status.end(),
-              EvalStatus({ .success = false, .fail_reason = "" }));
-    return eval_status;
+    return tiled_mapping;
   }
 
   // Ugh... FIXME.
-  auto compute_cycles = analysis->GetBodyInfo().accesses;
+  tiled_mapping.compute_cycles = analysis->GetBodyInfo().accesses;
 
-  // Create a mask indicating which levels support distributed multicast.
-  tiling::CompoundMaskNest distribution_supported;
-  for (unsigned pv = 0; pv < unsigned(problem::GetShape()->NumDataSpaces); pv++)
-  {
-    distribution_supported[pv].reset();
-    for (unsigned storage_level = 0; storage_level < NumStorageLevels(); storage_level++)
-    {
-      if (GetStorageLevel(storage_level)->GetReadNetwork()->DistributedMulticastSupported())
-      {
-        distribution_supported[pv].set(storage_level);
-      }
-    }
-  }
+  // The mask of levels that support distributed multicast is a property of the
+  // topology and is the same for every data space.
+  tiling::CompoundMaskNest distribution_supported(plan_.distribution_supported);
   
   // Collapse tiles into a specified number of tiling levels. The solutions are
   // received in a set of per-problem::Shape::DataSpaceID arrays.
-  auto collapsed_tiles = tiling::CollapseTiles(ws_tiles, specs_.NumStorageLevels(),
-                                               mapping.datatype_bypass_nest,
-                                               distribution_supported);
+  unsigned num_storage_levels = plan_.storage_levels.size();
+  tiling::CompoundTileNest collapsed_tiles;
+  {
+    TRACE_SCOPE("topology/collapse-tiles");
+    collapsed_tiles = tiling::CollapseTiles(ws_tiles, num_storage_levels,
+                                            mapping.datatype_bypass_nest,
+                                            distribution_supported);
+  }
 
   // Transpose the tiles into level->datatype structure.
-  auto tiles = tiling::TransposeTiles(collapsed_tiles);
-  assert(tiles.size() == NumStorageLevels());
+  tiled_mapping.tiles = tiling::TransposeTiles(collapsed_tiles);
+  assert(tiled_mapping.tiles.size() == num_storage_levels);
 
   // Transpose the datatype bypass nest into level->datatype structure.
-  auto keep_masks = tiling::TransposeMasks(mapping.datatype_bypass_nest);
-  assert(keep_masks.size() >= NumStorageLevels());
+  tiled_mapping.keep_masks = tiling::TransposeMasks(mapping.datatype_bypass_nest);
+  assert(tiled_mapping.keep_masks.size() >= num_storage_levels);
 
-  for (unsigned storage_level_id = 0; storage_level_id < NumStorageLevels(); storage_level_id++)
+  tiled_mapping.success = true;
+  return tiled_mapping;
+}
+
+bool Topology::IsCompatible(const TiledMapping& tiled_mapping) const
+{
+  return tiled_mapping.distribution_supported == plan_.distribution_supported &&
+    (!tiled_mapping.success || tiled_mapping.tiles.size() == plan_.storage_levels.size());
+}
+
+std::vector<EvalStatus> Topology::Evaluate(const TiledMapping& tiled_mapping,
+                                           analysis::NestAnalysis* analysis,
+                                           const problem::Workload& workload,
+                                           bool break_on_failure)
+{
+  assert(is_specced_);
+  assert(IsCompatible(tiled_mapping));
+  TRACE_SCOPE("topology/evaluate");
+
+  // ==================================================================
+  // TODO: connect buffers to networks based on bypass mask in mapping.
+  // ==================================================================
+  // for (unsigned storage_level_id = 0; storage_level_id < NumStorageLevels(); storage_level_id++)
+  // {
+  //   auto storage_level = GetStorageLevel(storage_level_id);
+  //   auto network = GetNetwork(storage_level_id);
+
+  //   storage_level->ConnectNetwork(network);
+  //   network->ConnectBuffer(storage_level);
+  // }  
+
+  std::vector<EvalStatus> eval_status(plan_.levels.size(), { .success = true, .fail_reason = "" });
+  bool success_accum = true;
+
+  // Networks are skipped below once evaluated, so that a network shared by
+  // several connections is evaluated only once per mapping. Clear what the
+  // previous mapping evaluated on this topology left behind.
+  for (auto network : plan_.networks)
+    network->Reset();
+
+  if (!tiled_mapping.success)
+  {
+    std::fill(eval_status.begin(), eval_status.end(),
+              EvalStatus({ .success = false, .fail_reason = "" }));
+    return eval_status;
+  }
+
+  auto& tiles = tiled_mapping.tiles;
+  auto& keep_masks = tiled_mapping.keep_masks;
+  auto compute_cycles = tiled_mapping.compute_cycles;
+  unsigned num_storage_levels = plan_.storage_levels.size();
+
+  for (unsigned storage_level_id = 0; storage_level_id < num_storage_levels; storage_level_id++)
   {
-    auto storage_level = GetStorageLevel(storage_level_id);
-    
     // Evaluate Loop Nest on hardware structures: calculate
     // primary statistics.
-    auto level_id = specs_.StorageMap(storage_level_id);
-    auto s = storage_level->Evaluate(tiles[storage_level_id], keep_masks[storage_level_id],
-                                     compute_cycles, break_on_failure);
-    eval_status.at(level_id) = s;
+    TRACE_SCOPE("topology/storage-level", storage_level_id);
+    auto level_id = plan_.storage_level_ids[storage_level_id];
+    auto s = plan_.storage_levels[storage_level_id]->Evaluate(tiles[storage_level_id], keep_masks[storage_level_id],
+                                                              compute_cycles, break_on_failure);
+    eval_status[level_id] = s;
     success_accum &= s.success;
 
     if (break_on_failure && !s.success)
@@ -925,29 +1218,27 @@ std::vector<EvalStatus> Topology::Evaluate(Mapping& mapping,
 
   }
 
-  unsigned int numConnections = NumStorageLevels();
-  for (uint32_t connection_id = 0; connection_id < numConnections; connection_id++)
+  for (unsigned connection_id = 0; connection_id < num_storage_levels; connection_id++)
   {
-    auto connection = connection_map_[connection_id];
-    auto rf_net = connection.read_fill_network;
-    EvalStatus s;
+    auto rf_net = plan_.read_fill_networks[connection_id];
+    EvalStatus s = { .success = true, .fail_reason = "" };
     if (!rf_net->IsEvaluated())
     {
       s = rf_net->Evaluate(tiles[connection_id], break_on_failure);
-      eval_status.at(connection_id).success &= s.success;
-      eval_status.at(connection_id).fail_reason += s.fail_reason;
+      eval_status[connection_id].success &= s.success;
+      eval_status[connection_id].fail_reason += s.fail_reason;
       success_accum &= s.success;
     }
 
     if (break_on_failure && !s.success)
       break;
 
-    auto du_net = connection.drain_update_network;
+    auto du_net = plan_.drain_update_networks[connection_id];
     if (!du_net->IsEvaluated())
     {
       s = du_net->Evaluate(tiles[connection_id], break_on_failure);
-      eval_status.at(connection_id).success &= s.success;
-      eval_status.at(connection_id).fail_reason += s.fail_reason;
+      eval_status[connection_id].success &= s.success;
+      eval_status[connection_id].fail_reason += s.fail_reason;
       success_accum &= s.success;
     }
 
@@ -957,14 +1248,15 @@ std::vector<EvalStatus> Topology::Evaluate(Mapping& mapping,
 
   if (!break_on_failure || success_accum)
   {
-    auto level_id = specs_.ArithmeticMap();
-    auto s = GetArithmeticLevel()->HackEvaluate(analysis, workload);
-    eval_status.at(level_id) = s;
+    TRACE_SCOPE("topology/arithmetic");
+    auto s = plan_.arithmetic_level->HackEvaluate(analysis, workload);
+    eval_status[plan_.arithmetic_level_id] = s;
     success_accum &= s.success;
   }
 
   if (!break_on_failure || success_accum)
   {
+    TRACE_SCOPE("topology/stats");
     ComputeStats();
   }
 
@@ -976,22 +1268,117 @@ std::vector<EvalStatus> Topology::Evaluate(Mapping& mapping,
   return eval_status;
 }
 
+//
+// Energy re-costing.
+//
+
+Topology::AccessProfile Topology::GetAccessProfile() const
+{
+  assert(is_evaluated_);
+
+  AccessProfile profile;
+  profile.actions.resize(NumLevels(), 0);
+  for (unsigned storage_level_id = 0; storage_level_id < NumStorageLevels(); storage_level_id++)
+  {
+    profile.actions.at(plan_.storage_level_ids.at(storage_level_id)) =
+      plan_.storage_levels.at(storage_level_id)->ActionCount();
+  }
+  profile.actions.at(plan_.arithmetic_level_id) = plan_.arithmetic_level->ActionCount();
+
+  // Wires of user-defined Legacy networks priced by the linear wire model.
+  profile.actions.resize(NumLevels() + NumNetworks(), 0);
+  for (unsigned network_id = 0; network_id < NumNetworks(); network_id++)
+  {
+    auto network_specs = specs_.GetNetwork(network_id);
+    if (network_specs->Type() != "Legacy" ||
+        !LegacyNetwork::LinearWireEnergy(static_cast<const LegacyNetwork::Specs&>(*network_specs)))
+      continue;
+    auto network = networks_.at(network_specs->name);
+    if (network->IsEvaluated())
+      profile.actions.at(NumLevels() + network_id) =
+        std::static_pointer_cast<LegacyNetwork>(network)->WireActionCount();
+  }
+
+  // Whatever the actions do not account for at the current per-action
+  // energies is, by construction, independent of them.
+  auto action_energies = specs_.ActionEnergies();
+  profile.fixed_energy = stats_.energy;
+  for (unsigned i = 0; i < profile.actions.size(); i++)
+  {
+    profile.fixed_energy -= profile.actions.at(i) * action_energies.at(i);
+  }
+  profile.fixed_inputs = specs_.FixedEnergyInputs();
+  return profile;
+}
+
+double Topology::Recost(const AccessProfile& profile, const Specs& specs)
+{
+  return Recost(profile, std::vector<Specs>{ specs }).front();
+}
+
+std::vector<double> Topology::Recost(const AccessProfile& profile, const std::vector<Specs>& specs)
+{
+  // Gather the per-action energies of every alternative into one
+  // (alternative x level) table and re-cost them all as a single
+  // matrix-vector product against the action counts.
+  unsigned num_actions = profile.actions.size();
+  std::vector<double> action_energies;
+  action_energies.reserve(specs.size() * num_actions);
+  for (auto& alternative : specs)
+  {
+    auto energies = alternative.ActionEnergies();
+    if (energies.size() != num_actions)
+    {
+      throw SpecsMismatch("cannot re-cost an access profile with " + std::to_string(num_actions) +
+                          " actions against an architecture with " + std::to_string(energies.size()));
+    }
+
+    // The fixed energy is only valid for the specs it was computed from.
+    auto inputs = alternative.FixedEnergyInputs();
+    auto mismatch = std::mismatch(inputs.begin(), inputs.end(),
+                                  profile.fixed_inputs.begin(), profile.fixed_inputs.end());
+    if (mismatch.first != inputs.end() || mismatch.second != profile.fixed_inputs.end())
+    {
+      std::string what = "cannot re-cost energy against an architecture that differs in ";
+      if (mismatch.first != inputs.end() && mismatch.second != profile.fixed_inputs.end() &&
+          mismatch.first->first == mismatch.second->first)
+        what += mismatch.first->first + " (" + mismatch.second->second + " vs. " + mismatch.first->second + ")";
+      else
+        what += "its networks";
+      throw SpecsMismatch(what + "; only buffer access, arithmetic op and linear wire energies are re-costed");
+    }
+
+    action_energies.insert(action_energies.end(), energies.begin(), energies.end());
+  }
+
+  std::vector<double> energy(specs.size(), profile.fixed_energy);
+  for (unsigned a = 0; a < specs.size(); a++)
+  {
+    const double* row = &action_energies[a * num_actions];
+    for (unsigned i = 0; i < num_actions; i++)
+    {
+      energy[a] += profile.actions[i] * row[i];
+    }
+  }
+  return energy;
+}
+
 void Topology::ComputeStats()
 {
   // Energy.
   double energy = 0;
-  for (auto level : levels_)
+  for (auto level : plan_.levels)
   {
     assert(level->Energy() >= 0);
     energy += level->Energy();
   }
 
-  for (auto& network: networks_)
+  for (auto network : plan_.networks)
   {
     //poan: Users might add a network to the arch but never connect/use it
     //      Such network should always have 0 energy though.
-    if (!network.second->IsEvaluated()) continue;
-    auto e = network.second->Energy();
+    if (!network->IsEvaluated()) continue;
+    auto e = network->Energy();
     assert(e >= 0);
     energy += e;
   }
@@ -1000,7 +1387,7 @@ void Topology::ComputeStats()
 
   // Cycles.
   std::uint64_t cycles = 0;
-  for (auto level : levels_)
+  for (auto level : plan_.levels)
   {
     cycles = std::max(cycles, level->Cycles());
   }
@@ -1008,39 +1395,81 @@ void Topology::ComputeStats()
 
   // Utilization.
   // FIXME.
-  stats_.utilization = GetArithmeticLevel()->IdealCycles() / stats_.cycles;
-
-  // Tile sizes.
-  stats_.tile_sizes.clear();
-  for (unsigned storage_level_id = 0; storage_level_id < NumStorageLevels(); storage_level_id++)
+  stats_.utilization = plan_.arithmetic_level->IdealCycles() / stats_.cycles;
+
+  // Tile sizes and utilized instances. The vectors are sized once and then
+  // overwritten in place on subsequent evaluations.
+  unsigned num_storage_levels = plan_.storage_levels.size();
+  unsigned num_data_spaces = problem::GetShape()->NumDataSpaces;
+  stats_.tile_sizes.resize(num_storage_levels);
+  stats_.utilized_instances.resize(num_storage_levels);
+  for (unsigned storage_level_id = 0; storage_level_id < num_storage_levels; storage_level_id++)
   {
-    problem::PerDataSpace<std::uint64_t> ts;
-    for (unsigned pvi = 0; pvi < problem::GetShape()->NumDataSpaces; pvi++)
+    auto storage_level = plan_.storage_levels[storage_level_id];
+    auto& ts = stats_.tile_sizes[storage_level_id];
+    auto& uc = stats_.utilized_instances[storage_level_id];
+    for (unsigned pvi = 0; pvi < num_data_spaces; pvi++)
     {
       auto pv = problem::Shape::DataSpaceID(pvi);
-      ts[pv] = GetStorageLevel(storage_level_id)->UtilizedCapacity(pv);
+      ts[pv] = storage_level->UtilizedCapacity(pv);
+      uc[pv] = storage_level->UtilizedInstances(pv);
     }
-    stats_.tile_sizes.push_back(ts);
   }
 
-  // Utilized instances.
-  stats_.utilized_instances.clear();
-  for (unsigned storage_level_id = 0; storage_level_id < NumStorageLevels(); storage_level_id++)
+  // MACCs.
+  stats_.maccs = plan_.arithmetic_level->MACCs();
+
+  // Last-level accesses.
+  stats_.last_level_accesses = plan_.storage_levels.back()->Accesses();
+}
+
+NetworkMemoCounters Topology::NetworkMemoStats() const
+{
+  NetworkMemoCounters counters;
+  for (auto network : plan_.networks)
+  {
+    if (auto multicast = dynamic_cast<const SimpleMulticastNetwork*>(network))
+      counters += multicast->MemoCounters();
+  }
+  return counters;
+}
+
+//
+// Compile the evaluation plan from the (already connected) levels and networks.
+//
+void Topology::CompilePlan()
+{
+  plan_ = EvalPlan();
+
+  for (auto& level : levels_)
   {
-    problem::PerDataSpace<std::uint64_t> uc;
-    for (unsigned pvi = 0; pvi < problem::GetShape()->NumDataSpaces; pvi++)
+    plan_.levels.push_back(level.get());
+  }
+
+  for (unsigned storage_level_id = 0; storage_level_id < specs_.NumStorageLevels(); storage_level_id++)
+  {
+    auto storage_level = GetStorageLevel(storage_level_id);
+    plan_.storage_levels.push_back(storage_level.get());
+    plan_.storage_level_ids.push_back(specs_.StorageMap(storage_level_id));
+
+    // Connection i links storage level i (as the outer level) with the level
+    // directly inside it.
+    plan_.read_fill_networks.push_back(storage_level->GetReadNetwork().get());
+    plan_.drain_update_networks.push_back(storage_level->GetUpdateNetwork().get());
+
+    if (storage_level->GetReadNetwork()->DistributedMulticastSupported())
     {
-      auto pv = problem::Shape::DataSpaceID(pvi);
-      uc[pv] = GetStorageLevel(storage_level_id)->UtilizedInstances(pv);
+      plan_.distribution_supported.set(storage_level_id);
     }
-    stats_.utilized_instances.push_back(uc);
   }
 
-  // MACCs.
-  stats_.maccs = GetArithmeticLevel()->MACCs();
+  plan_.arithmetic_level = GetArithmeticLevel().get();
+  plan_.arithmetic_level_id = specs_.ArithmeticMap();
 
-  // Last-level accesses.
-  stats_.last_level_accesses = GetStorageLevel(NumStorageLevels()-1)->Accesses();
+  for (auto& network : networks_)
+  {
+    plan_.networks.push_back(network.second.get());
+  }
 }
 
 //
@@ -30,6 +30,8 @@
 #include <iostream>
 #include <memory>
 #include <algorithm>
+#include <set>
+#include <stdexcept>
 
 #include "loop-analysis/tiling.hpp"
 #include "loop-analysis/nest-analysis.hpp"
@@ -38,9 +40,11 @@
 #include "model/level.hpp"
 #include "model/arithmetic.hpp"
 #include "model/buffer.hpp"
+#include "model/ert.hpp"
 #include "compound-config/compound-config.hpp"
 #include "network.hpp"
 #include "network-legacy.hpp"
+#include "network-memo.hpp"
 
 namespace model
 {
@@ -67,6 +71,15 @@ bool isBufferClass(std::string className);
 bool isComputeClass(std::string className);
 bool isNetworkClass(std::string className);
 
+// Thrown when specs, a compiled ERT or an access profile are applied to an
+// architecture they do not fit. Callers that cannot recover report what() as
+// an error and exit; the model server reports it back to the client.
+class SpecsMismatch : public std::runtime_error
+{
+ public:
+  explicit SpecsMismatch(const std::string& what) : std::runtime_error(what) {}
+};
+
 class Topology : public Module
 {
  public:
@@ -77,32 +90,25 @@ class Topology : public Module
   class Specs
   {
    private:
-    std::vector<std::shared_ptr<LevelSpecs>> levels;
-    std::vector<std::shared_ptr<LegacyNetwork::Specs>> inferred_networks;
-    std::vector<std::shared_ptr<NetworkSpecs>> networks;
+    std::vector<std::shared_ptr<const LevelSpecs>> levels;
+    std::vector<std::shared_ptr<const LegacyNetwork::Specs>> inferred_networks;
+    std::vector<std::shared_ptr<const NetworkSpecs>> networks;
     std::map<unsigned, unsigned> storage_map;
     unsigned arithmetic_map;
 
+    // Level and network specs are immutable once the architecture has been
+    // parsed, so copies of a Specs object share them (copying a Specs, and
+    // hence spec'ing an Engine, does not deep-copy the architecture). The
+    // few post-parse mutators (e.g., ParseAccelergyERT) replace whatever
+    // they modify with a private copy first.
+    std::shared_ptr<LevelSpecs> MutableLevel(unsigned level_id);
+    std::shared_ptr<NetworkSpecs> MutableNetwork(unsigned network_id);
+
    public:
-    // Constructors and assignment operators.
+    // Constructors and assignment operators. Copies are shallow, see above.
     Specs() = default;
     ~Specs() = default;
-
-    // We need an explicit deep-copy constructor because of shared_ptrs.
-    Specs(const Specs& other)
-    {
-      for (auto& level_p: other.levels)
-        levels.push_back(level_p->Clone());
-
-      for (auto& inferred_network_p: other.inferred_networks)
-        inferred_networks.push_back(std::make_shared<LegacyNetwork::Specs>(*inferred_network_p));
-
-      for (auto& network_p: other.networks)
-        networks.push_back(network_p->Clone());
-
-      storage_map = other.storage_map;
-      arithmetic_map = other.arithmetic_map;
-    }
+    Specs(const Specs& other) = default;
 
     // Copy-and-swap idiom.
     friend void swap(Specs& first, Specs& second)
@@ -129,19 +135,39 @@ class Topology : public Module
     std::vector<std::string> StorageLevelNames() const;
 
     void ParseAccelergyERT(config::CompoundConfigNode ert);
+    CompiledERT CompileAccelergyERT(config::CompoundConfigNode ert) const;
+    void ApplyAccelergyERT(const CompiledERT& compiled);
+
+    // The energies that ApplyAccelergyERT sets, read back from these specs:
+    // applying the result to specs parsed from the same architecture gives
+    // them the same energies, whichever ERT (if any) was applied to these.
+    CompiledERT AppliedERT() const;
 
-    void AddLevel(unsigned typed_id, std::shared_ptr<LevelSpecs> level_specs);
-    void AddInferredNetwork(std::shared_ptr<LegacyNetwork::Specs> specs);
-    void AddNetwork(std::shared_ptr<NetworkSpecs> specs);
+    void AddLevel(unsigned typed_id, std::shared_ptr<const LevelSpecs> level_specs);
+    void AddInferredNetwork(std::shared_ptr<const LegacyNetwork::Specs> specs);
+    void AddNetwork(std::shared_ptr<const NetworkSpecs> specs);
 
     unsigned StorageMap(unsigned i) const { return storage_map.at(i); }
     unsigned ArithmeticMap() const { return arithmetic_map; }
 
-    std::shared_ptr<LevelSpecs> GetLevel(unsigned level_id) const;
-    std::shared_ptr<BufferLevel::Specs> GetStorageLevel(unsigned storage_level_id) const;
-    std::shared_ptr<ArithmeticUnits::Specs> GetArithmeticLevel() const;
-    std::shared_ptr<LegacyNetwork::Specs> GetInferredNetwork(unsigned network_id) const;
-    std::shared_ptr<NetworkSpecs> GetNetwork(unsigned network_id) const;
+    std::shared_ptr<const LevelSpecs> GetLevel(unsigned level_id) const;
+    std::shared_ptr<const BufferLevel::Specs> GetStorageLevel(unsigned storage_level_id) const;
+    std::shared_ptr<const ArithmeticUnits::Specs> GetArithmeticLevel() const;
+    std::shared_ptr<const LegacyNetwork::Specs> GetInferredNetwork(unsigned network_id) const;
+    std::shared_ptr<const NetworkSpecs> GetNetwork(unsigned network_id) const;
+
+    // Per-action energies that re-costing scales access counts by: one per
+    // level (vector_access_energy for storage levels, energy_per_op for the
+    // arithmetic level), indexed by level id, then one per user-defined
+    // network (its wire energy per bit per mm if it is a Legacy network
+    // priced by the linear wire model, else 0), indexed by network id.
+    std::vector<double> ActionEnergies() const;
+
+    // The specs that every other part of the energy depends on (reduction,
+    // address generation, routers, wires priced by the internal model and
+    // the per-action energies of SimpleMulticast ERTs), as (name, value)
+    // pairs.
+    std::vector<std::pair<std::string, std::string>> FixedEnergyInputs() const;
   };
 
   //
@@ -158,6 +184,42 @@ class Topology : public Module
     std::uint64_t maccs;
     std::uint64_t last_level_accesses;
   };
+
+  //
+  // Access profile: the access counts of an evaluated mapping, condensed so
+  // that its energy can be re-costed against alternative per-action
+  // energies (e.g., a different ERT for the same architecture) without
+  // re-running any analysis:
+  //   Energy() == fixed_energy + sum_i actions[i] * ActionEnergies()[i]
+  // Energy that does not scale with these per-action energies (temporal and
+  // spatial reduction, address generation, routers, wires priced by the
+  // internal model and SimpleMulticast networks) is folded into fixed_energy.
+  // Recost() throws SpecsMismatch for alternatives that differ in any of the
+  // specs it was computed from (Specs::FixedEnergyInputs()).
+  //
+  struct AccessProfile
+  {
+    double fixed_energy = 0;
+    std::vector<double> actions; // Laid out as Specs::ActionEnergies().
+    std::vector<std::pair<std::string, std::string>> fixed_inputs;
+  };
+
+  //
+  // Tiled mapping: the working-set tiles of a mapping, collapsed onto the
+  // storage levels of a topology. These only depend on the mapping, the
+  // workload and the structure of the topology (number of storage levels and
+  // which of them support distributed multicast), not on sizes, bandwidths
+  // or energies, so one TiledMapping can be evaluated on any number of
+  // architecture variants that share the same structure.
+  //
+  struct TiledMapping
+  {
+    bool success = false;
+    tiling::NestOfCompoundTiles tiles;      // Indexed by storage level id.
+    tiling::NestOfCompoundMasks keep_masks; // Indexed by storage level id.
+    std::uint64_t compute_cycles = 0;
+    std::bitset<tiling::MaxTilingLevels> distribution_supported;
+  };
     
  private:
   std::vector<std::shared_ptr<Level>> levels_;
@@ -181,6 +243,24 @@ class Topology : public Module
   };
   std::map<unsigned, Connection> connection_map_;
 
+  // Evaluation plan. This is compiled once at Spec() time from the connected
+  // levels and networks, so that the per-mapping Evaluate() path walks flat
+  // arrays of raw pointers in evaluation order instead of re-resolving levels
+  // through shared_ptr casts and connections through std::map lookups.
+  struct EvalPlan
+  {
+    std::vector<Level*> levels;                  // Indexed by level id.
+    std::vector<BufferLevel*> storage_levels;    // Indexed by storage level id.
+    std::vector<unsigned> storage_level_ids;     // Storage level id -> level id.
+    ArithmeticUnits* arithmetic_level = nullptr;
+    unsigned arithmetic_level_id = 0;
+    std::vector<Network*> read_fill_networks;    // Indexed by connection id.
+    std::vector<Network*> drain_update_networks; // Indexed by connection id.
+    std::vector<Network*> networks;              // Same order as networks_.
+    std::bitset<tiling::MaxTilingLevels> distribution_supported;
+  };
+  EvalPlan plan_;
+
   std::map<unsigned, double> tile_area_;
 
   Specs specs_;
@@ -203,6 +283,7 @@ class Topology : public Module
   std::shared_ptr<BufferLevel> GetStorageLevel(unsigned storage_level_id) const;
   std::shared_ptr<ArithmeticUnits> GetArithmeticLevel() const;
   void FloorPlan();
+  void CompilePlan();
   void ComputeStats();
 
  public:
@@ -226,6 +307,9 @@ class Topology : public Module
     tile_area_ = other.tile_area_;
     specs_ = other.specs_;
     stats_ = other.stats_;
+
+    if (is_specced_)
+      CompilePlan();
   }
 
   // Copy-and-swap idiom.
@@ -237,6 +321,7 @@ class Topology : public Module
     swap(first.levels_, second.levels_);
     swap(first.networks_, second.networks_);
     swap(first.tile_area_, second.tile_area_);
+    swap(first.plan_, second.plan_);
     swap(first.specs_, second.specs_);
     swap(first.stats_, second.stats_);
   }
@@ -252,6 +337,11 @@ class Topology : public Module
   // the dynamic Spec() call later.
   static Specs ParseSpecs(config::CompoundConfigNode setting, config::CompoundConfigNode arithmetic_specs);
   static Specs ParseTreeSpecs(config::CompoundConfigNode designRoot);
+  // Parse a tree that differs from the one base was parsed from only in the
+  // attributes of the named components: only those are parsed again, the
+  // other level and network specs are shared with base.
+  static Specs ParseTreeSpecs(config::CompoundConfigNode designRoot, const Specs& base,
+                              const std::set<std::string>& changed_components);
   
   void Spec(const Specs& specs);
   unsigned NumLevels() const;
@@ -261,8 +351,32 @@ class Topology : public Module
   std::vector<EvalStatus> PreEvaluationCheck(const Mapping& mapping, analysis::NestAnalysis* analysis, bool break_on_failure);
   std::vector<EvalStatus> Evaluate(Mapping& mapping, analysis::NestAnalysis* analysis, const problem::Workload& workload, bool break_on_failure);
 
+  // Evaluation split into its architecture-independent and -dependent parts.
+  TiledMapping TileMapping(const Mapping& mapping, analysis::NestAnalysis* analysis) const;
+  bool IsCompatible(const TiledMapping& tiled_mapping) const;
+  std::vector<EvalStatus> Evaluate(const TiledMapping& tiled_mapping, analysis::NestAnalysis* analysis, const problem::Workload& workload, bool break_on_failure);
+
   const Stats& GetStats() const { return stats_; }
 
+  // Per-level stats of the most recent evaluation, indexed by level id.
+  double LevelEnergy(unsigned level_id) const { return plan_.levels.at(level_id)->Energy(); }
+  std::uint64_t LevelAccesses(unsigned level_id) const { return plan_.levels.at(level_id)->Accesses(); }
+
+  // Evaluated modules, for exporters that need more detail than Stats.
+  const BufferLevel& GetStorageLevelModule(unsigned storage_level_id) const { return *plan_.storage_levels.at(storage_level_id); }
+  const ArithmeticUnits& GetArithmeticLevelModule() const { return *plan_.arithmetic_level; }
+  unsigned NumNetworkModules() const { return plan_.networks.size(); }
+  bool DistributedMulticastSupported(unsigned storage_level_id) const { return plan_.distribution_supported.test(storage_level_id); }
+  const Network& GetNetworkModule(unsigned network_id) const { return *plan_.networks.at(network_id); }
+
+  // Hits and misses of the SimpleMulticast networks' evaluation memos, summed.
+  NetworkMemoCounters NetworkMemoStats() const;
+
+  // Energy re-costing.
+  AccessProfile GetAccessProfile() const;
+  static double Recost(const AccessProfile& profile, const Specs& specs);
+  static std::vector<double> Recost(const AccessProfile& profile, const std::vector<Specs>& specs);
+
   // FIXME: these stat-specific accessors are deprecated and only exist for
   // backwards-compatibility with some applications.
   double Energy() const { return stats_.energy; }
@@ -45,7 +45,7 @@ class RandomSearch : public SearchAlgorithm
   enum class State
   {
     Ready,
-    WaitingForStatus,
+    Exhausted, // Every distinct ID has been handed out (filter-revisits).
     Terminated
   };
   
@@ -61,6 +61,7 @@ class RandomSearch : public SearchAlgorithm
   
   // Live state.
   State state_;
+  uint128_t pending_reports_;
   mapspace::ID mapping_id_;
   uint128_t masking_space_covered_;
   uint128_t valid_mappings_;
@@ -91,6 +92,7 @@ class RandomSearch : public SearchAlgorithm
       SearchAlgorithm(),
       mapspace_(mapspace),
       state_(State::Ready),
+      pending_reports_(0),
       mapping_id_(mapspace->AllSizes()),
       masking_space_covered_(mapspace_->Size(mapspace::Dimension::DatatypeBypass)),
       valid_mappings_(0)
@@ -136,7 +138,7 @@ class RandomSearch : public SearchAlgorithm
   
   bool Next(mapspace::ID& mapping_id)
   {
-    if (state_ == State::Terminated)
+    if (state_ == State::Terminated || state_ == State::Exhausted)
     {
       return false;
     }
@@ -145,6 +147,20 @@ class RandomSearch : public SearchAlgorithm
     
     if (masking_space_covered_ == mapspace_->Size(mapspace::Dimension::DatatypeBypass))
     {
+      // The datatype-bypass sequence wraps around at every full roll, so a
+      // filtered search can draw at most this many distinct full rolls.
+      // Stop once they are all visited instead of rolling forever. This is
+      // not a termination: the IDs already handed out still count.
+      if (filter_revisits_ &&
+          uint128_t(visited_.size()) ==
+          mapspace_->Size(mapspace::Dimension::IndexFactorization) *
+          mapspace_->Size(mapspace::Dimension::LoopPermutation) *
+          mapspace_->Size(mapspace::Dimension::Spatial))
+      {
+        state_ = State::Exhausted;
+        return false;
+      }
+
       while (true)
       {
         Roll(mapspace::Dimension::IndexFactorization);
@@ -172,17 +188,30 @@ class RandomSearch : public SearchAlgorithm
       masking_space_covered_++;
     }
 
-    state_ = State::WaitingForStatus;
+    pending_reports_++;
     
     mapping_id = mapping_id_;
     return true;
   }
 
+  // Candidates are drawn independently of the outcomes of earlier ones,
+  // which only count towards termination.
+  bool UsesFeedback() const override
+  {
+    return false;
+  }
+
+  bool Terminated() const override
+  {
+    return state_ == State::Terminated;
+  }
+
   void Report(Status status, double cost = 0)
   {
     (void) cost;
     
-    assert(state_ == State::WaitingForStatus);
+    assert(pending_reports_ > 0);
+    pending_reports_--;
 
     if (status == Status::Success)
     {
@@ -200,10 +229,6 @@ class RandomSearch : public SearchAlgorithm
     {
       state_ = State::Terminated;
     }
-    else
-    {
-      state_ = State::Ready;
-    }
   }
 };
 
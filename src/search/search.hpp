@@ -36,7 +36,8 @@ enum class Status
 {
   Success,
   MappingConstructionFailure,
-  EvalFailure
+  EvalFailure,
+  Pruned // Not evaluated: it could not have beaten the incumbent.
 };
 
 class SearchAlgorithm
@@ -46,6 +47,18 @@ class SearchAlgorithm
   virtual ~SearchAlgorithm() {}
   virtual bool Next(mapspace::ID& mapping_id) = 0;
   virtual void Report(Status status, double cost = 0) = 0;
+
+  // Whether Next() depends on what earlier candidates Report()ed. A search
+  // that does not may hand out several candidates before their reports
+  // arrive, which must then be made in the same order.
+  virtual bool UsesFeedback() const { return true; }
+
+  // Whether Report() has stopped the search. Callers that draw candidates
+  // ahead of their reports must not use any drawn candidate once this turns
+  // true, since Next() would not have handed it out. A search that has run
+  // out of candidates (Next() returned false) is not terminated: the
+  // candidates it handed out before that are all still used.
+  virtual bool Terminated() const { return false; }
 };
 
 } // namespace search
@@ -1,10 +1,26 @@
+#pragma once
+
 #include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
 #include <cstring>
+#include <cstdlib>
+#include <functional>
 #include <stdexcept>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "model/topology.hpp"
+#include "compound-config/compound-config.hpp"
+#include "util/cache-file.hpp"
 
 namespace accelergy
 {
-  std::string exec(const char* cmd) {
+  inline std::string exec(const char* cmd) {
     std::string result = "";
     char buffer[128];
     FILE* pipe = popen("which accelergy", "r");
@@ -24,7 +40,7 @@ namespace accelergy
     return result;
   }
 
-  void invokeAccelergy(std::vector<std::string> input_files, std::string out_prefix, std::string out_dir) {
+  inline void invokeAccelergy(std::vector<std::string> input_files, std::string out_prefix, std::string out_dir) {
 #ifdef USE_ACCELERGY
     std::string accelergy_path = exec("which accelergy");
     // if `which` does not find it, we will try env
@@ -52,4 +68,240 @@ namespace accelergy
 #endif
     return;
   }
+
+  // Top-level config keys that only carry problem/mapping/mapper directives.
+  // Accelergy does not consume them, so they are left out of the ERT cache
+  // key and changing them does not invalidate the cached ERT.
+  inline bool isTimeloopOnlyKey(const std::string& key) {
+    static const std::vector<std::string> timeloop_only_keys = {
+      "problem", "mapping", "mapper", "mapspace", "mapspace_constraints",
+      "arch_constraints", "architecture_constraints", "model", "ERT" };
+    return std::find(timeloop_only_keys.begin(), timeloop_only_keys.end(), key) != timeloop_only_keys.end();
+  }
+
+  // Hash the input files that Accelergy consumes. Files that only carry
+  // Timeloop-only keys are skipped.
+  inline std::uint64_t hashInputs(const std::vector<std::string>& input_files) {
+    std::uint64_t hash = cache::HashBytes("");
+    for (auto& input_file : input_files) {
+      std::ifstream in(input_file, std::ios::binary);
+      std::stringstream buffer;
+      buffer << in.rdbuf();
+      std::string contents = buffer.str();
+
+      bool consumed = true;
+      try {
+        YAML::Node root = YAML::Load(contents);
+        if (root.IsMap()) {
+          consumed = false;
+          for (auto it = root.begin(); it != root.end(); it++) {
+            if (!isTimeloopOnlyKey(it->first.as<std::string>()))
+              consumed = true;
+          }
+        }
+      } catch (...) {
+        // Not YAML (e.g., libconfig); hash it to be safe.
+      }
+      if (consumed)
+        hash = cache::HashBytes(contents, hash);
+    }
+    return hash;
+  }
+
+  // The YAML text that Accelergy consumes from a config composed in memory
+  // out of several top-level maps (first node wins on a duplicate key, see
+  // config::CompoundConfig): all of their keys except the Timeloop-only ones.
+  inline std::string accelergyInputText(const std::vector<YAML::Node>& input_nodes) {
+    YAML::Node input(YAML::NodeType::Map);
+    for (auto& node : input_nodes) {
+      for (auto it = node.begin(); it != node.end(); it++) {
+        auto key = it->first.as<std::string>();
+        if (!isTimeloopOnlyKey(key) && !input[key])
+          input[key] = it->second;
+      }
+    }
+    return YAML::Dump(input);
+  }
+
+  // Path of the Accelergy executable that invokeAccelergy runs: the first
+  // one on $PATH, else the one in $ACCELERGYPATH; "" if there is none.
+  inline std::string accelergyPath() {
+    std::vector<std::string> dirs;
+    if (const char* path = std::getenv("PATH")) {
+      std::stringstream ss(path);
+      std::string dir;
+      while (std::getline(ss, dir, ':'))
+        dirs.push_back(dir);
+    }
+    if (const char* dir = std::getenv("ACCELERGYPATH"))
+      dirs.push_back(dir);
+    for (auto& dir : dirs) {
+      std::string candidate = dir + (!dir.empty() && dir.back() == '/' ? "" : "/") + "accelergy";
+      if (access(candidate.c_str(), X_OK) == 0)
+        return candidate;
+    }
+    return "";
+  }
+
+  // Hash of the path, size and modification time of every file under path
+  // (itself included).
+  inline std::uint64_t hashFileTree(const std::string& path, std::uint64_t hash) {
+    static thread_local std::uint64_t tree_hash;
+    tree_hash = hash;
+    auto visit = [](const char* file_path, const struct stat* file, int, struct FTW*) {
+      std::uint64_t fields[] = { std::uint64_t(file->st_size), std::uint64_t(file->st_mtim.tv_sec),
+                                 std::uint64_t(file->st_mtim.tv_nsec) };
+      tree_hash = cache::HashBytes(file_path, std::strlen(file_path) + 1, tree_hash);
+      tree_hash = cache::HashBytes(reinterpret_cast<const char*>(fields), sizeof(fields), tree_hash);
+      return 0;
+    };
+    hash = cache::HashBytes(path.c_str(), path.size() + 1, hash);
+    if (!path.empty() && nftw(path.c_str(), visit, 16, FTW_PHYS) == 0)
+      hash = tree_hash;
+    return hash;
+  }
+
+  // Hash of the Accelergy installation that compiles ERTs: its executable,
+  // its config file and the estimator and table plugins the config lists.
+  // Upgrading Accelergy, editing its config or changing a plugin's files
+  // changes the hash, and with it the ERT cache key.
+  inline std::uint64_t accelergyStamp() {
+    static const std::uint64_t stamp = []() {
+      std::uint64_t hash = hashFileTree(accelergyPath(), cache::kHashSeed);
+      if (const char* home = std::getenv("HOME")) {
+        std::string config_path = std::string(home) + "/.config/accelergy/accelergy_config.yaml";
+        std::ifstream in(config_path);
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        hash = cache::HashBytes(buffer.str(), hash);
+        try {
+          const YAML::Node config = YAML::Load(buffer.str());
+          for (auto key : { "estimator_plugins", "table_plugins" }) {
+            if (config.IsMap() && config[key] && config[key].IsSequence()) {
+              for (auto plugin : config[key]) {
+                if (plugin.IsScalar())
+                  hash = hashFileTree(plugin.Scalar(), hash);
+              }
+            }
+          }
+        } catch (...) {
+          // Not YAML; its text is in the hash.
+        }
+      }
+      return hash;
+    }();
+    return stamp;
+  }
+
+  // Accelergy's outputs next to the ERT (<out_prefix>.<suffix> in the output
+  // directory). The cache keeps a copy of each, so that a hit writes them
+  // too.
+  inline const std::vector<std::string>& accelergyOutputs() {
+    static const std::vector<std::string> outputs = {
+      "ERT.yaml", "ERT_summary.yaml", "ART.yaml", "ART_summary.yaml", "flattened_architecture.yaml" };
+    return outputs;
+  }
+
+  inline bool copyFile(const std::string& from, const std::string& to) {
+    std::ifstream in(from, std::ios::binary);
+    if (!in)
+      return false;
+    return cache::SaveAtomically(to, [&in](std::ostream& out) { out << in.rdbuf(); });
+  }
+
+  // Obtain the ERT for the inputs identified by input_hash, either from the
+  // compiled-ERT cache or by running Accelergy on the files returned by
+  // get_input_files, and apply it to the topology specs.
+  //
+  // The cache is opt-in (see cache::CacheDir): TIMELOOP_ERT_CACHE names its
+  // directory, "on" selecting $HOME/.cache/timeloop/ert. Entries are keyed on
+  // the inputs and on the Accelergy installation (see accelergyStamp).
+  inline void applyCachedERT(std::uint64_t input_hash, const std::function<std::vector<std::string>()>& get_input_files,
+                             std::string out_prefix, std::string out_dir,
+                             model::Topology::Specs& specs, bool verbose = true) {
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed_ms = [&start]() {
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    std::string cache_dir = cache::CacheDir("TIMELOOP_ERT_CACHE", "ert");
+    std::string cache_path;
+    if (!cache_dir.empty()) {
+      std::uint64_t key = cache::HashBytes(reinterpret_cast<const char*>(&input_hash), sizeof(input_hash),
+                                           accelergyStamp());
+      std::stringstream ss;
+      ss << cache_dir << "/" << std::hex << std::setw(16) << std::setfill('0') << key;
+      cache_path = ss.str();
+    }
+    std::string out_path = out_dir + "/" + out_prefix;
+
+    model::CompiledERT compiled;
+    if (!cache_path.empty() && compiled.Load(cache_path + ".ert") &&
+        compiled.level_energy.size() == specs.NumLevels() &&
+        compiled.network_ert.size() == specs.NumNetworks()) {
+      specs.ApplyAccelergyERT(compiled);
+      cache::MakeDirs(out_dir);
+      for (auto& output : accelergyOutputs())
+        copyFile(cache_path + "." + output, out_path + "." + output);
+      if (verbose)
+        std::cout << "ERT cache hit (" << cache_path << ".ert), loaded in "
+                  << elapsed_ms() << " ms." << std::endl;
+      return;
+    }
+
+    invokeAccelergy(get_input_files(), out_prefix, out_dir);
+    double accelergy_ms = elapsed_ms();
+
+    std::string ertPath = out_path + ".ERT.yaml";
+    config::CompoundConfig ertConfig(ertPath.c_str());
+    auto ert = ertConfig.getRoot().lookup("ERT");
+    if (verbose)
+      std::cout << "Generate Accelergy ERT (energy reference table) to replace internal energy model." << std::endl;
+    compiled = specs.CompileAccelergyERT(ert);
+    specs.ApplyAccelergyERT(compiled);
+
+    if (!cache_path.empty()) {
+      // The outputs are written before the compiled table, so that a hit
+      // finds them.
+      for (auto& output : accelergyOutputs())
+        copyFile(out_path + "." + output, cache_path + "." + output);
+      if (!compiled.Save(cache_path + ".ert"))
+        std::cerr << "WARNING: could not write ERT cache " << cache_path << ".ert" << std::endl;
+    }
+    if (verbose)
+      std::cout << "ERT cache miss, Accelergy took " << accelergy_ms << " ms, total "
+                << elapsed_ms() << " ms." << std::endl;
+  }
+
+  inline void applyCachedERT(std::vector<std::string> input_files, std::string out_prefix, std::string out_dir,
+                             model::Topology::Specs& specs, bool verbose = true) {
+    applyCachedERT(hashInputs(input_files), [&input_files]() { return input_files; },
+                   out_prefix, out_dir, specs, verbose);
+  }
+
+  // Obtain the ERT for a config. A config composed in memory (e.g., a
+  // design-space point) has no input files: its cache key is the composed
+  // YAML that Accelergy would consume, and on a cache miss Accelergy runs on
+  // a copy of that YAML written to <out_dir>/<out_prefix>.accelergy.yaml.
+  inline void applyCachedERT(config::CompoundConfig& config, std::string out_prefix, std::string out_dir,
+                             model::Topology::Specs& specs, bool verbose = true) {
+    if (!config.inFiles.empty()) {
+      applyCachedERT(config.inFiles, out_prefix, out_dir, specs, verbose);
+      return;
+    }
+
+    std::string input_text = accelergyInputText(config.inNodes);
+    auto write_input_file = [&]() {
+      cache::MakeDirs(out_dir);
+      std::string input_path = out_dir + "/" + out_prefix + ".accelergy.yaml";
+      std::ofstream input_file(input_path);
+      input_file << input_text << std::endl;
+      if (!input_file) {
+        std::cerr << "ERROR: could not write Accelergy input " << input_path << std::endl;
+        exit(1);
+      }
+      return std::vector<std::string>{ input_path };
+    };
+    applyCachedERT(cache::HashBytes(input_text), write_input_file, out_prefix, out_dir, specs, verbose);
+  }
 } // namespace accelergy
@@ -0,0 +1,99 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <cstdlib>
+#include <new>
+
+#include "alloc-tracker.hpp"
+
+// Built with ALLOC_TRACKING_OPERATORS_ONLY, this file provides just the
+// counting operator new and delete below, for applications that count
+// allocations even when the library does not (timeloop-bench links such a
+// copy; see src/SConscript). They call into the library's alloc::Record().
+#ifndef ALLOC_TRACKING_OPERATORS_ONLY
+
+namespace alloc
+{
+
+// Zero-initialized, so it is usable from operator new at any point of a
+// thread's life.
+static thread_local Counts thread_counts;
+
+Counts ThreadCounts()
+{
+  return thread_counts;
+}
+
+void Record(std::size_t bytes)
+{
+  thread_counts.allocations++;
+  thread_counts.bytes += bytes;
+}
+
+} // namespace alloc
+
+#endif
+
+#if defined(USE_ALLOC_TRACKING) != defined(ALLOC_TRACKING_OPERATORS_ONLY)
+
+// Kept out of line so that the compiler does not pair the malloc() and free()
+// below with inlined news and deletes (-Wmismatched-new-delete).
+__attribute__((noinline)) static void* CountedAllocate(std::size_t size) noexcept
+{
+  alloc::Record(size);
+  return std::malloc(size ? size : 1);
+}
+
+__attribute__((noinline)) static void CountedFree(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void* operator new(std::size_t size)
+{
+  if (void* ptr = CountedAllocate(size))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return CountedAllocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return CountedAllocate(size); }
+
+void operator delete(void* ptr) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr) noexcept { CountedFree(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { CountedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { CountedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { CountedFree(ptr); }
+
+#endif
@@ -0,0 +1,84 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//--------------------------------------------//
+//             Allocation tracking            //
+//--------------------------------------------//
+
+// Per-thread counts of heap allocations. Building with
+// `scons --alloc-tracking` (USE_ALLOC_TRACKING) replaces the global operator
+// new and delete with versions that count every allocation made by the
+// calling thread; callers take the difference of two ThreadCounts() to
+// attribute allocations to a region of code, e.g., one stage of the mapper
+// loop or one Engine::Evaluate() call. Without it the counts stay at zero,
+// unless an application links the counting operators on its own (as
+// timeloop-bench does, see util/alloc-tracker.cpp).
+
+namespace alloc
+{
+
+struct Counts
+{
+  std::uint64_t allocations = 0;
+  std::uint64_t bytes = 0;
+
+  Counts& operator+=(const Counts& other)
+  {
+    allocations += other.allocations;
+    bytes += other.bytes;
+    return *this;
+  }
+
+  Counts operator-(const Counts& other) const
+  {
+    Counts diff;
+    diff.allocations = allocations - other.allocations;
+    diff.bytes = bytes - other.bytes;
+    return diff;
+  }
+};
+
+// Whether this build counts allocations.
+#ifdef USE_ALLOC_TRACKING
+constexpr bool kEnabled = true;
+#else
+constexpr bool kEnabled = false;
+#endif
+
+// Allocations made by the calling thread so far.
+Counts ThreadCounts();
+
+// Count one allocation of the given size on the calling thread.
+void Record(std::size_t bytes);
+
+} // namespace alloc
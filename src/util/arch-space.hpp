@@ -27,17 +27,24 @@
 
 #pragma once
 
+#include <cassert>
 #include <fstream>
 #include <iomanip>
+#include <iostream>
+#include <cmath>
+#include <limits>
+#include <algorithm>
 
 #include "compound-config/compound-config.hpp"
 
 
+#include <map>
+#include <set>
 #include <string>
 #include <sstream>
 #include <vector>
 
-std::vector<std::string> split(const std::string &s, char delim) {
+inline std::vector<std::string> split(const std::string &s, char delim) {
   std::stringstream ss(s);
   std::string item;
   std::vector<std::string> elems;
@@ -48,84 +55,152 @@ std::vector<std::string> split(const std::string &s, char delim) {
   return elems;
 }
 
-YAML::Node YAMLRecursiveSearch(YAML::Node node, std::string key, std::string indent)
+// Find the component named key in an architecture tree, searching each
+// level's "local" list and then its "subtree". On success, path holds the
+// keys and sequence indices that lead to it from node (see YAMLNodeAt).
+// The arch sweep finds each swept component once, in the base YAML, and
+// follows its path in every copy, instead of searching every copy.
+inline bool YAMLSearchPath(const YAML::Node& node, const std::string& key, std::vector<std::string>& path)
 {
-  //std::cout << indent << "Looking at node: (type " << node.Type() << ")"<< std::endl;
-  //std::cout << node << std::endl;
-
-  switch (node.Type()) {
-    case YAML::NodeType::Map: // ...
-      //std::cout << indent << "Found Map: " << std::endl;
-
-      //if scalar, key it leaf node or not
-      //if leaf, check if name matches the key
-      if (auto next = node["name"]) 
+  if (node.IsMap())
+  {
+    if (auto name = node["name"])
+    {
+      if (name.IsScalar() && key == name.Scalar())
+        return true;
+    }
+    for (std::string branch : { "local", "subtree" })
+    {
+      if (auto next = node[branch])
       {
-        //std::cout << indent << "Found Name: " << next.as<std::string>() << std::endl;
-        //if our search key matches, we found it!
-        if (key.compare(next.as<std::string>()) == 0)
-        {
-          //std::cout << indent << "Success! Returning Node " << std::endl;
-          return node;
-        }
+        path.push_back(branch);
+        if (YAMLSearchPath(next, key, path))
+          return true;
+        path.pop_back();
       }
-      
-      if (auto next = node["local"]){
-        //std::cout << indent << "Searching Local Branch" << std::endl;
+    }
+  }
+  else if (node.IsSequence())
+  {
+    for (std::size_t i = 0; i < node.size(); i++)
+    {
+      path.push_back(std::to_string(i));
+      if (YAMLSearchPath(node[i], key, path))
+        return true;
+      path.pop_back();
+    }
+  }
+  return false;
+}
 
-        auto result = YAMLRecursiveSearch(next, key, indent+"    ");
-        //std::cout << indent << "Searching Local Branch (Complete)" << std::endl;        
-        if (result.IsNull() == false)
-        {
-          std::cout << indent << "Returning Node" << std::endl;        
-          return result;
-        }
-      }
+// The node at the end of a path found by YAMLSearchPath.
+inline YAML::Node YAMLNodeAt(YAML::Node node, const std::vector<std::string>& path)
+{
+  for (auto& step : path)
+  {
+    if (node.IsSequence())
+      node.reset(node[std::stoul(step)]);
+    else
+      node.reset(node[step]);
+  }
+  return node;
+}
 
-      if (auto next = node["subtree"]){
-        //std::cout << indent << "Searching Subtree Branch" << std::endl;
-        auto result = YAMLRecursiveSearch(next, key, indent+"    ");
-        //std::cout << indent << "Searching Subtree Branch Complete" << std::endl;
-        if (result.IsNull() == false)
-        {
-          //std::cout << indent << "Returning Node" << std::endl;        
-          return result;
-        }
+inline bool YAMLEqual(const YAML::Node& a, const YAML::Node& b)
+{
+  if (a.Type() != b.Type())
+    return false;
+
+  switch (a.Type()) {
+    case YAML::NodeType::Scalar:
+      return a.Scalar() == b.Scalar();
+    case YAML::NodeType::Sequence:
+      if (a.size() != b.size())
+        return false;
+      for (std::size_t i = 0; i < a.size(); i++)
+        if (!YAMLEqual(a[i], b[i]))
+          return false;
+      return true;
+    case YAML::NodeType::Map:
+      if (a.size() != b.size())
+        return false;
+      for (auto it = a.begin(); it != a.end(); ++it)
+      {
+        auto other = b[it->first.as<std::string>()];
+        if (!other || !YAMLEqual(it->second, other))
+          return false;
       }
-      //std::cout << indent << "Found Map (complete): " << std::endl;
-
-      //we didn't find it in this subtree! return a null YAML::Node
-      return YAML::Node(YAML::NodeType::Null);
+      return true;
+    default:
+      return true;
+  }
+}
 
-    case YAML::NodeType::Sequence: // ...
+// Find the components (maps with a name and a class) whose attributes differ
+// between two architecture trees, and the names of the differing attributes.
+// Returns false if the trees also differ anywhere else, e.g., in their
+// structure or in a component's name or class.
+inline bool DiffComponentAttributes(const YAML::Node& base, const YAML::Node& variant,
+                                    std::map<std::string, std::set<std::string>>& changed)
+{
+  if (base.Type() != variant.Type())
+    return false;
 
-      //std::cout << indent << "Found Sequence" << std::endl;
-      for (YAML::iterator it = node.begin(); it != node.end(); ++it) {
-        //std::cout << indent << "Looking at sequence item" << std::endl;
-        const YAML::Node& next = *it;
-        auto result = YAMLRecursiveSearch(next, key, indent+"    ");
-        //std::cout << indent << "Looking at sequence item complete" << std::endl;
-        if (result.IsNull() == false)
-        {
-          //std::cout << indent << "Returning Node" << std::endl;        
-          return result;
-        }
+  if (base.IsMap() && base["name"] && base["class"])
+  {
+    for (auto it = base.begin(); it != base.end(); ++it)
+    {
+      auto key = it->first.as<std::string>();
+      if (key != "attributes" && (!variant[key] || !YAMLEqual(it->second, variant[key])))
+        return false;
+    }
+    if (variant.size() != base.size() || !base["attributes"] != !variant["attributes"])
+      return false;
+    if (!base["attributes"])
+      return true;
+
+    auto base_attributes = base["attributes"];
+    auto variant_attributes = variant["attributes"];
+    if (!base_attributes.IsMap() || !variant_attributes.IsMap())
+      return YAMLEqual(base_attributes, variant_attributes);
+
+    auto name = base["name"].as<std::string>();
+    for (auto it = base_attributes.begin(); it != base_attributes.end(); ++it)
+    {
+      auto key = it->first.as<std::string>();
+      if (!variant_attributes[key] || !YAMLEqual(it->second, variant_attributes[key]))
+        changed[name].insert(key);
+    }
+    for (auto it = variant_attributes.begin(); it != variant_attributes.end(); ++it)
+    {
+      auto key = it->first.as<std::string>();
+      if (!base_attributes[key])
+        changed[name].insert(key);
+    }
+    return true;
+  }
 
+  switch (base.Type()) {
+    case YAML::NodeType::Sequence:
+      if (base.size() != variant.size())
+        return false;
+      for (std::size_t i = 0; i < base.size(); i++)
+        if (!DiffComponentAttributes(base[i], variant[i], changed))
+          return false;
+      return true;
+    case YAML::NodeType::Map:
+      if (base.size() != variant.size())
+        return false;
+      for (auto it = base.begin(); it != base.end(); ++it)
+      {
+        auto other = variant[it->first.as<std::string>()];
+        if (!other || !DiffComponentAttributes(it->second, other, changed))
+          return false;
       }
-      return YAML::Node(YAML::NodeType::Null);
-    case YAML::NodeType::Scalar: // ...
-      //std::cout << indent << "Found Scalar: " << std::endl;      
-      return YAML::Node(YAML::NodeType::Null);
-    case YAML::NodeType::Null: // ...
-      //std::cout << indent << "Found Null: " << std::endl;      
-      return YAML::Node(YAML::NodeType::Null);
-    case YAML::NodeType::Undefined: // ...
-      //std::cout << indent << "Found Undefined: " << std::endl;            
-      return YAML::Node(YAML::NodeType::Null);
+      return true;
+    default:
+      return YAMLEqual(base, variant);
   }
-
-  return YAML::Node(YAML::NodeType::Null);
-
 }
 
 class ArchSweepNode
@@ -147,9 +222,24 @@ class ArchSpaceNode
  public:
   std::string name_; //descriptive name
   YAML::Node yaml_; //text version of YAML/ should be YAML
+  std::vector<double> sweep_coords_; //log2 of each swept value (sweeps only)
 
   ArchSpaceNode() {}  
   ArchSpaceNode(std::string n, YAML::Node a) : name_(n), yaml_(a) {}
+
+  // Distance between two points of the same sweep: the summed |log2| ratio
+  // of their swept values, i.e. the number of doublings separating them.
+  // Points that are not from a common sweep are infinitely far apart.
+  double Distance(const ArchSpaceNode& other) const
+  {
+    if (sweep_coords_.empty() || sweep_coords_.size() != other.sweep_coords_.size())
+      return std::numeric_limits<double>::infinity();
+
+    double distance = 0;
+    for (std::size_t i = 0; i < sweep_coords_.size(); i++)
+      distance += std::abs(sweep_coords_[i] - other.sweep_coords_[i]);
+    return distance;
+  }
 };
 
 
@@ -220,31 +310,40 @@ class ArchSpace
       space.push_back(ArchSweepNode(name, min, max, step));
     }
 
+    //load base yaml once, then modify a copy of it using the sweep nodes
+    std::ifstream fin;
+    fin.open(base_yaml_filename);
+    YAML::Node base_yaml = YAML::Load(fin);
+
+    //locate the swept components once, every copy has them at the same path
+    std::vector<std::vector<std::string>> component_paths(space.size());
+    std::vector<bool> component_found(space.size());
+    for (std::size_t i = 0; i < space.size(); i++)
+    {
+      std::string component = split(space[i].name_, '.')[0];
+      component_found[i] = YAMLSearchPath(base_yaml["architecture"], component, component_paths[i]);
+    }
+
     //iterate through the space
     bool done = false;
     while(!done)
     {
 
-      std::cout << "Generating Architecture" << std::endl;
-
-      //load base yaml, then modify using the sweep nodes
-      std::ifstream fin;
-      fin.open(base_yaml_filename);
-      YAML::Node yaml = YAML::Load(fin);
+      YAML::Node yaml = YAML::Clone(base_yaml);
       //std::cout << "YAML (before) " << yaml << std::endl;
       
       std::string config_append; //the specific arch details of the arch instance
+      std::vector<double> coords;
       for (std::size_t i = 0; i < space.size(); i++){
         int val = space[i].val_curr_;
         config_append += "." + space[i].name_ + "." + std::to_string(val); 
+        coords.push_back(std::log2(double(std::max(val, 1))));
 
         std::vector<std::string> yaml_path = split(space[i].name_, '.');
 
-        std::cout << "Searching for module: " << yaml_path[0] << std::endl;        
-        auto active = YAMLRecursiveSearch(yaml["architecture"], yaml_path[0], "");
-        if (active.IsNull() == false)
+        if (component_found[i])
         {
-          std::cout << "Updating node: \n " << active << std::endl;
+          auto active = YAMLNodeAt(yaml["architecture"], component_paths[i]);
           active["attributes"][yaml_path[1]] = val;
         }
         else {
@@ -284,10 +383,9 @@ class ArchSpace
       //std::cout << "YAML (after) " << yaml << std::endl;
 
       ArchSpaceNode new_arch = ArchSpaceNode(base_yaml_filename + config_append, yaml);
+      new_arch.sweep_coords_ = coords;
       architectures_.push_back(new_arch);
 
-      std::cout << "Increment to next architecture spec." << std::endl;
-
       //increment (step through) the sweep space
       unsigned int i = 0;
       while (i < space.size())
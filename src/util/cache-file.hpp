@@ -0,0 +1,167 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//--------------------------------------------//
+//              On-disk caches                //
+//--------------------------------------------//
+
+// Helpers shared by the binary caches kept on disk: compiled ERTs
+// (model/ert.hpp), architecture specs (model/spec-cache.hpp) and binary
+// stats (model/binary-stats.hpp). Files are written in native endianness,
+// they are local caches, not an interchange format.
+
+namespace cache
+{
+
+// FNV-1a 64.
+constexpr std::uint64_t kHashSeed = 0xcbf29ce484222325ULL;
+
+inline std::uint64_t HashBytes(const char* data, std::size_t size, std::uint64_t hash = kHashSeed)
+{
+  for (std::size_t i = 0; i < size; i++)
+  {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+inline std::uint64_t HashBytes(const std::string& bytes, std::uint64_t hash = kHashSeed)
+{
+  return HashBytes(bytes.data(), bytes.size(), hash);
+}
+
+// mkdir -p.
+inline void MakeDirs(const std::string& dir)
+{
+  for (std::size_t pos = dir.find('/', 1); ; pos = dir.find('/', pos + 1))
+  {
+    mkdir(dir.substr(0, pos).c_str(), 0755);
+    if (pos == std::string::npos)
+      break;
+  }
+}
+
+// Cache directory named by the environment variable env_var, created if
+// needed. Caches are opt-in: "" (disabled) if the variable is unset, empty
+// or "off"; "on" selects $HOME/.cache/timeloop/<name>.
+inline std::string CacheDir(const char* env_var, const std::string& name)
+{
+  const char* env = std::getenv(env_var);
+  if (!env || !*env || std::strcmp(env, "off") == 0)
+    return "";
+  std::string dir = env;
+  if (dir == "on")
+  {
+    const char* home = std::getenv("HOME");
+    if (!home)
+      return "";
+    dir = std::string(home) + "/.cache/timeloop/" + name;
+  }
+  MakeDirs(dir);
+  return dir;
+}
+
+template<class T>
+void Write(std::ostream& out, const T& value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+inline void Write(std::ostream& out, const std::string& value)
+{
+  Write(out, std::uint32_t(value.size()));
+  out.write(value.data(), value.size());
+}
+
+template<class T>
+bool Read(std::istream& in, T& value)
+{
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return bool(in);
+}
+
+inline bool Read(std::istream& in, std::string& value)
+{
+  std::uint32_t length;
+  if (!Read(in, length))
+    return false;
+  // Grow with the data actually read, so that a corrupt length fails at the
+  // end of the stream rather than allocating up to 4 GB.
+  value.clear();
+  char chunk[4096];
+  while (length > 0)
+  {
+    std::uint32_t count = std::min<std::uint32_t>(length, sizeof(chunk));
+    if (!in.read(chunk, count))
+      return false;
+    value.append(chunk, count);
+    length -= count;
+  }
+  return true;
+}
+
+// Write a file through write_contents to a temporary file and rename it
+// into place, so that concurrent readers never see a partially-written
+// file. The temporary file is private to this call, since several
+// processes, and several DSE points within one process, may write the same
+// file at once.
+inline bool SaveAtomically(const std::string& path, const std::function<void(std::ostream&)>& write_contents)
+{
+  static std::atomic<unsigned> num_saves(0);
+  std::string tmp_path = path + ".tmp." + std::to_string(getpid()) + "." + std::to_string(num_saves++);
+  std::ofstream out(tmp_path, std::ios::binary);
+  if (!out)
+    return false;
+
+  write_contents(out);
+
+  out.close();
+  if (!out || std::rename(tmp_path.c_str(), path.c_str()) != 0)
+  {
+    std::remove(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+} // namespace cache
@@ -30,6 +30,24 @@
 #include <algorithm>
 #include <limits>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Default inline capacity of a DynamicArray. Almost every instance in
+// Timeloop is a PerDataSpace or PerProblemDimension, which hold 3-8 elements
+// for every workload we have seen so far, so up to 8 word-sized elements
+// (counts, flags, factors) are kept inline. Larger elements (e.g., per-data-
+// space tile info) stay on the heap, so that they do not bloat every object
+// that embeds an array of them.
+template<class T>
+struct DynamicArrayInlineCapacity
+{
+  static constexpr std::size_t value = sizeof(T) <= sizeof(std::uint64_t) ? 8 : 0;
+};
 
 // This is meant to be a drop-in replacement for std::array
 // that does not need a statically constant size,
@@ -39,58 +57,167 @@
 // after constructing it, but std::vector<bool> is an abomination that prevents
 // generic programming. This class avoids the problems of std::vector<bool>.
 // Note that this means it does *not* store bitmaps efficiently.
-template<class T>
+//
+// A fixed-size (at construction) array with a small inline buffer. Arrays of
+// up to InlineCapacity elements live entirely inside the object and never
+// touch the heap; larger arrays fall back to a heap allocation.
+template<class T, std::size_t InlineCapacity = DynamicArrayInlineCapacity<T>::value>
 class DynamicArray
 {
  private:
   size_t size_;
   T* data_;
+  typename std::aligned_storage<(InlineCapacity > 0 ? InlineCapacity * sizeof(T) : 1), alignof(T)>::type inline_;
+
+  bool IsInline() const
+  {
+    return data_ == reinterpret_cast<const T*>(&inline_);
+  }
+
+  // Point data_ at storage for size_ elements. Elements are *not* constructed.
+  void Allocate()
+  {
+    if (size_ <= InlineCapacity)
+      data_ = reinterpret_cast<T*>(&inline_);
+    else
+      data_ = static_cast<T*>(::operator new(size_ * sizeof(T)));
+  }
+
+  // Destroy all elements and release heap storage (if any).
+  void Release()
+  {
+    for (size_t i = 0; i < size_; i++)
+      data_[i].~T();
+    if (!IsInline())
+      ::operator delete(data_);
+    data_ = reinterpret_cast<T*>(&inline_);
+  }
+
+  // Default-initialize elements, i.e., same semantics as new T[size].
+  void DefaultConstruct()
+  {
+    for (size_t i = 0; i < size_; i++)
+      new (data_ + i) T;
+  }
+
+  template<class InputIt>
+  void CopyConstruct(InputIt first)
+  {
+    for (size_t i = 0; i < size_; i++, first++)
+      new (data_ + i) T(*first);
+  }
+
+  // Take over other's contents. Heap buffers are stolen, inline elements
+  // are moved one by one. Assumes *this holds no elements.
+  void MoveFrom(DynamicArray& other)
+  {
+    size_ = other.size_;
+    if (other.IsInline())
+    {
+      data_ = reinterpret_cast<T*>(&inline_);
+      for (size_t i = 0; i < size_; i++)
+        new (data_ + i) T(std::move(other.data_[i]));
+    }
+    else
+    {
+      data_ = other.data_;
+      other.data_ = reinterpret_cast<T*>(&other.inline_);
+      other.size_ = 0;
+    }
+  }
 
  public:
   DynamicArray(size_t size) :
-    size_(size),
-    data_(new T[size])
+    size_(size)
   {
+    Allocate();
+    DefaultConstruct();
   }
 
   DynamicArray(const DynamicArray& other) :
-    size_(other.size_),
-    data_(new T[size_])
+    size_(other.size_)
+  {
+    Allocate();
+    CopyConstruct(other.begin());
+  }
+
+  DynamicArray(DynamicArray&& other) noexcept
   {
-    std::copy(other.begin(), other.end(), begin());
+    MoveFrom(other);
   }
 
   DynamicArray(std::initializer_list<T> l) :
-    size_(l.size()),
-    data_(new T[size_])
+    size_(l.size())
   {
-    std::copy(l.begin(), l.end(), begin());
+    Allocate();
+    CopyConstruct(l.begin());
   }
 
-  // This is the copy-and-swap idiom.
-  DynamicArray<T>& operator=(DynamicArray other) {
-    swap(*this, other);
+  // Assignment between equally-sized arrays (the common case, since sizes
+  // are fixed by the problem shape) is done in place without re-allocating.
+  DynamicArray& operator=(const DynamicArray& other)
+  {
+    if (this == &other)
+      return *this;
+
+    if (size_ == other.size_)
+    {
+      std::copy(other.begin(), other.end(), begin());
+    }
+    else
+    {
+      Release();
+      size_ = other.size_;
+      Allocate();
+      CopyConstruct(other.begin());
+    }
+    return *this;
+  }
+
+  DynamicArray& operator=(DynamicArray&& other) noexcept
+  {
+    if (this == &other)
+      return *this;
+
+    if (size_ == other.size_ && other.IsInline())
+    {
+      std::move(other.begin(), other.end(), begin());
+    }
+    else
+    {
+      Release();
+      MoveFrom(other);
+    }
     return *this;
   }
 
   friend void swap(DynamicArray& first, DynamicArray& second)
   {
-    using std::swap;
-    swap(first.size_, second.size_);
-    swap(first.data_, second.data_);
+    // Heap buffers are exchanged by pointer, inline elements have to move.
+    if (!first.IsInline() && !second.IsInline())
+    {
+      std::swap(first.size_, second.size_);
+      std::swap(first.data_, second.data_);
+      return;
+    }
+
+    DynamicArray temp(std::move(first));
+    first = std::move(second);
+    second = std::move(temp);
   }
 
   ~DynamicArray()
   {
-    delete[] data_;
+    Release();
   }
 
-  size_t size() { return size_; }
+  size_t size() const { return size_; }
 
   void clear()
   {
-    delete[] data_;
-    data_ = new T[size_];
+    for (size_t i = 0; i < size_; i++)
+      data_[i].~T();
+    DefaultConstruct();
   }
 
   T & operator [] (size_t i)
@@ -0,0 +1,217 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+//--------------------------------------------//
+//         Hardware performance counters      //
+//--------------------------------------------//
+
+// A group of hardware counters (cycles, instructions, L1D and last-level
+// cache misses, branch misses) counting user-space events of the calling
+// thread, read through perf_event_open. The group is scheduled on the PMU
+// as a unit so the counts are consistent with each other, and the counts of
+// a region are scaled up if the kernel had to multiplex the group with
+// other groups during it (see Delta()).
+//
+// Counters the kernel or the hardware does not provide (e.g., in VMs, or
+// with perf_event_paranoid > 2) are left out, and on non-Linux systems
+// nothing is available; Available() and Error() say which.
+
+class PerfCounters
+{
+ public:
+  enum Counter
+  {
+    Cycles,
+    Instructions,
+    L1DMisses,
+    LLCMisses,
+    BranchMisses,
+    Num
+  };
+
+  typedef std::array<std::uint64_t, Num> Values;
+
+  // Raw counts, and the times the group was enabled and actually counting
+  // (on the PMU), since construction.
+  struct Sample
+  {
+    Values raw = {};
+    std::uint64_t time_enabled = 0;
+    std::uint64_t time_running = 0;
+  };
+
+  static const char* Name(unsigned counter)
+  {
+    static const char* names[Num] = { "cycles", "instructions", "L1D misses", "LLC misses", "branch misses" };
+    return names[counter];
+  }
+
+ private:
+  int leader_ = -1;
+  std::array<int, Num> fds_;
+  // Position of each open counter in a group read, or -1.
+  std::array<int, Num> slots_;
+  unsigned num_open_ = 0;
+  std::string error_;
+
+ public:
+  PerfCounters()
+  {
+    fds_.fill(-1);
+    slots_.fill(-1);
+
+#ifdef __linux__
+    struct Event { std::uint32_t type; std::uint64_t config; };
+    const Event events[Num] = {
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+      { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+    };
+
+    for (unsigned counter = 0; counter < Num; counter++)
+    {
+      struct perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = events[counter].type;
+      attr.config = events[counter].config;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      attr.disabled = leader_ < 0;
+
+      int fd = syscall(__NR_perf_event_open, &attr, 0, -1, leader_, 0);
+      if (fd < 0)
+      {
+        if (error_.empty())
+          error_ = std::string(Name(counter)) + ": " + std::strerror(errno);
+        continue;
+      }
+      if (leader_ < 0)
+        leader_ = fd;
+      fds_[counter] = fd;
+      slots_[counter] = num_open_++;
+    }
+
+    if (leader_ >= 0)
+    {
+      ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#else
+    error_ = "perf_event_open is only available on Linux";
+#endif
+  }
+
+  ~PerfCounters()
+  {
+#ifdef __linux__
+    for (int fd : fds_)
+      if (fd >= 0)
+        close(fd);
+#endif
+  }
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  bool Available() const
+  {
+    return leader_ >= 0;
+  }
+
+  bool Available(unsigned counter) const
+  {
+    return slots_[counter] >= 0;
+  }
+
+  // Why the first unavailable counter could not be opened ("" if all were).
+  const std::string& Error() const
+  {
+    return error_;
+  }
+
+  // Unscaled totals; pass two reads to Delta() to count a region.
+  Sample Read() const
+  {
+    Sample sample;
+#ifdef __linux__
+    if (leader_ < 0)
+      return sample;
+
+    // { nr, time_enabled, time_running, value[nr] }
+    std::uint64_t buffer[3 + Num];
+    if (read(leader_, buffer, sizeof(buffer)) < ssize_t((3 + num_open_) * sizeof(std::uint64_t)))
+      return sample;
+
+    sample.time_enabled = buffer[1];
+    sample.time_running = buffer[2];
+    for (unsigned counter = 0; counter < Num; counter++)
+      if (slots_[counter] >= 0)
+        sample.raw[counter] = buffer[3 + slots_[counter]];
+#endif
+    return sample;
+  }
+
+  // Counts of the region between two reads, scaled by the region's own
+  // enabled/running ratio. Scaling the totals instead would not be monotone
+  // under multiplexing, since the ratio changes between reads while the raw
+  // counts barely move. A region during which the group never ran counts 0.
+  static Values Delta(const Sample& start, const Sample& end)
+  {
+    Values values;
+    values.fill(0);
+    if (end.time_running <= start.time_running || end.time_enabled < start.time_enabled)
+      return values;
+
+    double scale = double(end.time_enabled - start.time_enabled) /
+      double(end.time_running - start.time_running);
+    for (unsigned counter = 0; counter < Num; counter++)
+      if (end.raw[counter] > start.raw[counter])
+        values[counter] = std::uint64_t((end.raw[counter] - start.raw[counter]) * scale);
+    return values;
+  }
+};
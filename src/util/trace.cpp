@@ -0,0 +1,275 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "trace.hpp"
+
+namespace tracing
+{
+
+struct Event
+{
+  const char* name;
+  std::int64_t arg;
+  std::uint64_t begin_ns;
+  std::uint64_t duration_ns;
+};
+
+// Set from the SIGUSR1 handler, so it must be a lock-free atomic.
+static std::atomic<bool> gDumpRequested(false);
+
+static void DumpHandler(int)
+{
+  gDumpRequested = true;
+}
+
+static std::uint64_t NowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class ThreadBuffer
+{
+ public:
+  unsigned id;
+  unsigned depth = 0;
+  std::uint64_t num_roots = 0;
+  bool sampled = true;
+
+ private:
+  // Only contended while a dump is copying the events out.
+  std::mutex mutex_;
+  std::size_t capacity_;
+  std::vector<Event> events_; // grown on demand up to capacity_.
+  std::uint64_t num_events_ = 0;
+
+ public:
+  ThreadBuffer(unsigned id, std::size_t capacity) :
+      id(id),
+      capacity_(capacity)
+  {
+  }
+
+  void Push(const Event& event)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (events_.size() < capacity_)
+    {
+      if (events_.size() == events_.capacity())
+        events_.reserve(std::min(capacity_, std::max<std::size_t>(1024, 2 * events_.size())));
+      events_.push_back(event);
+    }
+    else
+    {
+      events_[num_events_ % capacity_] = event;
+    }
+    num_events_++;
+  }
+
+  // Oldest first; returns the number of events overwritten.
+  std::uint64_t Copy(std::vector<Event>& events)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::uint64_t first = num_events_ > events_.size() ? num_events_ - events_.size() : 0;
+    for (std::uint64_t i = first; i < num_events_; i++)
+      events.push_back(events_[i % events_.size()]);
+    return first;
+  }
+};
+
+class Registry
+{
+ public:
+  std::string file_name = "timeloop-trace.json";
+  std::uint64_t sample_interval = 1;
+  std::size_t capacity = 1 << 20;
+  std::uint64_t start_ns;
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+  std::vector<ThreadBuffer*> free_buffers_;
+
+ public:
+  Registry() :
+      start_ns(NowNs())
+  {
+    if (auto env = std::getenv("TIMELOOP_TRACE_FILE"))
+      file_name = env;
+    if (auto env = std::getenv("TIMELOOP_TRACE_SAMPLE"))
+      sample_interval = std::max<std::uint64_t>(1, std::strtoull(env, nullptr, 10));
+    if (auto env = std::getenv("TIMELOOP_TRACE_EVENTS"))
+      capacity = std::max<std::size_t>(1, std::strtoull(env, nullptr, 10));
+
+    struct sigaction action;
+    action.sa_handler = DumpHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, NULL);
+
+    std::atexit(tracing::Dump);
+  }
+
+  // Buffers outlive their threads so that a dump at exit sees them all. A
+  // thread that exits hands its buffer back, and the next new thread picks
+  // it up, so memory is bounded by the number of concurrently live threads
+  // rather than by the number of threads ever started.
+  ThreadBuffer* AcquireBuffer()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!free_buffers_.empty())
+    {
+      auto buffer = free_buffers_.back();
+      free_buffers_.pop_back();
+      return buffer;
+    }
+    buffers_.push_back(std::make_shared<ThreadBuffer>(buffers_.size(), capacity));
+    return buffers_.back().get();
+  }
+
+  void ReleaseBuffer(ThreadBuffer* buffer)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_buffers_.push_back(buffer);
+  }
+
+  void Dump()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::ofstream out(file_name);
+    if (!out)
+    {
+      std::cerr << "ERROR: cannot write trace to " << file_name << std::endl;
+      return;
+    }
+
+    auto pid = getpid();
+    std::uint64_t num_events = 0;
+    std::uint64_t num_dropped = 0;
+    std::vector<Event> events;
+
+    out << "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"sample_interval\":" << sample_interval
+        << ",\"events_per_thread\":" << capacity << "},\"traceEvents\":[" << std::endl;
+    out << std::fixed << std::setprecision(3);
+    bool first = true;
+    for (auto& buffer : buffers_)
+    {
+      events.clear();
+      num_dropped += buffer->Copy(events);
+      num_events += events.size();
+
+      out << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid
+          << ",\"tid\":" << buffer->id << ",\"args\":{\"name\":\"thread " << buffer->id << "\"}}";
+      first = false;
+      for (auto& event : events)
+      {
+        out << ",\n{\"ph\":\"X\",\"name\":\"" << event.name << "\",\"pid\":" << pid
+            << ",\"tid\":" << buffer->id
+            << ",\"ts\":" << (event.begin_ns - start_ns) / 1000.0
+            << ",\"dur\":" << event.duration_ns / 1000.0;
+        if (event.arg >= 0)
+          out << ",\"args\":{\"arg\":" << event.arg << "}";
+        out << "}";
+      }
+    }
+    out << "\n]}" << std::endl;
+
+    std::cerr << "Trace: " << num_events << " events from " << buffers_.size() << " threads ("
+              << num_dropped << " overwritten) written to " << file_name << std::endl;
+  }
+};
+
+// Never destroyed, so that it is still there for the dump at exit.
+static Registry& GetRegistry()
+{
+  static Registry* registry = new Registry();
+  return *registry;
+}
+
+// Acquired on a thread's first scope and released when the thread exits.
+class LocalBufferHandle
+{
+ public:
+  ThreadBuffer* buffer = nullptr;
+
+  ~LocalBufferHandle()
+  {
+    if (buffer)
+      GetRegistry().ReleaseBuffer(buffer);
+  }
+};
+
+static ThreadBuffer* LocalBuffer()
+{
+  static thread_local LocalBufferHandle handle;
+  if (!handle.buffer)
+    handle.buffer = GetRegistry().AcquireBuffer();
+  return handle.buffer;
+}
+
+Scope::Scope(const char* name, std::int64_t arg) :
+    buffer_(LocalBuffer()),
+    name_(name),
+    arg_(arg)
+{
+  if (buffer_->depth++ == 0)
+    buffer_->sampled = buffer_->num_roots++ % GetRegistry().sample_interval == 0;
+  record_ = buffer_->sampled;
+  begin_ns_ = record_ ? NowNs() : 0;
+}
+
+Scope::~Scope()
+{
+  if (record_)
+    buffer_->Push({ name_, arg_, begin_ns_, NowNs() - begin_ns_ });
+  if (--buffer_->depth == 0 && gDumpRequested.exchange(false))
+    Dump();
+}
+
+void Dump()
+{
+  GetRegistry().Dump();
+}
+
+} // namespace tracing
@@ -0,0 +1,91 @@
+/* Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+
+//--------------------------------------------//
+//               Scoped tracing               //
+//--------------------------------------------//
+
+// Lightweight wall-clock tracing of the evaluation pipeline, compiled in
+// only when building with `scons --trace` (USE_TRACE). Otherwise the macro
+// expands to nothing and costs nothing.
+//
+//   TRACE_SCOPE("topology/evaluate");        // times the enclosing scope
+//   TRACE_SCOPE("topology/storage-level", i); // ... with an integer argument
+//
+// Names must be string literals. Each thread records complete events into
+// its own ring buffer, which keeps only the most recent events. Scopes that
+// open with no other scope active on their thread are roots, and only one
+// in every TIMELOOP_TRACE_SAMPLE roots (default 1) is recorded together
+// with everything nested in it, so long runs can be traced at bounded cost.
+//
+// The buffers are written as Chrome trace-event JSON, viewable in
+// chrome://tracing or Perfetto, to TIMELOOP_TRACE_FILE (default
+// timeloop-trace.json) at exit. Sending SIGUSR1 writes a snapshot of the
+// trace so far; it is taken by the next thread to close a root scope.
+// TIMELOOP_TRACE_EVENTS caps the ring buffer size in events per thread
+// (default 1M). Buffers grow as events arrive, and a thread's buffer is
+// reused by the next thread started after it exits.
+
+namespace tracing
+{
+
+class ThreadBuffer;
+
+class Scope
+{
+ private:
+  ThreadBuffer* buffer_;
+  const char* name_;
+  std::int64_t arg_;
+  std::uint64_t begin_ns_;
+  bool record_;
+
+ public:
+  Scope(const char* name, std::int64_t arg = -1);
+  ~Scope();
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+};
+
+// Write every thread's events to the trace file now.
+void Dump();
+
+} // namespace tracing
+
+#ifdef USE_TRACE
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(...) tracing::Scope TRACE_CONCAT(trace_scope_, __LINE__)(__VA_ARGS__)
+#else
+#define TRACE_SCOPE(...)
+#endif
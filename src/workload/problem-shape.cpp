@@ -167,4 +167,21 @@ void Shape::Parse(config::CompoundConfigNode shape)
   }
 }
 
+bool Shape::operator==(const Shape& other) const
+{
+  return NumDimensions == other.NumDimensions &&
+    DimensionIDToName == other.DimensionIDToName &&
+    DimensionNameToID == other.DimensionNameToID &&
+    NumCoefficients == other.NumCoefficients &&
+    CoefficientNameToID == other.CoefficientNameToID &&
+    CoefficientIDToName == other.CoefficientIDToName &&
+    DefaultCoefficients == other.DefaultCoefficients &&
+    NumDataSpaces == other.NumDataSpaces &&
+    DataSpaceNameToID == other.DataSpaceNameToID &&
+    DataSpaceIDToName == other.DataSpaceIDToName &&
+    DataSpaceOrder == other.DataSpaceOrder &&
+    IsReadWriteDataSpace == other.IsReadWriteDataSpace &&
+    Projections == other.Projections;
+}
+
 }  // namespace problem
@@ -74,6 +74,9 @@ class Shape
 
  public: 
   void Parse(config::CompoundConfigNode config); 
+
+  bool operator==(const Shape& other) const;
+  bool operator!=(const Shape& other) const { return !(*this == other); }
 };
 
 } // namespace problem
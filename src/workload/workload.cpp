@@ -28,6 +28,8 @@
 #include <string>
 #include <cstring>
 #include <fstream>
+#include <map>
+#include <mutex>
 
 #include "problem-shape.hpp"
 #include "workload.hpp"
@@ -130,26 +132,52 @@ std::string ShapeFileName(const std::string shape_name)
   return shape_file_path;
 }
 
+// Shapes referenced by name are read from their files once per process.
+// Design-space sweeps construct a workload per point, and re-loading and
+// re-parsing the same shape file was the bulk of workload parsing time.
+// Entries are never erased, so returned references stay valid.
+const Shape& NamedShape(const std::string& shape_name)
+{
+  static std::map<std::string, Shape> named_shapes;
+  static std::mutex named_shapes_mutex;
+
+  std::lock_guard<std::mutex> lock(named_shapes_mutex);
+  auto it = named_shapes.find(shape_name);
+  if (it == named_shapes.end())
+  {
+    config::CompoundConfig shape_config(ShapeFileName(shape_name).c_str());
+    auto shape = shape_config.getRoot().lookup("shape");
+    it = named_shapes.emplace(shape_name, Shape()).first;
+    it->second.Parse(shape);
+  }
+  return it->second;
+}
+
 void ParseWorkload(config::CompoundConfigNode config, Workload& workload)
 {
+  // Parse into a fresh shape and only replace the global one if it changed.
+  // Re-parsing in place would keep stale entries from a previous shape, and
+  // skipping identical shapes means constructing another workload of the
+  // same shape never writes to state that live workloads are reading.
+  Shape parsed_shape;
   std::string shape_name;
   if (!config.exists("shape"))
   {
     std::cerr << "WARNING: found neither a problem shape description nor a string corresponding to a to a pre-existing shape description. Assuming shape: cnn-layer." << std::endl;
-    config::CompoundConfig shape_config(ShapeFileName("cnn-layer").c_str());
-    auto shape = shape_config.getRoot().lookup("shape");
-    shape_.Parse(shape);    
+    parsed_shape = NamedShape("cnn-layer");
   }
   else if (config.lookupValue("shape", shape_name))
   {    
-    config::CompoundConfig shape_config(ShapeFileName(shape_name).c_str());
-    auto shape = shape_config.getRoot().lookup("shape");
-    shape_.Parse(shape);    
+    parsed_shape = NamedShape(shape_name);
   }
   else
   {
     auto shape = config.lookup("shape");
-    shape_.Parse(shape);
+    parsed_shape.Parse(shape);
+  }
+  if (parsed_shape != shape_)
+  {
+    shape_ = parsed_shape;
   }
 
   // Bounds may be specified directly (backwards-compat) or under a subkey.
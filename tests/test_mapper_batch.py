@@ -0,0 +1,127 @@
+#! /usr/bin/env python3
+
+# Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Checks that timeloop-mapper's batched evaluation of feedback-free searches
+# visits and reports the same mappings as its one-at-a-time path, which the
+# trace option forces. A random search with filter-revisits runs until it has
+# visited its whole space; the spaces used here are not a multiple of the
+# evaluation batch size, so the search runs out of candidates part-way
+# through filling the last batch, whose candidates must all still be used.
+
+import argparse
+import inspect
+import os
+import re
+import subprocess
+import sys
+
+import yaml
+
+this_file_path = os.path.abspath(inspect.getfile(inspect.currentframe()))
+root_dir = os.path.join(os.path.dirname(this_file_path), '..')
+
+base_config = 'configs/mapper/sample.yaml'
+
+# Constraints that leave only the temporal factors of the sample problem
+# free. The spatial splits are pinned too, so that the mapspace size is the
+# number of index factorizations.
+constraints = [
+    {'target': 'Registers', 'type': 'datatype', 'keep': ['Weights'], 'bypass': ['Inputs', 'Outputs']},
+    {'target': 'AccumulationBuffer', 'type': 'datatype', 'keep': ['Outputs'], 'bypass': ['Weights', 'Inputs']},
+    {'target': 'WeightInputBuffer', 'type': 'datatype', 'keep': ['Weights', 'Inputs'], 'bypass': ['Outputs']},
+    {'target': 'Registers', 'type': 'temporal', 'permutation': 'RSPQCKN'},
+    {'target': 'AccumulationBuffer', 'type': 'temporal', 'permutation': 'RSPQCKN'},
+    {'target': 'AccumulationBuffer', 'type': 'spatial', 'factors': 'R1 S1 P1 Q1 C1 K1 N1', 'permutation': 'RSPQCKN', 'split': 7},
+    {'target': 'WeightInputBuffer', 'type': 'temporal', 'permutation': 'RSPQCKN'},
+    {'target': 'WeightInputBuffer', 'type': 'spatial', 'factors': 'R1 S1 P1 Q1 C1 K1 N1', 'permutation': 'RSPQCKN', 'split': 7},
+    {'target': 'DRAM', 'type': 'temporal', 'permutation': 'RSPQCKN'},
+]
+
+# Problem shapes and the sizes of their mapspaces: one that is a few batches
+# and a remainder, and one that is smaller than a single batch.
+shapes = [
+    ({'R': 1, 'S': 1, 'P': 9, 'Q': 5, 'C': 1, 'K': 1, 'N': 1}, 40),
+    ({'R': 1, 'S': 1, 'P': 9, 'Q': 1, 'C': 1, 'K': 1, 'N': 1}, 10),
+]
+
+def make_config(shape, trace):
+    with open(os.path.join(root_dir, base_config), 'r') as f:
+        config = yaml.load(f, Loader = yaml.SafeLoader)
+    for key in ['mapper', 'mapspace', 'mapspace_constraints', 'arch_constraints', 'architecture_constraints']:
+        config.pop(key, None)
+    config['arch'].pop('constraints', None)
+    config['problem'].update(shape)
+    config['mapspace'] = {'constraints': constraints}
+    config['mapper'] = {'algorithm': 'random', 'filter-revisits': True, 'num-threads': 1, 'live-status': False,
+                        'search-size': 0, 'victory-condition': 0, 'timeout': 0, 'trace': trace}
+    return config
+
+def run_mapper(mapper, dirname, config):
+    """Returns (mappings evaluated, valid mappings, best energy in pJ, best cycles)."""
+    os.makedirs(dirname, exist_ok = True)
+    with open(os.path.join(dirname, 'config.yaml'), 'w') as f:
+        f.write(yaml.safe_dump(config))
+    with open(os.path.join(dirname, 'log.txt'), 'w') as log:
+        subprocess.check_call([mapper, 'config.yaml'], cwd = dirname, stdout = log, stderr = log, timeout = 600)
+    with open(os.path.join(dirname, 'log.txt'), 'r') as f:
+        search = re.search(r'^Search: (\d+) mappings evaluated \((\d+) valid\)', f.read(), re.MULTILINE)
+    with open(os.path.join(dirname, 'timeloop-mapper.stats.txt'), 'r') as f:
+        text = f.read()
+    energy = float(re.search(r'^Total topology energy: ([0-9.]+) pJ', text, re.MULTILINE).group(1))
+    cycles = int(re.search(r'^Cycles: (\d+)', text[text.rfind('Summary Stats'):], re.MULTILINE).group(1))
+    return int(search.group(1)), int(search.group(2)), energy, cycles
+
+def main():
+    parser = argparse.ArgumentParser(
+            description='Check that batched timeloop-mapper searches match one-at-a-time searches.')
+    parser.add_argument('--mapper', default = os.path.join(root_dir, 'build', 'timeloop-mapper'),
+            help = 'timeloop-mapper binary (default: build/timeloop-mapper)')
+    options = parser.parse_args()
+
+    dirname = os.path.join(root_dir, 'tests', 'results', 'mapper-batch')
+    success = True
+    for shape, size in shapes:
+        name = 'P%dQ%d' % (shape['P'], shape['Q'])
+        batched = run_mapper(options.mapper, os.path.join(dirname, name + '-batched'), make_config(shape, False))
+        single = run_mapper(options.mapper, os.path.join(dirname, name + '-single'), make_config(shape, True))
+        if single[0] != size:
+            print('%s: the one-at-a-time search evaluated %d mappings; the mapspace has %d' % (name, single[0], size))
+            success = False
+        if batched != single:
+            print('%s: batched search gives %d mappings evaluated (%d valid), best %f pJ, %d cycles; '
+                  'one at a time gives %d (%d valid), best %f pJ, %d cycles'
+                  % ((name,) + batched + single))
+            success = False
+    if success:
+        print('All tests passed.')
+    else:
+        print('Some tests failed.')
+        sys.exit(1)
+
+if __name__ == '__main__':
+    main()
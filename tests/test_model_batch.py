@@ -0,0 +1,190 @@
+#! /usr/bin/env python3
+
+# Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Checks that timeloop-model's batch and server modes, whose workers re-use
+# one engine for every mapping they claim, report the same stats as a
+# separate timeloop-model run per mapping. The two mappings use different spatial
+# fanouts into the global buffer, so their network stats differ, and the
+# architecture gives the networks a non-zero energy.
+
+import argparse
+import copy
+import csv
+import inspect
+import itertools
+import json
+import os
+import re
+import subprocess
+import sys
+
+import yaml
+
+this_file_path = os.path.abspath(inspect.getfile(inspect.currentframe()))
+root_dir = os.path.join(os.path.dirname(this_file_path), '..')
+
+base_config = 'configs/mapper/sample.yaml'
+
+# A mapping of the sample problem onto the sample architecture, and a
+# variant that spreads K over 4 instead of 16 global-buffer children.
+mapping_a = [
+    {'target': 'Registers', 'type': 'datatype', 'keep': ['Weights'], 'bypass': ['Inputs', 'Outputs']},
+    {'target': 'AccumulationBuffer', 'type': 'datatype', 'keep': ['Outputs'], 'bypass': ['Weights', 'Inputs']},
+    {'target': 'WeightInputBuffer', 'type': 'datatype', 'keep': ['Weights', 'Inputs'], 'bypass': ['Outputs']},
+    {'target': 'Registers', 'type': 'temporal', 'factors': 'R1 S1 P1 Q1 C1 K1 N1', 'permutation': 'RSPQCKN'},
+    {'target': 'AccumulationBuffer', 'type': 'temporal', 'factors': 'R1 S1 P1 Q1 C1 K1 N1', 'permutation': 'RSPQCKN'},
+    {'target': 'AccumulationBuffer', 'type': 'spatial', 'factors': 'R1 S1 P1 Q1 C1 K1 N1', 'permutation': 'RSPQCKN'},
+    {'target': 'WeightInputBuffer', 'type': 'temporal', 'factors': 'R3 S3 P1 Q1 C1 K1 N1', 'permutation': 'RSPQCKN'},
+    {'target': 'WeightInputBuffer', 'type': 'spatial', 'factors': 'R1 S1 P1 Q1 C1 K16 N1', 'permutation': 'KRSPQCN'},
+    {'target': 'DRAM', 'type': 'temporal', 'factors': 'R1 S1 P48 Q480 C1 K1 N1', 'permutation': 'RSPQCKN'},
+]
+
+mapping_b = copy.deepcopy(mapping_a)
+mapping_b[7]['factors'] = 'R1 S1 P1 Q1 C1 K4 N1'
+mapping_b[8]['factors'] = 'R1 S1 P48 Q480 C1 K4 N1'
+
+mappings = {'a': mapping_a, 'b': mapping_b}
+
+def make_config(extra):
+    with open(os.path.join(root_dir, base_config), 'r') as f:
+        config = yaml.load(f, Loader = yaml.SafeLoader)
+    for key in ['mapper', 'mapspace', 'mapspace_constraints', 'arch_constraints', 'architecture_constraints']:
+        config.pop(key, None)
+    config['arch'].pop('constraints', None)
+    # Give the networks a cost, so that stale network stats show up in the
+    # total energy.
+    for level in config['arch']['storage']:
+        level['router-energy'] = 1.0
+        level['wire-energy'] = 0.5
+    config.update(extra)
+    return config
+
+def run_model(model, dirname, config):
+    os.makedirs(dirname, exist_ok = True)
+    config_path = os.path.join(dirname, 'config.yaml')
+    with open(config_path, 'w') as f:
+        f.write(yaml.safe_dump(config))
+    with open(os.path.join(dirname, 'log.txt'), 'w') as log:
+        subprocess.check_call([model, 'config.yaml'], cwd = dirname, stdout = log, stderr = log)
+
+def single_run(model, dirname, name):
+    """Returns (energy in pJ, cycles) of a separate run of one mapping."""
+    rundir = os.path.join(dirname, 'single-' + name)
+    run_model(model, rundir, make_config({'mapping': mappings[name]}))
+    with open(os.path.join(rundir, 'timeloop-model.stats.txt'), 'r') as f:
+        text = f.read()
+    energy = float(re.search(r'^Total topology energy: ([0-9.]+) pJ', text, re.MULTILINE).group(1))
+    cycles = int(re.search(r'^Cycles: (\d+)', text[text.rfind('Summary Stats'):], re.MULTILINE).group(1))
+    return energy, cycles
+
+def batch_run(model, dirname, order, threads):
+    """Returns {mapping name: (energy in pJ, cycles)} of one batch run."""
+    rundir = os.path.join(dirname, 'batch-%s-t%d' % (''.join(order), threads))
+    os.makedirs(rundir, exist_ok = True)
+    with open(os.path.join(rundir, 'requests.jsonl'), 'w') as f:
+        for name in order:
+            f.write(json.dumps({'id': name, 'mapping': mappings[name]}) + '\n')
+    run_model(model, rundir, make_config({'model': {'batch': 'requests.jsonl', 'batch_threads': threads}}))
+    results = {}
+    with open(os.path.join(rundir, 'timeloop-model.batch.csv'), 'r') as f:
+        for row in csv.DictReader(f):
+            assert row['status'] == 'ok', 'mapping %s: %s' % (row['id'], row['message'])
+            results[row['id']] = (float(row['energy (pJ)']), int(row['cycles']))
+    return results
+
+def server_run(model, dirname, order, threads):
+    """Returns {mapping name: (energy in pJ, cycles)} of one stdin server run."""
+    rundir = os.path.join(dirname, 'server-%s-t%d' % (''.join(order), threads))
+    os.makedirs(rundir, exist_ok = True)
+    config_path = os.path.join(rundir, 'config.yaml')
+    with open(config_path, 'w') as f:
+        f.write(yaml.safe_dump(make_config({'model': {'server': 'stdin', 'server_threads': threads}})))
+    requests = ''.join(json.dumps({'id': name, 'mapping': mappings[name]}) + '\n' for name in order)
+    with open(os.path.join(rundir, 'log.txt'), 'w') as log:
+        output = subprocess.run([model, 'config.yaml'], cwd = rundir, input = requests, stdout = subprocess.PIPE,
+                                stderr = log, universal_newlines = True, check = True).stdout
+    results = {}
+    for line in output.splitlines():
+        response = json.loads(line)
+        assert response['status'] == 'ok', 'mapping %s: %s' % (response['id'], response.get('message'))
+        results[response['id']] = (response['energy_pJ'], response['cycles'])
+    return results
+
+def server_ids(model, dirname):
+    """Checks that the server echoes request ids as valid JSON: ids that are
+    JSON numbers as numbers, other unquoted scalars as strings."""
+    rundir = os.path.join(dirname, 'server-ids')
+    os.makedirs(rundir, exist_ok = True)
+    with open(os.path.join(rundir, 'config.yaml'), 'w') as f:
+        f.write(yaml.safe_dump(make_config({'model': {'server': 'stdin', 'server_threads': 1}})))
+    ids = {'12': 12, '-0.5e3': -500.0, '1.': '1.', '.5': '.5', '+1': '+1', '007': '007', '"7"': '7'}
+    requests = ''.join('{"id": %s, "mapping": %s}\n' % (raw, json.dumps(mappings['a'])) for raw in ids)
+    with open(os.path.join(rundir, 'log.txt'), 'w') as log:
+        output = subprocess.run([model, 'config.yaml'], cwd = rundir, input = requests, stdout = subprocess.PIPE,
+                                stderr = log, universal_newlines = True, check = True).stdout
+    echoed = [json.loads(line)['id'] for line in output.splitlines()]
+    success = True
+    for raw, expected in ids.items():
+        if not any(type(id) == type(expected) and id == expected for id in echoed):
+            print('Request id %s was not echoed as %r (got %r)' % (raw, expected, echoed))
+            success = False
+    return success
+
+def main():
+    parser = argparse.ArgumentParser(
+            description='Check that timeloop-model batch and server results match separate runs of each mapping.')
+    parser.add_argument('--model', default = os.path.join(root_dir, 'build', 'timeloop-model'),
+            help = 'timeloop-model binary (default: build/timeloop-model)')
+    options = parser.parse_args()
+
+    dirname = os.path.join(root_dir, 'tests', 'results', 'model-batch')
+    modes = [('batch', batch_run), ('server', server_run)]
+    expected = {name: single_run(options.model, dirname, name) for name in mappings}
+    assert expected['a'][0] != expected['b'][0], 'the test mappings should differ in energy'
+
+    success = True
+    for order, threads, (mode, run) in itertools.product([['a', 'b'], ['b', 'a']], [1, 2], modes):
+        results = run(options.model, dirname, order, threads)
+        for name in mappings:
+            energy, cycles = results[name]
+            ref_energy, ref_cycles = expected[name]
+            # stats.txt prints energies with two decimals.
+            if abs(energy - ref_energy) > 0.01 + 1e-9 * ref_energy or cycles != ref_cycles:
+                print('Mapping %s, %s order %s on %d threads: energy %f pJ, %d cycles; '
+                      'a separate run gives %f pJ, %d cycles'
+                      % (name, mode, ''.join(order), threads, energy, cycles, ref_energy, ref_cycles))
+                success = False
+    success = server_ids(options.model, dirname) and success
+    if success:
+        print('All tests passed.')
+    else:
+        print('Some tests failed.')
+        sys.exit(1)
+
+if __name__ == '__main__':
+    main()